@@ -68,10 +68,11 @@ struct FileInfo
 struct ParserSystemDescription
 {
   std::string sys_file, sys_name, unique_name;
-  std::vector<ParserFunctionArgument> args, req_args, req_not_args, track_args;
+  std::vector<ParserFunctionArgument> args, req_args, req_not_args, track_args, changed_args;
   std::vector<std::string> before, after, tags, on_event;
   std::string stage;
   std::string isJob;
+  std::string isChunk;
 };
 #define SPACE_SYM " \n\t\r\a\f\v"
 #define NAME_SYM "a-zA-Z0-9_"
@@ -301,10 +302,19 @@ void parse_definition(Match &str, ParserSystemDescription &parserDescr)
           for (uint i = 1; i < args0.size(); i++)
             parserDescr.track_args.emplace_back(clear_arg(args0[i].get()));
         }
+        else if (key == "changed")
+        {
+          for (uint i = 1; i < args0.size(); i++)
+            parserDescr.changed_args.emplace_back(clear_arg(args0[i].get()));
+        }
         else if (key == "job")
         {
           parserDescr.isJob = args0[1].get();
         }
+        else if (key == "chunk")
+        {
+          parserDescr.isChunk = args0[1].get();
+        }
         else if (key == "stage")
         {
           parserDescr.stage = args0[1].get();
@@ -322,6 +332,25 @@ void parse_definition(Match &str, ParserSystemDescription &parserDescr)
 
   if (parserDescr.isJob.empty())
     parserDescr.isJob = "false";
+  if (parserDescr.isChunk.empty())
+    parserDescr.isChunk = "false";
+}
+
+// chunk systems receive std::span<T> (or ecs::SoaView<T> for SoA types) with all components of the chunk, component type is T
+static bool unwrap_chunk_argument(ParserFunctionArgument &arg)
+{
+  std::string prefix = "std::span<";
+  if (arg.type.compare(0, prefix.size(), prefix) != 0)
+    prefix = "ecs::SoaView<";
+  if (arg.optional || arg.reference || arg.type.compare(0, prefix.size(), prefix) != 0 || arg.type.back() != '>')
+    return false;
+  std::string type = arg.type.substr(prefix.size(), arg.type.size() - prefix.size() - 1);
+  type.erase(0, type.find_first_not_of(SPACE_SYM));
+  type.erase(type.find_last_not_of(SPACE_SYM) + 1);
+  arg.type = type;
+  arg.reference = true;
+  arg.argType = arg.is_const ? ArgType::ReadOnly : ArgType::ReadWrite;
+  return true;
 }
 
 void parse_system(std::vector<ParserSystemDescription> &systemsDescriptions,
@@ -370,6 +399,8 @@ void parse_system(std::vector<ParserSystemDescription> &systemsDescriptions,
     for (auto &arg : matched_args)
     {
       descr.args.push_back(clear_arg(arg.get()));
+      if (descr.isChunk != "false" && !unwrap_chunk_argument(descr.args.back()))
+        log_error("chunk system should have only std::span<T> or ecs::SoaView<T> arguments, got \"%s\" in %s", arg.get().c_str(), descr.sys_file.c_str());
     }
     systemsDescriptions.emplace_back(std::move(descr));
   }
@@ -398,6 +429,19 @@ void template_query_types(std::ofstream &outFile, const ParserFunctionArgument *
   }
 }
 
+void template_chunk_types(std::ofstream &outFile, const ParserFunctionArgument *args, size_t args_count)
+{
+  for (uint i = 0; i < args_count; i++)
+  {
+    auto &arg = args[i];
+    snprintf(buffer, bufferSize, "%s%s%s",
+            arg.is_const ? "const " : "",
+            arg.type.c_str(),
+            i + 1 == args_count ? "" : ", ");
+    outFile << buffer;
+  }
+}
+
 void write(std::ofstream &outFile, const char *fmt, ...)
 {
   va_list args;
@@ -443,10 +487,20 @@ static void query_definition(std::ofstream &outFile, const std::vector<ParserSys
           "static void %s(ecs::EcsManager &mgr, Callable &&query_function)\n"
           "{\n"
           "  constexpr ecs::NameHash queryHash = ecs::hash(\"%s\");\n"
-          "  const int N = %d;\n"
-          "  ecs_details::query_iteration<N, ",
+          "  const int N = %d;\n",
           name, query.unique_name.c_str(), query.args.size());
-    template_query_types(outFile, query.args.data(), query.args.size());
+    if (query.isChunk != "false")
+    {
+      if (query.isJob != "false")
+        log_error("job and chunk attributes can't be combined in query %s", query.sys_file.c_str());
+      write(outFile, "  ecs_details::query_chunks_iteration<N, ");
+      template_chunk_types(outFile, query.args.data(), query.args.size());
+    }
+    else
+    {
+      write(outFile, "  ecs_details::%s<N, ", query.isJob != "false" ? "query_parallel_iteration" : "query_iteration");
+      template_query_types(outFile, query.args.data(), query.args.size());
+    }
     write(outFile,
           ">(mgr, queryHash, std::move(query_function));\n"
           "}\n\n");
@@ -479,14 +533,17 @@ static void system_definition(std::ofstream &outFile, const std::vector<ParserSy
   {
     const char *name = query.sys_name.c_str();
     write(outFile,
-          "static void %s_implementation(ecs_details::Archetype &archetype, const ecs::ToComponentMap &to_archetype_component)\n"
+          "static void %s_implementation(ecs_details::Archetype &archetype, ecs::ToComponentMap to_archetype_component, uint32_t chunk_begin, uint32_t chunk_end)\n"
           "{\n"
           "  const int N = %d;\n"
-          "  ecs_details::query_archetype_iteration<N, ",
-          name, query.args.size());
-    template_query_types(outFile, query.args.data(), query.args.size());
+          "  ecs_details::%s<N, ",
+          name, query.args.size(), query.isChunk != "false" ? "query_archetype_chunk_iteration" : "query_archetype_iteration");
+    if (query.isChunk != "false")
+      template_chunk_types(outFile, query.args.data(), query.args.size());
+    else
+      template_query_types(outFile, query.args.data(), query.args.size());
     write(outFile,
-          ">(archetype, to_archetype_component, %s, std::make_index_sequence<N>());\n"
+          ">(archetype, to_archetype_component, chunk_begin, chunk_end, %s, std::make_index_sequence<N>());\n"
           "}\n\n", name);
   }
 }
@@ -499,7 +556,7 @@ static void event_definition(std::ofstream &outFile, const std::vector<ParserSys
     const char *event_type = query.args[0].type.c_str();
     const bool isAbstractEvent = query.args[0].type == "ecs::Event";
     write(outFile,
-          "static void %s_broadcast_event(ecs_details::Archetype &archetype, const ecs::ToComponentMap &to_archetype_component, ecs::EventId event_id, const void *event_ptr)\n"
+          "static void %s_broadcast_event(ecs_details::Archetype &archetype, ecs::ToComponentMap to_archetype_component, ecs::EventId event_id, const void *event_ptr)\n"
           "{\n"
           "  ECS_UNUSED(event_id);\n"
           "  const int N = %d;\n"
@@ -517,7 +574,7 @@ static void event_definition(std::ofstream &outFile, const std::vector<ParserSys
           "}\n\n", event_type, name);
 
     write(outFile,
-          "static void %s_unicast_event(ecs_details::Archetype &archetype, const ecs::ToComponentMap &to_archetype_component, uint32_t component_idx, ecs::EventId event_id, const void *event_ptr)\n"
+          "static void %s_unicast_event(ecs_details::Archetype &archetype, ecs::ToComponentMap to_archetype_component, uint32_t component_idx, ecs::EventId event_id, const void *event_ptr)\n"
           "{\n"
           "  ECS_UNUSED(event_id);\n"
           "  const int N = %d;\n"
@@ -533,6 +590,24 @@ static void event_definition(std::ofstream &outFile, const std::vector<ParserSys
       write(outFile,
           ">(archetype, to_archetype_component, component_idx, *(const %s *)event_ptr, %s, std::make_index_sequence<N>());\n"
           "}\n\n", event_type, name);
+
+    write(outFile,
+          "static void %s_range_event(ecs_details::Archetype &archetype, ecs::ToComponentMap to_archetype_component, uint32_t component_begin, uint32_t component_end, ecs::EventId event_id, const void *event_ptr)\n"
+          "{\n"
+          "  ECS_UNUSED(event_id);\n"
+          "  const int N = %d;\n"
+          "  ecs_details::event_archetype_range_iteration<N, ",
+          name, query.args.size() - 1);
+    template_query_types(outFile, query.args.data() + 1, query.args.size() - 1);
+
+    if (isAbstractEvent)
+      write(outFile,
+          ">(archetype, to_archetype_component, component_begin, component_end, ecs::Event(event_id, event_ptr), %s, std::make_index_sequence<N>());\n"
+          "}\n\n", name);
+    else
+      write(outFile,
+          ">(archetype, to_archetype_component, component_begin, component_end, *(const %s *)event_ptr, %s, std::make_index_sequence<N>());\n"
+          "}\n\n", event_type, name);
   }
 }
 
@@ -689,6 +764,16 @@ void register_systems(std::ofstream &outFile, const std::vector<ParserSystemDesc
       write(outFile,
           "    query.stage = \"%s\";\n",
           query.stage.c_str());
+    if (query.isJob != "false")
+      write(outFile,
+          "    query.isJob = %s;\n",
+          query.isJob.c_str());
+    if (!query.changed_args.empty())
+    {
+      write(outFile,
+          "    query.changedComponents =\n");
+      fill_required_arguments(outFile, query.changed_args);
+    }
     // write(outFile, "  \"%s\",\n", query.stage.c_str());
     fill_string_array(outFile, "    query.before = {", query.before);
     fill_string_array(outFile, "    query.after = {", query.after);
@@ -711,8 +796,9 @@ void register_events(std::ofstream &outFile, const std::vector<ParserSystemDescr
     fill_string_array(outFile, "    query.after = {", query.after);
     write(outFile,
           "    query.broadcastEvent = %s_broadcast_event;\n"
-          "    query.unicastEvent = %s_unicast_event;\n",
-          name, name, event_type);
+          "    query.unicastEvent = %s_unicast_event;\n"
+          "    query.rangeEvent = %s_range_event;\n",
+          name, name, name);
 
     if (!query.track_args.empty())
     {
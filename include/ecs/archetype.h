@@ -4,16 +4,48 @@
 #include "ecs/collumn.h"
 #include "ecs/type_declaration.h"
 #include "ecs/component_init.h"
+#include "ecs/flat_initializer_list.h"
+#include "ecs/template.h"
+#include "ecs/entity_id.h"
 #include "ecs/component_declaration.h"
+#include "ecs/chunk_allocator.h"
+#include "ecs/component_mask.h"
+#include <assert.h>
+#include <string.h>
+#include <span>
+#include <atomic>
+
+namespace ecs
+{
+struct EventHandler;
+}
 
 namespace ecs_details
 {
 
 using ArchetypeComponentType = ska::flat_hash_map<ecs::ComponentId, bool /*tracked*/>;
 
+struct Archetype;
+
+// cached edge of the archetype graph for add_component/remove_component
+struct ArchetypeTransition
+{
+  Archetype *target = nullptr;
+  std::vector<int> sourceCollumns; // source collumn for every target collumn, -1 for the added component
+  int removedCollumn = -1; // source collumn of the removed component
+};
+
+// event handler matching the archetype, archetypeIdx is the archetype index in the handler
+struct ArchetypeEventHandler
+{
+  ecs::EventHandler *handler;
+  uint32_t archetypeIdx;
+};
+
 struct Archetype
 {
   ArchetypeComponentType type;
+  ComponentMask componentMask; // the same components as type, tags included
   ecs::ArchetypeId archetypeId;
 
   std::vector<ecs_details::Collumn> collumns;
@@ -22,7 +54,20 @@ struct Archetype
   std::vector<TrackedEvent> trackedEvents;
 
   ska::flat_hash_map<ecs::ComponentId, int32_t> componentToCollumnIndex;
+  // ComponentDeclaration::denseIndex -> collumn index, -1 for missing and tag components. For random access by eid
+  std::vector<int32_t> denseCollumnIndex;
   ska::flat_hash_map<ecs::ComponentId, int32_t> componentToTrackedCollumnIndex;
+  // collumn index -> tracked collumn index, -1 for not tracked collumns
+  std::vector<int32_t> collumnTrackedIndex;
+
+  // unicast event dispatch table, handlers are grouped by event in EcsManager::eventIdToHandlers order.
+  // Rebuilt by build_event_handler_table when events are registered or sorted, EventHandler pointers point to EcsManager::events
+  std::vector<ArchetypeEventHandler> eventHandlers;
+  ska::flat_hash_map<ecs::EventId, std::pair<uint32_t, uint32_t> /*offset, count*/> eventToHandlers;
+
+  // component id -> archetype with/without this component, filled on the first transition
+  ska::flat_hash_map<ecs::ComponentId, ArchetypeTransition> addTransitions;
+  ska::flat_hash_map<ecs::ComponentId, ArchetypeTransition> removeTransitions;
 
   uint32_t entityCount = 0;
   uint32_t chunkSize = 0;
@@ -31,8 +76,44 @@ struct Archetype
   uint32_t capacity = 0;
   uint32_t chunkCount = 0;
 
+  ecs::ArchetypeChunkLayout chunkLayout = ecs::ArchetypeChunkLayout::PerCollumn;
+  std::vector<char *> chunkBlocks; // only for ArchetypeChunkLayout::SingleAllocation
+  uint32_t chunkBlockSize = 0;
+  uint32_t chunkBlockAlignment = 1;
+  ecs::IChunkAllocator *chunkAllocator = nullptr;
+  const std::atomic<uint64_t> *changeVersion = nullptr; // EcsManager::changeVersion
+
   Archetype() = default;
-  Archetype(const ecs::EcsManager &mgr, ecs::ArchetypeId archetype_id, ArchetypeComponentType &&_type, ecs::ArchetypeChunkSize chunk_size_power);
+  Archetype(const ecs::EcsManager &mgr, ecs::ArchetypeId archetype_id, ArchetypeComponentType &&_type, ecs::ArchetypeChunkSize chunk_size_power, ecs::ArchetypeChunkLayout chunk_layout);
+  ~Archetype();
+
+  // collumns point to the chunks owned by archetype, it lives in EcsManager::archetypeMap and never moves
+  Archetype(const Archetype &) = delete;
+  Archetype &operator=(const Archetype &) = delete;
+
+  void add_chunk();
+  void release_last_chunk();
+  // stamps the chunk of all collumns, for structural changes
+  void mark_chunk_written(uint32_t chunk_idx);
+  // returns trailing chunks without entities to the allocator, at most max_chunks. Returns released chunks count
+  uint32_t release_empty_chunks(uint32_t max_chunks = UINT32_MAX);
+
+  // chunks with at least one entity, chunks after them are empty until release_empty_chunks
+  uint32_t getUsedChunkCount() const
+  {
+    return (entityCount + chunkMask) >> chunkSizePower;
+  }
+
+  // true for tags too, they have no collumn
+  bool hasComponent(ecs::ComponentId componentId) const
+  {
+    return type.find(componentId) != type.end();
+  }
+
+  uint64_t getChangeVersion() const
+  {
+    return changeVersion ? changeVersion->load(std::memory_order_relaxed) : 0u;
+  }
 
   int getComponentCollumnIndex(ecs::ComponentId componentId) const
   {
@@ -40,30 +121,78 @@ struct Archetype
     return it != componentToCollumnIndex.end() ? it->second : -1;
   }
 
+  int getDenseCollumnIndex(uint32_t dense_index) const
+  {
+    return dense_index < denseCollumnIndex.size() ? denseCollumnIndex[dense_index] : -1;
+  }
+
   int getComponentTrackedCollumnIndex(ecs::ComponentId componentId) const
   {
     auto it = componentToTrackedCollumnIndex.find(componentId);
     return it != componentToTrackedCollumnIndex.end() ? it->second : -1;
   }
 
+  std::span<const ArchetypeEventHandler> getEventHandlers(ecs::EventId event_id) const
+  {
+    auto it = eventToHandlers.find(event_id);
+    if (it == eventToHandlers.end())
+      return {};
+    return std::span<const ArchetypeEventHandler>(eventHandlers.data() + it->second.first, it->second.second);
+  }
+
+  // SoA collumns don't store component contiguously, use gatherData/scatterData for them
   char *getData(ecs_details::Collumn &collumn, uint32_t linear_index) const
   {
+    assert(collumn.soaLaneCount == 0);
     return collumn.chunks[linear_index >> chunkSizePower] + (linear_index & chunkMask) * collumn.sizeOfElement;
   }
 
   const char *getData(const ecs_details::Collumn &collumn, uint32_t linear_index) const
   {
+    assert(collumn.soaLaneCount == 0);
     return collumn.chunks[linear_index >> chunkSizePower] + (linear_index & chunkMask) * collumn.sizeOfElement;
   }
+
+  // lane k of the component i in chunk is placed at chunk + (k * chunkSize + i) * soaLaneSize
+  void gatherData(const ecs_details::Collumn &collumn, uint32_t linear_index, void *dst) const
+  {
+    const char *lane = collumn.chunks[linear_index >> chunkSizePower] + (linear_index & chunkMask) * collumn.soaLaneSize;
+    for (uint32_t k = 0; k < collumn.soaLaneCount; k++, lane += chunkSize * collumn.soaLaneSize)
+      memcpy((char *)dst + k * collumn.soaLaneSize, lane, collumn.soaLaneSize);
+  }
+
+  void scatterData(ecs_details::Collumn &collumn, uint32_t linear_index, const void *src) const
+  {
+    char *lane = collumn.chunks[linear_index >> chunkSizePower] + (linear_index & chunkMask) * collumn.soaLaneSize;
+    for (uint32_t k = 0; k < collumn.soaLaneCount; k++, lane += chunkSize * collumn.soaLaneSize)
+      memcpy(lane, (const char *)src + k * collumn.soaLaneSize, collumn.soaLaneSize);
+  }
 };
 
 // return index of the added entity
-void add_entity_to_archetype(Archetype &archetype, ecs::EcsManager &mgr, const ecs::InitializerList &template_init, ecs::InitializerList &&override_list);
+void add_entity_to_archetype(Archetype &archetype, ecs::EcsManager &mgr, const ecs::Template &template_record, ecs::EntityId eid, ecs::InitializerList &&override_list);
+void add_entity_to_archetype(Archetype &archetype, ecs::EcsManager &mgr, const ecs::Template &template_record, ecs::EntityId eid, ecs::FlatInitializerList &&override_list);
+// overrides are matched to template_record.recipe override slots by position
+void add_entity_to_archetype(Archetype &archetype, ecs::EcsManager &mgr, const ecs::Template &template_record, ecs::EntityId eid, std::span<ecs::Any> overrides);
 
 void add_entities_to_archetype(Archetype &archetype, ecs::EcsManager &mgr, const ecs::InitializerList &template_init, ecs::InitializerSoaList &&override_soa_list);
 
-void remove_entity_from_archetype(Archetype &archetype, const ecs::TypeDeclarationMap &type_map, uint32_t entityIndex);
+void remove_entity_from_archetype(Archetype &archetype, uint32_t entityIndex);
+
+// sorted_indices should be sorted and unique. Holes below the new entity count are filled by the last entities
+void remove_entities_from_archetype(Archetype &archetype, std::span<const uint32_t> sorted_indices);
+
+void destroy_all_entities_from_archetype(Archetype &archetype);
+
+// fills archetype.eventHandlers from mgr.eventIdToHandlers
+void build_event_handler_table(ecs::EcsManager &mgr, Archetype &archetype);
+
+// returns nullptr if archetype already has (or doesn't have for remove) the component
+const ArchetypeTransition *get_add_component_transition(ecs::EcsManager &mgr, Archetype &archetype, ecs::ComponentId component_id);
+const ArchetypeTransition *get_remove_component_transition(ecs::EcsManager &mgr, Archetype &archetype, ecs::ComponentId component_id);
 
-void destroy_all_entities_from_archetype(Archetype &archetype, const ecs::TypeDeclarationMap &type_map);
+// moves entity to transition.target, the added component is moved from new_component_data (default constructed for nullptr).
+// The last entity of the archetype fills the hole. Returns entity index in the target archetype
+uint32_t move_entity_to_archetype(Archetype &archetype, uint32_t entity_index, const ArchetypeTransition &transition, void *new_component_data);
 
 } // namespace ecs
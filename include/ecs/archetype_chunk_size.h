@@ -12,4 +12,10 @@ enum ArchetypeChunkSize
   TenThousands = 14,
 };
 
+enum class ArchetypeChunkLayout
+{
+  PerCollumn, // every collumn allocates own chunks
+  SingleAllocation, // one allocation per chunk contains all collumns back-to-back
+};
+
 }
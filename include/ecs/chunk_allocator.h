@@ -0,0 +1,41 @@
+#pragma once
+
+#include "ecs/config.h"
+#include <mutex>
+
+namespace ecs
+{
+
+// memory source for archetype chunks. Replace EcsManager::chunkAllocator before the first archetype is created
+struct IChunkAllocator
+{
+  virtual char *allocate(size_t size, size_t alignment) = 0;
+  virtual void deallocate(char *data, size_t size, size_t alignment) = 0;
+  virtual ~IChunkAllocator() = default;
+};
+
+// keeps freed chunks in free lists keyed by size and alignment and reuses them for the next allocations.
+// Memory is returned to the system when cached size exceeds maxCachedBytes, on release_cached or in destructor
+struct PoolChunkAllocator final : public IChunkAllocator
+{
+  // enough for a few hundreds of chunks to survive entity churn, but not the peak memory of the level
+  static constexpr size_t DEFAULT_MAX_CACHED_BYTES = size_t(16) << 20;
+  size_t maxCachedBytes = DEFAULT_MAX_CACHED_BYTES;
+
+  char *allocate(size_t size, size_t alignment) override;
+  void deallocate(char *data, size_t size, size_t alignment) override;
+
+  void release_cached();
+  size_t cached_bytes() const { return cachedBytes; }
+
+  ~PoolChunkAllocator() override;
+
+private:
+  static uint64_t get_key(size_t size, size_t alignment) { return (uint64_t(size) << 32) | uint64_t(alignment); }
+
+  std::mutex mutex;
+  ska::flat_hash_map<uint64_t, std::vector<char *>> freeLists;
+  size_t cachedBytes = 0;
+};
+
+} // namespace ecs
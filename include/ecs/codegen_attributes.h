@@ -11,11 +11,16 @@
 // attributes:
 // require - list of components that system should have, but can not query them
 // require_not - list of components that system should not have
+// stage - name of the stage, system will be performed in perform_stage
+// job - true if system can be split by archetype chunks and performed on the job scheduler
+// chunk - true if system is called once per chunk with std::span<T> (ecs::SoaView<T> for SoA types) arguments instead of once per entity
 #define ECS_SYSTEM(...) static void
 
 // attributes:
 // require - list of components that system should have, but can not query them
 // require_not - list of components that system should not have
+// job - true if query can be split by archetype chunks and performed on the job scheduler
+// chunk - true if query is called once per chunk with std::span<T> arguments, can't be combined with job
 #define ECS_QUERY(...)
 
 // attributes:
@@ -2,7 +2,10 @@
 #include "ecs/config.h"
 #include "ecs/archetype_chunk_size.h"
 #include "ecs/tiny_string.h"
+#include "ecs/type_declaration.h"
 #include <numeric> // for lcm
+#include <bit>
+#include <algorithm>
 
 namespace ecs_details
 {
@@ -10,38 +13,152 @@ namespace ecs_details
 struct Collumn
 {
   std::vector<char *> chunks;
+  const ecs::TypeDeclaration *typeDeclaration; // owned by EcsManager::typeMap
   ecs_details::tiny_string debugName;
   ecs::ComponentId componentId;
   uint32_t chunkSize;
   uint32_t sizeOfElement;
   ecs::TypeId typeId;
   uint32_t containerAlignment;
-  Collumn(ecs::ArchetypeChunkSize chunk_size_power, size_t size_of_element, size_t alignment_of_element, ecs::TypeId type_id, const char *name, ecs::ComponentId component_id) :
-    debugName(name),
+  uint32_t soaLaneCount; // 0 for the regular array of components
+  uint32_t soaLaneSize;
+  uint32_t chunkOffset = 0; // offset in the archetype chunk block for ArchetypeChunkLayout::SingleAllocation
+  std::vector<uint64_t> chunkVersions; // EcsManager::changeVersion of the last write to the chunk
+  Collumn(ecs::ArchetypeChunkSize chunk_size_power, const ecs::TypeDeclaration *type_declaration, ecs::ComponentId component_id) :
+    typeDeclaration(type_declaration),
+    debugName(type_declaration->typeName.c_str()),
     componentId(component_id),
     chunkSize(1 << chunk_size_power),
-    sizeOfElement(size_of_element),
-    typeId(type_id),
-    containerAlignment(std::lcm(chunkSize, alignment_of_element))
+    sizeOfElement(type_declaration->sizeOfElement),
+    typeId(type_declaration->typeId),
+    containerAlignment(std::lcm(chunkSize, type_declaration->alignmentOfElement)),
+    soaLaneCount(type_declaration->soaLaneCount),
+    soaLaneSize(soaLaneCount ? sizeOfElement / soaLaneCount : 0)
   {}
 
-  ~Collumn()
+  // chunks are allocated and freed by archetype through ecs::IChunkAllocator
+  uint32_t chunk_bytes() const
   {
-    for (char *data : chunks)
+    return chunkSize * sizeOfElement;
+  }
+
+};
+
+using TrackMask = uint64_t;
+static const int MAX_TRACKED_COMPONENTS = 64;
+
+// dirty bit per entity in 64 bit words and a summary bit per archetype chunk.
+// Summary bit is set with any entity bit of the chunk (it can stay set after assign(false)), so clean chunks are skipped
+struct DirtyBitset
+{
+  std::vector<uint64_t> words;
+  std::vector<uint64_t> chunkSummary;
+  uint32_t bitCount = 0;
+  uint32_t chunkSizePower = 0;
+
+  explicit DirtyBitset(uint32_t chunk_size_power) : chunkSizePower(chunk_size_power) {}
+
+  uint32_t size() const
+  {
+    return bitCount;
+  }
+
+  // new bits are clean
+  void resize(uint32_t bit_count)
+  {
+    const uint32_t chunkSize = 1u << chunkSizePower;
+    resize_bits(chunkSummary, (bitCount + chunkSize - 1) >> chunkSizePower, (bit_count + chunkSize - 1) >> chunkSizePower);
+    resize_bits(words, bitCount, bit_count);
+    bitCount = bit_count;
+  }
+
+  void set(uint32_t index)
+  {
+    words[index >> 6u] |= bit(index);
+    const uint32_t chunk = index >> chunkSizePower;
+    chunkSummary[chunk >> 6u] |= bit(chunk);
+  }
+
+  void assign(uint32_t index, bool value)
+  {
+    if (value)
+      set(index);
+    else
+      words[index >> 6u] &= ~bit(index);
+  }
+
+  bool test(uint32_t index) const
+  {
+    return (words[index >> 6u] & bit(index)) != 0u;
+  }
+
+  bool test_chunk(uint32_t chunk) const
+  {
+    return (chunkSummary[chunk >> 6u] & bit(chunk)) != 0u;
+  }
+
+  // calls callable(index) for every set bit in [begin, end)
+  template<typename Callable>
+  void for_each_set(uint32_t begin, uint32_t end, Callable &&callable) const
+  {
+    if (begin >= end)
+      return;
+    const uint32_t firstWord = begin >> 6u;
+    const uint32_t lastWord = (end - 1) >> 6u;
+    for (uint32_t w = firstWord; w <= lastWord; w++)
     {
-      operator delete[] (data, chunkSize * sizeOfElement, std::align_val_t{containerAlignment});
+      uint64_t word = words[w];
+      if (w == firstWord)
+        word &= ~uint64_t(0) << (begin & 63u);
+      if (w == lastWord && (end & 63u) != 0u)
+        word &= (uint64_t(1) << (end & 63u)) - 1u;
+      while (word != 0u)
+      {
+        callable(w * 64u + (uint32_t)std::countr_zero(word));
+        word &= word - 1u;
+      }
     }
   }
 
-  void add_chunk()
+  // touches only words of the chunks with summary bit
+  void clear()
   {
-    chunks.push_back(new (std::align_val_t{containerAlignment}) char[chunkSize * sizeOfElement]);
+    for (uint32_t s = 0, n = chunkSummary.size(); s < n; s++)
+    {
+      uint64_t summary = chunkSummary[s];
+      while (summary != 0u)
+      {
+        const uint32_t chunk = s * 64u + (uint32_t)std::countr_zero(summary);
+        summary &= summary - 1u;
+        const uint32_t begin = chunk << chunkSizePower;
+        const uint32_t end = std::min(begin + (1u << chunkSizePower), bitCount);
+        for (uint32_t w = begin >> 6u; w <= (end - 1) >> 6u; w++)
+          words[w] = 0u;
+      }
+      chunkSummary[s] = 0u;
+    }
   }
 
-};
+  void shrink_to_fit()
+  {
+    words.shrink_to_fit();
+    chunkSummary.shrink_to_fit();
+  }
 
-using TrackMask = uint32_t;
-static const int MAX_TRACKED_COMPONENTS = 32;
+private:
+  static uint64_t bit(uint32_t index)
+  {
+    return uint64_t(1) << (index & 63u);
+  }
+
+  // bits after new_count are cleared, so they are clean after the next grow
+  static void resize_bits(std::vector<uint64_t> &bits, uint32_t old_count, uint32_t new_count)
+  {
+    if (new_count < old_count && (new_count & 63u) != 0u)
+      bits[new_count >> 6u] &= (uint64_t(1) << (new_count & 63u)) - 1u;
+    bits.resize((new_count + 63u) >> 6u, 0u);
+  }
+};
 
 struct TrackedCollumn final : public Collumn
 {
@@ -51,11 +168,12 @@ struct TrackedCollumn final : public Collumn
     DIRTY_ALL = 1 << 0,
     DIRTY_SOME = 1 << 1
   };
-  std::vector<bool> dirtyState; // we assume that std::vector<bool> is a bitset
+  DirtyBitset dirtyState;
   int collumnIdx;
   uint32_t dirtyFlags = CLEAN;
-  TrackedCollumn(ecs::ArchetypeChunkSize chunk_size_power, size_t size_of_element, size_t alignment_of_element, ecs::TypeId type_id, const char *name, ecs::ComponentId component_id, int collumn_idx) :
-    Collumn(chunk_size_power, size_of_element, alignment_of_element, type_id, name, component_id), collumnIdx(collumn_idx)
+  bool isDigest = false; // stores uint64_t hash_value per entity, type_declaration describes the digest then
+  TrackedCollumn(ecs::ArchetypeChunkSize chunk_size_power, const ecs::TypeDeclaration *type_declaration, ecs::ComponentId component_id, int collumn_idx, bool is_digest) :
+    Collumn(chunk_size_power, type_declaration, component_id), dirtyState(chunk_size_power), collumnIdx(collumn_idx), isDigest(is_digest)
   {}
   void mark_dirty()
   {
@@ -63,13 +181,13 @@ struct TrackedCollumn final : public Collumn
   }
   void mark_dirty(uint32_t index)
   {
-    dirtyState[index] = true;
+    dirtyState.set(index);
     dirtyFlags |= DIRTY_SOME;
   }
   void reset_dirty()
   {
     dirtyFlags = CLEAN;
-    dirtyState.assign(dirtyState.size(), false);
+    dirtyState.clear();
   }
 };
 
@@ -12,6 +12,15 @@ struct ComponentDeclaration
   ecs_details::tiny_string name;
   ComponentId componentId; // hash(hash(type), hash(name))
   TypeId typeId;
+  uint32_t denseIndex; // sequential index in registration order, bit of ecs_details::ComponentMask
+};
+
+// component id with resolved denseIndex, random access by handle doesn't look into EcsManager::componentMap.
+// Resolve it once with get_component_handle and keep it
+struct ComponentHandle
+{
+  ComponentId componentId = 0;
+  uint32_t denseIndex = UINT32_MAX; // UINT32_MAX if component wasn't registered on resolve, it is resolved on every access then
 };
 
 inline constexpr ComponentId get_component_id(TypeId typeId, NameHash component_name)
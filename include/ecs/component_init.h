@@ -122,6 +122,13 @@ namespace ecs
 
   static_assert(sizeof(ComponentInit) == 64);
 
+  // value for positional overrides of create_entity_sync, component is defined by the template override slot
+  template<typename ValueType, typename T = std::remove_cvref<ValueType>::type>
+  ecs::Any make_override(ValueType &&value)
+  {
+    return ecs::Any(T(std::forward<ValueType>(value)), ecs::TypeInfo<T>::typeId, ComponentId());
+  }
+
   struct ComponentSoaInit final : public ComponentDataSoa
   {
     ComponentId componentId;
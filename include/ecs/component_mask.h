@@ -0,0 +1,55 @@
+#pragma once
+#include "ecs/config.h"
+#include <algorithm>
+
+namespace ecs_details
+{
+
+// bitset over ComponentDeclaration::denseIndex, masks of different length are compared as if padded by zeros.
+// Word loops are branchless to let compiler vectorize them
+struct ComponentMask
+{
+  std::vector<uint64_t> words;
+
+  void set(uint32_t index)
+  {
+    const uint32_t word = index >> 6u;
+    if (word >= words.size())
+      words.resize(word + 1, 0u);
+    words[word] |= uint64_t(1) << (index & 63u);
+  }
+
+  bool test(uint32_t index) const
+  {
+    const uint32_t word = index >> 6u;
+    return word < words.size() && (words[word] & (uint64_t(1) << (index & 63u))) != 0u;
+  }
+
+  // all bits of other are set in this
+  bool contains(const ComponentMask &other) const
+  {
+    const size_t common = std::min(words.size(), other.words.size());
+    uint64_t missing = 0u;
+    for (size_t i = 0; i < common; i++)
+      missing |= other.words[i] & ~words[i];
+    for (size_t i = common; i < other.words.size(); i++)
+      missing |= other.words[i];
+    return missing == 0u;
+  }
+
+  bool intersects(const ComponentMask &other) const
+  {
+    const size_t common = std::min(words.size(), other.words.size());
+    uint64_t shared = 0u;
+    for (size_t i = 0; i < common; i++)
+      shared |= other.words[i] & words[i];
+    return shared != 0u;
+  }
+
+  void clear()
+  {
+    words.clear();
+  }
+};
+
+} // namespace ecs_details
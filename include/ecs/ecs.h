@@ -3,6 +3,7 @@
 #include "ecs_manager.h"
 #include "ecs/type_declaration_helper.h"
 #include "ecs/builtin_events.h"
+#include "ecs/soa_view.h"
 #include "codegen_attributes.h"
 
 namespace ecs
@@ -14,18 +15,65 @@ void register_all_type_declarations(ecs::EcsManager &mgr);
 
 void sort_systems(EcsManager &mgr);
 void init_singletons(EcsManager &mgr);
+// worker_count = -1 means std::thread::hardware_concurrency() - 1
+void init_job_scheduler(EcsManager &mgr, int worker_count = -1);
 
 ecs::EntityId create_entity_sync(EcsManager &mgr, TemplateId templateId, InitializerList &&init_list = InitializerList(InitializerList::Empty{}));
 ecs::EntityId create_entity(EcsManager &mgr, TemplateId templateId, InitializerList &&init_list = InitializerList(InitializerList::Empty{}));
+// the same as above, but overrides are stored without hashing and per component heap allocations
+ecs::EntityId create_entity_sync(EcsManager &mgr, TemplateId templateId, FlatInitializerList &&init_list);
+ecs::EntityId create_entity(EcsManager &mgr, TemplateId templateId, FlatInitializerList &&init_list);
+// overrides are moved to the components listed in TemplateInit::overrideSlots, in the same order. Skips all hash lookups
+ecs::EntityId create_entity_sync(EcsManager &mgr, TemplateId templateId, std::span<ecs::Any> overrides);
 
 std::vector<EntityId> create_entities_sync(EcsManager &mgr, TemplateId templateId, InitializerSoaList &&init_soa_list);
 std::vector<EntityId> create_entities(EcsManager &mgr, TemplateId templateId, InitializerSoaList &&init_soa_list);
 
 bool destroy_entity_sync(EcsManager &mgr, ecs::EntityId eid);
 void destroy_entity(EcsManager &mgr, ecs::EntityId eid);
+// OnDisappear is dispatched once per archetype, archetype collumns are compacted in one pass.
+// OnDisappear handlers should use destroy_entity instead of destroy_entity_sync
+void destroy_entities_sync(EcsManager &mgr, std::span<const ecs::EntityId> eids);
 
 void destroy_entities(EcsManager &mgr);
 
+// move entity to the archetype with/without the component, transitions between archetypes are cached.
+// OnAppear/OnDisappear are not sent. add_component for the existing component replaces its value
+bool add_component_sync(EcsManager &mgr, EntityId eid, ComponentInit &&component);
+bool remove_component_sync(EcsManager &mgr, EntityId eid, ComponentId component_id);
+// applied in perform_delayed_entities_creation after entities creation
+void add_component(EcsManager &mgr, EntityId eid, ComponentInit &&component);
+void remove_component(EcsManager &mgr, EntityId eid, ComponentId component_id);
+
+template<typename ValueType, typename T = std::remove_cvref<ValueType>::type>
+bool add_component_sync(EcsManager &mgr, EntityId eid, const char *component_name, ValueType &&value)
+{
+  return add_component_sync(mgr, eid, ComponentInit(mgr, component_name, T(std::forward<ValueType>(value))));
+}
+
+template<typename ValueType, typename T = std::remove_cvref<ValueType>::type>
+void add_component(EcsManager &mgr, EntityId eid, const char *component_name, ValueType &&value)
+{
+  add_component(mgr, eid, ComponentInit(mgr, component_name, T(std::forward<ValueType>(value))));
+}
+
+template<typename T>
+bool remove_component_sync(EcsManager &mgr, EntityId eid, const char *component_name)
+{
+  return remove_component_sync(mgr, eid, get_component_id(TypeInfo<T>::typeId, component_name));
+}
+
+template<typename T>
+void remove_component(EcsManager &mgr, EntityId eid, const char *component_name)
+{
+  remove_component(mgr, eid, get_component_id(TypeInfo<T>::typeId, component_name));
+}
+
+// returns trailing empty chunks of archetypes to mgr.chunkAllocator until budget_us microseconds are spent,
+// at least one chunk is released if there is any. The next call continues from the archetype where the previous one stopped.
+// Returns released chunks count
+uint32_t shrink_archetypes(EcsManager &mgr, uint32_t budget_us, bool shrink_tracked_bitsets = true);
+
 void track_changes(ecs::EcsManager &mgr);
 
 void perform_delayed_entities_creation(EcsManager &mgr);
@@ -80,41 +128,192 @@ void send_event(EcsManager &mgr, ecs::EntityId eid, T &&event)
   mgr.delayedEvents.push_back(std::move(delayedEvent));
 }
 
+// Thread safe versions of create_entity, destroy_entity and send_event for the jobs of mgr.jobScheduler
+// (and the main thread). Commands are recorded to the buffer of the current thread and merged in order
+// of thread index (or CommandKey with mgr.deterministicCommands), destruction is applied after creation of all recorded entities.
+// With mgr.deterministicCommands created entity ids are provisional: *_mt commands accept them,
+// resolve_entity returns the real id until the next perform_delayed_entities_creation.
+// Provisional id is derived from CommandKey and mgr.commandMergeCount, so it is the same for the same history
+ecs::EntityId create_entity_mt(EcsManager &mgr, TemplateId templateId, FlatInitializerList &&init_list = FlatInitializerList());
+void destroy_entity_mt(EcsManager &mgr, ecs::EntityId eid);
+// real id for provisional one, other ids are returned as is
+ecs::EntityId resolve_entity(const EcsManager &mgr, ecs::EntityId eid);
+
+// buffer of the current thread
+EcsManager::CommandBuffer &get_command_buffer(EcsManager &mgr);
+// CommandScope::next_key, checks that jobs record deterministic commands inside of scopes
+CommandKey next_command_key(const EcsManager &mgr);
+
+template <typename T>
+void send_event_mt(EcsManager &mgr, T &&event)
+{
+  static_assert(std::is_rvalue_reference<decltype(event)>::value);
+  EcsManager::DelayedEvent delayedEvent;
+  delayedEvent.eventData = ecs::Any(std::move(event), ecs::EventInfo<T>::eventId, 0u);
+  delayedEvent.broadcastEvent = true;
+  EcsManager::CommandBuffer &buffer = get_command_buffer(mgr);
+  buffer.events.push_back(std::move(delayedEvent));
+  buffer.eventKeys.push_back(next_command_key(mgr));
+}
+
+template <typename T>
+void send_event_mt(EcsManager &mgr, ecs::EntityId eid, T &&event)
+{
+  static_assert(std::is_rvalue_reference<decltype(event)>::value);
+  EcsManager::DelayedEvent delayedEvent;
+  delayedEvent.eventData = ecs::Any(std::move(event), ecs::EventInfo<T>::eventId, 0u);
+  delayedEvent.broadcastEvent = false;
+  delayedEvent.entityId = eid;
+  EcsManager::CommandBuffer &buffer = get_command_buffer(mgr);
+  buffer.events.push_back(std::move(delayedEvent));
+  buffer.eventKeys.push_back(next_command_key(mgr));
+}
+
+ComponentHandle get_component_handle(const EcsManager &mgr, ComponentId componentId);
+
+template <typename T>
+ComponentHandle get_component_handle(const EcsManager &mgr, const char *component_name)
+{
+  return get_component_handle(mgr, get_component_id(TypeInfo<T>::typeId, component_name));
+}
+
 const void *get_component(EcsManager &mgr, EntityId eid, ComponentId componentId);
 void *get_rw_component(EcsManager &mgr, EntityId eid, ComponentId componentId);
+const void *get_component(EcsManager &mgr, EntityId eid, ComponentHandle component);
+void *get_rw_component(EcsManager &mgr, EntityId eid, ComponentHandle component);
+// works for tags too, they have no data to get
+bool has_component(EcsManager &mgr, EntityId eid, ComponentId componentId);
+bool has_component(EcsManager &mgr, EntityId eid, ComponentHandle component);
+
+template <typename T>
+bool has_component(EcsManager &mgr, EntityId eid, const char *component_name)
+{
+  return has_component(mgr, eid, get_component_id(TypeInfo<T>::typeId, component_name));
+}
+
+// SoA components don't have address, they are copied lane by lane
+bool read_soa_component(EcsManager &mgr, EntityId eid, ComponentId componentId, void *dst);
+bool write_soa_component(EcsManager &mgr, EntityId eid, ComponentId componentId, const void *src);
+bool read_soa_component(EcsManager &mgr, EntityId eid, ComponentHandle component, void *dst);
+bool write_soa_component(EcsManager &mgr, EntityId eid, ComponentHandle component, const void *src);
+
+template <typename T>
+bool read_soa_component(EcsManager &mgr, EntityId eid, const char *component_name, T &value)
+{
+  static_assert(TypeInfo<T>::soaLaneCount != 0);
+  return read_soa_component(mgr, eid, get_component_id(TypeInfo<T>::typeId, component_name), &value);
+}
+
+template <typename T>
+bool read_soa_component(EcsManager &mgr, EntityId eid, ComponentHandle component, T &value)
+{
+  static_assert(TypeInfo<T>::soaLaneCount != 0);
+  assert(get_type_id(component.componentId) == TypeInfo<T>::typeId);
+  return read_soa_component(mgr, eid, component, &value);
+}
+
+template <typename T>
+const T *get_component(EcsManager &mgr, EntityId eid, ComponentHandle component)
+{
+  static_assert(TypeInfo<T>::soaLaneCount == 0, "use read_soa_component for SoA components");
+  assert(get_type_id(component.componentId) == TypeInfo<T>::typeId);
+  return static_cast<const T *>(get_component(mgr, eid, component));
+}
+
+template <typename T>
+T *get_rw_component(EcsManager &mgr, EntityId eid, ComponentHandle component)
+{
+  static_assert(TypeInfo<T>::soaLaneCount == 0, "use set_component for SoA components");
+  assert(get_type_id(component.componentId) == TypeInfo<T>::typeId);
+  return static_cast<T *>(get_rw_component(mgr, eid, component));
+}
 
 template <typename T>
 const T *get_component(EcsManager &mgr, EntityId eid, const char *component_name)
 {
+  static_assert(TypeInfo<T>::soaLaneCount == 0, "use read_soa_component for SoA components");
   return static_cast<const T *>(get_component(mgr, eid, get_component_id(TypeInfo<T>::typeId, component_name)));
 }
 
 template <typename T>
 T *get_rw_component(EcsManager &mgr, EntityId eid, const char *component_name)
 {
+  static_assert(TypeInfo<T>::soaLaneCount == 0, "use set_component for SoA components");
   return static_cast<T *>(get_rw_component(mgr, eid, get_component_id(TypeInfo<T>::typeId, component_name)));
 }
 
 template <typename T>
 bool set_component(EcsManager &mgr, EntityId eid, const char *component_name, T &&value)
 {
-  T *component = get_rw_component<T>(mgr, eid, component_name);
-  if (component)
+  if constexpr (TypeInfo<T>::soaLaneCount != 0)
   {
-    *component = std::move(value);
+    return write_soa_component(mgr, eid, get_component_id(TypeInfo<T>::typeId, component_name), &value);
+  }
+  else
+  {
+    T *component = get_rw_component<T>(mgr, eid, component_name);
+    if (component)
+    {
+      *component = std::move(value);
+    }
+    return component != nullptr;
   }
-  return component != nullptr;
 }
 
 template <typename T>
 bool set_component(EcsManager &mgr, EntityId eid, const char *component_name, const T &value)
 {
-  T *component = get_rw_component<T>(mgr, eid, component_name);
-  if (component)
+  if constexpr (TypeInfo<T>::soaLaneCount != 0)
+  {
+    return write_soa_component(mgr, eid, get_component_id(TypeInfo<T>::typeId, component_name), &value);
+  }
+  else
+  {
+    T *component = get_rw_component<T>(mgr, eid, component_name);
+    if (component)
+    {
+      *component = value;
+    }
+    return component != nullptr;
+  }
+}
+
+template <typename T>
+bool set_component(EcsManager &mgr, EntityId eid, ComponentHandle component, T &&value)
+{
+  if constexpr (TypeInfo<T>::soaLaneCount != 0)
+  {
+    assert(get_type_id(component.componentId) == TypeInfo<T>::typeId);
+    return write_soa_component(mgr, eid, component, &value);
+  }
+  else
+  {
+    T *data = get_rw_component<T>(mgr, eid, component);
+    if (data)
+    {
+      *data = std::move(value);
+    }
+    return data != nullptr;
+  }
+}
+
+template <typename T>
+bool set_component(EcsManager &mgr, EntityId eid, ComponentHandle component, const T &value)
+{
+  if constexpr (TypeInfo<T>::soaLaneCount != 0)
+  {
+    assert(get_type_id(component.componentId) == TypeInfo<T>::typeId);
+    return write_soa_component(mgr, eid, component, &value);
+  }
+  else
   {
-    *component = value;
+    T *data = get_rw_component<T>(mgr, eid, component);
+    if (data)
+    {
+      *data = value;
+    }
+    return data != nullptr;
   }
-  return component != nullptr;
 }
 
 }
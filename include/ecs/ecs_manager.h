@@ -11,10 +11,43 @@
 #include "ecs/event.h"
 #include "ecs/singleton_component.h"
 #include "ecs/logger.h"
+#include "ecs/job_scheduler.h"
+#include "ecs/chunk_allocator.h"
 
 namespace ecs
 {
 
+// key of the command recorded by *_mt functions, EcsManager::deterministicCommands orders merged commands by it
+struct CommandKey
+{
+  uint64_t source = 0;
+  uint32_t sequence = 0;
+  bool operator<(const CommandKey &other) const
+  {
+    return source != other.source ? source < other.source : sequence < other.sequence;
+  }
+};
+
+// commands recorded by the current thread inside of the scope get keys (source, local sequence number).
+// Systems open the scope with their name hash, job systems and parallel queries open one scope per job
+struct CommandScope
+{
+  explicit CommandScope(uint64_t source);
+  ~CommandScope();
+  CommandScope(const CommandScope &) = delete;
+  CommandScope &operator=(const CommandScope &) = delete;
+
+  static uint64_t current_source();
+  // stable source for the job_idx-th job started from the parent_source scope
+  static uint64_t job_source(uint64_t parent_source, uint32_t job_idx);
+  // source (name hash of query) opened inside of the parent_source scope, source itself without parent scope
+  static uint64_t nested_source(uint64_t parent_source, uint64_t source);
+  static CommandKey next_key();
+
+private:
+  CommandKey previous;
+};
+
 struct EcsManager
 {
   using ComponentDeclarationMap = ska::flat_hash_map<ComponentId, std::unique_ptr<ComponentDeclaration>>;
@@ -29,11 +62,13 @@ struct EcsManager
     bool broadcastEvent;
   };
 
+  // delayedEntities and delayedFlatEntities are created together in order of sequence (order of create_entity calls)
   struct DelayedEntity
   {
     InitializerList initList;
     ecs::EntityId eid;
     TemplateId templateId;
+    uint32_t sequence = 0;
     DelayedEntity(TemplateId _templateId, ecs::EntityId _eid, InitializerList &&_initList) : initList(std::move(_initList)), eid(_eid), templateId(_templateId) {}
     DelayedEntity(const DelayedEntity &) = delete;
     DelayedEntity &operator=(const DelayedEntity &) = delete;
@@ -41,6 +76,36 @@ struct EcsManager
     DelayedEntity &operator=(DelayedEntity &&) = default;
   };
 
+  struct DelayedFlatEntity
+  {
+    FlatInitializerList initList;
+    ecs::EntityId eid;
+    TemplateId templateId;
+    uint32_t sequence = 0;
+    DelayedFlatEntity(TemplateId _templateId, ecs::EntityId _eid, FlatInitializerList &&_initList) : initList(std::move(_initList)), eid(_eid), templateId(_templateId) {}
+  };
+
+  // structural changes recorded by one thread, merged in order of thread index
+  // in perform_delayed_entities_creation and perform_delayed_events
+  struct alignas(64) CommandBuffer
+  {
+    std::vector<DelayedFlatEntity> createdEntities; // entity ids are reserved
+    std::vector<ecs::EntityId> destroyedEntities;
+    std::vector<DelayedEvent> events;
+    // parallel to the commands above
+    std::vector<CommandKey> createdEntityKeys;
+    std::vector<CommandKey> destroyedEntityKeys;
+    std::vector<CommandKey> eventKeys;
+  };
+
+  struct DelayedComponentChange
+  {
+    ecs::EntityId eid;
+    ecs::ComponentId componentId;
+    ecs::Any value; // empty for remove_component
+    bool remove;
+  };
+
   struct DelayedEntitySoa
   {
     TemplateId templateId;
@@ -48,22 +113,34 @@ struct EcsManager
     InitializerSoaList initSoaList;
   };
 
+  // declared before archetypeMap, archetypes return chunks to it on destruction
+  std::unique_ptr<ecs::IChunkAllocator> chunkAllocator;
   TypeDeclarationMap typeMap;
   ComponentDeclarationMap componentMap;
   ArchetypeMap archetypeMap;
+  std::vector<ecs_details::Archetype *> archetypeList; // the same archetypes in creation order, indices are stable
   ska::flat_hash_map<NameHash, Query> queries;
   ska::flat_hash_map<NameHash, std::vector<System>> systems;
+  ska::flat_hash_map<NameHash, StageExecutionPlan> stagePlans;
   ska::flat_hash_map<NameHash, EventHandler> events;
   ska::flat_hash_map<EventId, std::vector<NameHash>> eventIdToHandlers;
   std::vector<DelayedEvent> delayedEvents;
   std::vector<DelayedEntity> delayedEntities;
   std::vector<ecs::InitializerList::type> initializersPool;
+  // payloads are stored inline, capacity is reused between frames
+  std::vector<DelayedFlatEntity> delayedFlatEntities;
+  uint32_t delayedEntitySequence = 0;
 
   std::vector<DelayedEntitySoa> delayedEntitiesSoa;
   std::vector<ecs::EntityId> delayedEntitiesDestroy;
+  std::vector<DelayedComponentChange> delayedComponentChanges;
   ecs_details::EntityContainer entityContainer;
   TemplatesMap templates;
   SingletonComponentsMap singletons;
+  uint32_t shrinkArchetypeCursor = 0; // archetype index in archetypeList for the next shrink_archetypes
+  // written chunks are stamped with it (Collumn::chunkVersions), every system run takes a new version.
+  // 64 bit, so it doesn't wrap and stale chunks never look newer than the last run
+  std::atomic<uint64_t> changeVersion = 1;
 
 
   ecs::TypeId EntityIdTypeId;
@@ -71,6 +148,16 @@ struct EcsManager
 
   ecs::LogLevel currentLogLevel = ecs::LogLevel::Verbose;
   std::unique_ptr<ecs::ILogger> logger;
+  std::unique_ptr<ecs_details::JobScheduler> jobScheduler;
+  // indexed by JobScheduler::current_queue_index, buffer 0 is used by the main thread
+  std::vector<std::unique_ptr<CommandBuffer>> commandBuffers;
+  // merge commands of all buffers sorted by CommandKey instead of thread order, for lockstep simulation and replays.
+  // create_entity_mt returns provisional ids then, real indices are allocated on merge in CommandKey order
+  bool deterministicCommands = false;
+  // merges of created entities, provisional ids are derived from it and CommandKey, so ids of the previous merges don't resolve
+  uint32_t commandMergeCount = 0;
+  // provisional number -> real entity, filled by the last merge of created entities
+  ska::flat_hash_map<uint32_t, ecs::EntityId> provisionalEntities;
 
   EcsManager();
 
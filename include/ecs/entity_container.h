@@ -1,5 +1,6 @@
 #pragma once
 #include "ecs/entity_id.h"
+#include <atomic>
 
 namespace ecs_details
 {
@@ -11,9 +12,11 @@ namespace ecs_details
     AsyncDestroy,
   };
 
+  struct Archetype;
+
   struct EntityRecord
   {
-    ecs::ArchetypeId archetypeId;
+    Archetype *archetype; // archetypes are never destroyed, so random access by eid doesn't go through archetypeMap
     uint32_t componentIndex;
     uint32_t generation;
     EntityState entityState;
@@ -23,15 +26,18 @@ namespace ecs_details
   {
     std::vector<EntityRecord> entityRecords;
     std::vector<int> freeIndices;
+    // new indices are taken from this counter, so they can be reserved from any thread.
+    // entityRecords can be shorter than nextEntityIndex until reserved entities are activated
+    std::atomic<uint32_t> nextEntityIndex = 0;
 
     ecs::EntityId allocate_entity(EntityState entity_state)
     {
       ecs::EntityId entityId;
       if (freeIndices.empty())
       {
-        entityId.entityIndex = entityRecords.size();
+        entityId.entityIndex = nextEntityIndex.fetch_add(1, std::memory_order_relaxed);
         entityId.generation = 0;
-        entityRecords.push_back({ecs::ArchetypeId{0}, 0u, entityId.generation, entity_state});
+        activate_reserved_entity(entityId, entity_state);
       }
       else
       {
@@ -39,7 +45,7 @@ namespace ecs_details
         freeIndices.pop_back();
         uint32_t generation = entityRecords[entityId.entityIndex].generation;
         entityId.generation = generation;
-        entityRecords[entityId.entityIndex] = {ecs::ArchetypeId{0}, 0u, generation, entity_state};
+        entityRecords[entityId.entityIndex] = {nullptr, 0u, generation, entity_state};
       }
       return entityId;
     }
@@ -48,16 +54,37 @@ namespace ecs_details
     std::vector<ecs::EntityId> allocate_entities(uint32_t count, EntityState entity_state)
     {
       std::vector<ecs::EntityId> entityIds(count);
+      const uint32_t firstIndex = nextEntityIndex.fetch_add(count, std::memory_order_relaxed);
+      entityRecords.resize(firstIndex + count);
       for (uint32_t i = 0; i < count; i++)
       {
         const uint32_t generation = 0u;
-        entityIds[i].entityIndex = entityRecords.size();
+        entityIds[i].entityIndex = firstIndex + i;
         entityIds[i].generation = generation;
-        entityRecords.push_back({ecs::ArchetypeId{0}, 0u, generation, entity_state});
+        entityRecords[firstIndex + i] = {nullptr, 0u, generation, entity_state};
       }
       return entityIds;
     }
 
+    // thread safe, entity stays dead until activate_reserved_entity is called from the main thread
+    ecs::EntityId reserve_entity()
+    {
+      ecs::EntityId entityId;
+      entityId.entityIndex = nextEntityIndex.fetch_add(1, std::memory_order_relaxed);
+      entityId.generation = 0;
+      return entityId;
+    }
+
+    void activate_reserved_entity(ecs::EntityId entityId, EntityState entity_state)
+    {
+      if (entityId.entityIndex >= entityRecords.size())
+      {
+        // skipped records are dead entities reserved by other threads
+        entityRecords.resize(entityId.entityIndex + 1, {nullptr, 0u, 0u, EntityState::Dead});
+      }
+      entityRecords[entityId.entityIndex] = {nullptr, 0u, entityId.generation, entity_state};
+    }
+
 
     bool can_access(ecs::EntityId entityId) const
     {
@@ -77,7 +104,7 @@ namespace ecs_details
 
     void destroy_entity(ecs::EntityId entityId)
     {
-      if (is_alive(entityId))
+      if (is_alive(entityId) || can_access(entityId))
       {
         entityRecords[entityId.entityIndex].generation = (entityRecords[entityId.entityIndex].generation + 1) & ecs::EntityId::GENERATIONS_MASK;
         entityRecords[entityId.entityIndex].entityState = EntityState::Dead;
@@ -102,23 +129,42 @@ namespace ecs_details
       return false;
     }
 
-    bool get(ecs::EntityId entityId, ecs::ArchetypeId &archetypeId, uint32_t &componentIndex) const
+    bool get(ecs::EntityId entityId, Archetype *&archetype, uint32_t &componentIndex) const
     {
       if (can_access(entityId))
       {
         const EntityRecord &entityRecord = entityRecords[entityId.entityIndex];
-        archetypeId = entityRecord.archetypeId;
+        archetype = entityRecord.archetype;
         componentIndex = entityRecord.componentIndex;
         return true;
       }
       return false;
     }
 
-    bool mutate(ecs::EntityId entityId, ecs::ArchetypeId archetypeId, uint32_t componentIndex)
+    // entity was moved inside of the archetype
+    void relocate(ecs::EntityId entityId, uint32_t componentIndex)
+    {
+      if (can_access(entityId))
+      {
+        entityRecords[entityId.entityIndex].componentIndex = componentIndex;
+      }
+    }
+
+    // entity was moved to the other archetype
+    void relocate(ecs::EntityId entityId, Archetype *archetype, uint32_t componentIndex)
+    {
+      if (can_access(entityId))
+      {
+        entityRecords[entityId.entityIndex].archetype = archetype;
+        entityRecords[entityId.entityIndex].componentIndex = componentIndex;
+      }
+    }
+
+    bool mutate(ecs::EntityId entityId, Archetype *archetype, uint32_t componentIndex)
     {
       if (is_alive(entityId))
       {
-        entityRecords[entityId.entityIndex].archetypeId = archetypeId;
+        entityRecords[entityId.entityIndex].archetype = archetype;
         entityRecords[entityId.entityIndex].componentIndex = componentIndex;
         entityRecords[entityId.entityIndex].entityState = EntityState::Alive;
         return true;
@@ -0,0 +1,243 @@
+#pragma once
+#include "ecs/config.h"
+#include "ecs/component_init.h"
+#include <algorithm>
+#include <new>
+#include <string.h>
+
+namespace ecs
+{
+  // Alternative to InitializerList without hashing: components are kept in the array sorted by component id,
+  // payloads are placed one after another in the bump arena. Both live inline while they fit in
+  // INLINE_COMPONENTS and INLINE_ARENA_SIZE, otherwise they grow to the heap once per overflow (not per component)
+  struct FlatInitializerList
+  {
+    static constexpr uint32_t INLINE_COMPONENTS = 8;
+    static constexpr uint32_t INLINE_ARENA_SIZE = 256;
+    static constexpr uint32_t ARENA_ALIGNMENT = 32;
+
+    struct PayloadOps
+    {
+      void (*relocate)(void *dst, void *src); // move construct to dst and destroy src
+      void (*destruct)(void *data);
+    };
+
+    template<typename T>
+    struct PayloadOpsInstance
+    {
+      static void relocate(void *dst, void *src)
+      {
+        new (dst) T(std::move(*(T *)src));
+        ((T *)src)->~T();
+      }
+      static void destruct(void *data)
+      {
+        ((T *)data)->~T();
+      }
+      static constexpr PayloadOps ops = {relocate, destruct};
+    };
+
+    struct Entry
+    {
+      ComponentId componentId;
+      TypeId typeId;
+      uint32_t offset; // in the arena
+      const PayloadOps *ops;
+    };
+
+    FlatInitializerList() = default;
+
+    FlatInitializerList(FlatInitializerList &&other)
+    {
+      steal(other);
+    }
+
+    FlatInitializerList &operator=(FlatInitializerList &&other)
+    {
+      if (this != &other)
+      {
+        clear();
+        release_heap();
+        steal(other);
+      }
+      return *this;
+    }
+
+    FlatInitializerList(const FlatInitializerList &) = delete;
+    FlatInitializerList &operator=(const FlatInitializerList &) = delete;
+
+    ~FlatInitializerList()
+    {
+      clear();
+      release_heap();
+    }
+
+    template<typename ValueType, typename T = std::remove_cvref<ValueType>::type>
+    void push_back(ComponentId component_id, ValueType &&value)
+    {
+      static_assert(alignof(T) <= ARENA_ALIGNMENT);
+      Entry *it = std::lower_bound(entries, entries + count, component_id, [](const Entry &e, ComponentId id) { return e.componentId < id; });
+      const bool duplicate = it != entries + count && it->componentId == component_id;
+      if (duplicate && it->typeId == ecs::TypeInfo<T>::typeId)
+      {
+        // the same type, payload is replaced in place
+        T *payload = (T *)(arena + it->offset);
+        T newValue(std::forward<ValueType>(value));
+        payload->~T();
+        new (payload) T(std::move(newValue));
+        return;
+      }
+      uint32_t offset = (arenaSize + alignof(T) - 1) & ~(uint32_t)(alignof(T) - 1);
+      if (offset + sizeof(T) > arenaCapacity)
+      {
+        grow_arena(offset + sizeof(T));
+      }
+      new (arena + offset) T(std::forward<ValueType>(value));
+      arenaSize = offset + sizeof(T);
+
+      Entry entry{component_id, ecs::TypeInfo<T>::typeId, offset, &PayloadOpsInstance<T>::ops};
+      if (duplicate)
+      {
+        // payload of the other type stays in the arena until clear
+        it->ops->destruct(arena + it->offset);
+        *it = entry;
+        return;
+      }
+      uint32_t position = it - entries;
+      if (count == entriesCapacity)
+      {
+        grow_entries();
+      }
+      memmove(entries + position + 1, entries + position, (count - position) * sizeof(Entry));
+      entries[position] = entry;
+      count++;
+    }
+
+    template<typename ValueType, typename T = std::remove_cvref<ValueType>::type>
+    void push_back(const char *component_name, ValueType &&value)
+    {
+      push_back(get_component_id(ecs::TypeInfo<T>::typeId, component_name), std::forward<ValueType>(value));
+    }
+
+    const Entry *find(ComponentId component_id) const
+    {
+      const Entry *it = std::lower_bound(entries, entries + count, component_id, [](const Entry &e, ComponentId id) { return e.componentId < id; });
+      return it != entries + count && it->componentId == component_id ? it : nullptr;
+    }
+
+    void *data(const Entry &entry)
+    {
+      return arena + entry.offset;
+    }
+
+    uint32_t size() const
+    {
+      return count;
+    }
+
+    bool empty() const
+    {
+      return count == 0;
+    }
+
+    // destroys payloads, keeps grown storage for reuse
+    void clear()
+    {
+      for (uint32_t i = 0; i < count; i++)
+      {
+        entries[i].ops->destruct(arena + entries[i].offset);
+      }
+      count = 0;
+      arenaSize = 0;
+    }
+
+  private:
+    Entry inlineEntries[INLINE_COMPONENTS];
+    alignas(ARENA_ALIGNMENT) char inlineArena[INLINE_ARENA_SIZE];
+    Entry *entries = inlineEntries;
+    char *arena = inlineArena;
+    uint32_t count = 0;
+    uint32_t entriesCapacity = INLINE_COMPONENTS;
+    uint32_t arenaSize = 0;
+    uint32_t arenaCapacity = INLINE_ARENA_SIZE;
+
+    void grow_arena(uint32_t required_size)
+    {
+      uint32_t newCapacity = std::max(arenaCapacity * 2, required_size);
+      char *newArena = (char *)::operator new(newCapacity, std::align_val_t(ARENA_ALIGNMENT));
+      // offsets are kept, so entries stay valid
+      for (uint32_t i = 0; i < count; i++)
+      {
+        entries[i].ops->relocate(newArena + entries[i].offset, arena + entries[i].offset);
+      }
+      if (arena != inlineArena)
+      {
+        ::operator delete(arena, std::align_val_t(ARENA_ALIGNMENT));
+      }
+      arena = newArena;
+      arenaCapacity = newCapacity;
+    }
+
+    void grow_entries()
+    {
+      Entry *newEntries = new Entry[entriesCapacity * 2];
+      memcpy(newEntries, entries, count * sizeof(Entry));
+      if (entries != inlineEntries)
+      {
+        delete[] entries;
+      }
+      entries = newEntries;
+      entriesCapacity *= 2;
+    }
+
+    void release_heap()
+    {
+      if (arena != inlineArena)
+      {
+        ::operator delete(arena, std::align_val_t(ARENA_ALIGNMENT));
+        arena = inlineArena;
+        arenaCapacity = INLINE_ARENA_SIZE;
+      }
+      if (entries != inlineEntries)
+      {
+        delete[] entries;
+        entries = inlineEntries;
+        entriesCapacity = INLINE_COMPONENTS;
+      }
+    }
+
+    // expects empty this with inline storage
+    void steal(FlatInitializerList &other)
+    {
+      if (other.entries != other.inlineEntries)
+      {
+        entries = other.entries;
+        entriesCapacity = other.entriesCapacity;
+      }
+      else
+      {
+        memcpy(entries, other.entries, other.count * sizeof(Entry));
+      }
+      if (other.arena != other.inlineArena)
+      {
+        arena = other.arena;
+        arenaCapacity = other.arenaCapacity;
+      }
+      else
+      {
+        for (uint32_t i = 0; i < other.count; i++)
+        {
+          other.entries[i].ops->relocate(arena + other.entries[i].offset, other.arena + other.entries[i].offset);
+        }
+      }
+      count = other.count;
+      arenaSize = other.arenaSize;
+      other.entries = other.inlineEntries;
+      other.entriesCapacity = INLINE_COMPONENTS;
+      other.arena = other.inlineArena;
+      other.arenaCapacity = INLINE_ARENA_SIZE;
+      other.count = 0;
+      other.arenaSize = 0;
+    }
+  };
+} // namespace ecs
@@ -2,6 +2,7 @@
 
 #include "ecs/config.h"
 #include "ecs/ecs_manager.h"
+#include "ecs/soa_view.h"
 
 namespace ecs_details
 {
@@ -16,7 +17,11 @@ struct PrtWrapper
   T *operator[](int idx) { return ptr ? ptr + idx : ptr; }
   void operator++() { ptr = ptr ? ptr + 1 : ptr; }
 
-  static PrtWrapper<T> cast(std::vector<char *> *ptr, uint32_t idx) { return PrtWrapper<T>(ptr ? (T *)((*ptr)[idx]) : nullptr); }
+  static PrtWrapper<T> cast(std::vector<char *> *ptr, uint32_t idx)
+  {
+    static_assert(ecs::TypeInfo<typename std::remove_const<T>::type>::soaLaneCount == 0, "SoA components are available only in chunk systems as ecs::SoaView<T>");
+    return PrtWrapper<T>(ptr ? (T *)((*ptr)[idx]) : nullptr);
+  }
 };
 
 
@@ -35,6 +40,7 @@ struct Ptr
 {
   static auto cast(std::vector<char *> *ptr, uint32_t idx)
   {
+    static_assert(ecs::TypeInfo<typename std::remove_const<T>::type>::soaLaneCount == 0, "SoA components are available only in chunk systems as ecs::SoaView<T>");
     if constexpr (!ecs::TypeInfo<typename std::remove_const<T>::type>::isSingleton)
     {
       return ptr ? (T *)((*ptr)[idx]) : nullptr;
@@ -67,6 +73,16 @@ struct restrict_type<SingletonWrapper<T>>
   using type = SingletonWrapper<T>;
 };
 
+// pointer to the component at offset inside of the chunk
+template<typename T>
+T *offset_ptr(T *ptr, uint32_t offset) { return ptr + offset; }
+
+template<typename T>
+PrtWrapper<T> offset_ptr(PrtWrapper<T> ptr, uint32_t offset) { return PrtWrapper<T>(ptr[offset]); }
+
+template<typename T>
+SingletonWrapper<T> offset_ptr(SingletonWrapper<T> ptr, uint32_t) { return ptr; }
+
 template<size_t UNROLL_N, typename ...PtrArgs, typename Callable>
 static void query_chunk_iteration(Callable &&callable_query, uint32_t entities_count, PtrArgs ...components)
 {
@@ -79,15 +95,40 @@ static void query_chunk_iteration(Callable &&callable_query, uint32_t entities_c
 }
 
 template<size_t N, typename ...CastArgs, typename Callable, std::size_t... I>
-static void query_archetype_iteration(ecs_details::Archetype &archetype, const ecs::ToComponentMap &chunks, Callable &&callable_query, std::index_sequence<I...>)
+static void query_archetype_iteration(ecs_details::Archetype &archetype, ecs::ToComponentMap chunks, uint32_t chunk_begin, uint32_t chunk_end, Callable &&callable_query, std::index_sequence<I...>)
 {
-  for (uint32_t chunkIdx = 0, chunkCount = archetype.chunkCount, entityOffset = 0; chunkIdx < chunkCount; chunkIdx++, entityOffset += archetype.chunkSize)
+  for (uint32_t chunkIdx = chunk_begin, entityOffset = chunk_begin << archetype.chunkSizePower; chunkIdx < chunk_end; chunkIdx++, entityOffset += archetype.chunkSize)
   {
     uint32_t entitiesCount = std::min(archetype.entityCount - entityOffset, archetype.chunkSize);
     query_chunk_iteration<4>(std::move(callable_query), entitiesCount, CastArgs::cast(chunks[I], chunkIdx)...);
   }
 }
 
+// argument of the chunk system, std::span<T> for regular components and ecs::SoaView<T> for SoA components
+template<typename T>
+struct ChunkView
+{
+  static auto create(char *chunk, uint32_t count, uint32_t chunk_size)
+  {
+    if constexpr (ecs::TypeInfo<typename std::remove_const<T>::type>::soaLaneCount != 0)
+      return ecs::SoaView<T>{(typename ecs::SoaView<T>::LaneType *)chunk, count, chunk_size};
+    else
+      return std::span<T>((T *)chunk, count);
+  }
+};
+
+// calls callable_query once per chunk with view of every component, T can be const
+template<size_t N, typename ...Types, typename Callable, std::size_t... I>
+static void query_archetype_chunk_iteration(ecs_details::Archetype &archetype, ecs::ToComponentMap chunks, uint32_t chunk_begin, uint32_t chunk_end, Callable &&callable_query, std::index_sequence<I...>)
+{
+  static_assert(!(ecs::TypeInfo<typename std::remove_const<Types>::type>::isSingleton || ...), "singletons are not supported in chunk iteration");
+  for (uint32_t chunkIdx = chunk_begin, entityOffset = chunk_begin << archetype.chunkSizePower; chunkIdx < chunk_end; chunkIdx++, entityOffset += archetype.chunkSize)
+  {
+    uint32_t entitiesCount = std::min(archetype.entityCount - entityOffset, archetype.chunkSize);
+    callable_query(ChunkView<Types>::create((*chunks[I])[chunkIdx], entitiesCount, archetype.chunkSize)...);
+  }
+}
+
 template<size_t UNROLL_N, typename ...PtrArgs, typename E, typename Callable>
 static void event_chunk_iteration(E &&event, Callable &&callable_query, uint32_t entities_count, typename restrict_type<PtrArgs>::type ...components)
 {
@@ -100,17 +141,31 @@ static void event_chunk_iteration(E &&event, Callable &&callable_query, uint32_t
 }
 
 template<size_t N, typename ...CastArgs, typename E, typename Callable, std::size_t... I>
-static void event_archetype_iteration(ecs_details::Archetype &archetype, const ecs::ToComponentMap &chunks, E &&event, Callable &&callable_query, std::index_sequence<I...>)
+static void event_archetype_iteration(ecs_details::Archetype &archetype, ecs::ToComponentMap chunks, E &&event, Callable &&callable_query, std::index_sequence<I...>)
 {
-  for (uint32_t chunkIdx = 0, chunkCount = archetype.chunkCount, entityOffset = 0; chunkIdx < chunkCount; chunkIdx++, entityOffset += archetype.chunkSize)
+  for (uint32_t chunkIdx = 0, chunkCount = archetype.getUsedChunkCount(), entityOffset = 0; chunkIdx < chunkCount; chunkIdx++, entityOffset += archetype.chunkSize)
   {
     uint32_t entitiesCount = std::min(archetype.entityCount - entityOffset, archetype.chunkSize);
     event_chunk_iteration<4, CastArgs...>(std::forward<E>(event), std::move(callable_query), entitiesCount, CastArgs::cast(chunks[I], chunkIdx)...);
   }
 }
 
+// entities [component_begin, component_end) of the archetype, chunk by chunk
+template<size_t N, typename ...CastArgs, typename E, typename Callable, std::size_t... I>
+static void event_archetype_range_iteration(ecs_details::Archetype &archetype, ecs::ToComponentMap chunks, uint32_t component_begin, uint32_t component_end, E &&event, Callable &&callable_query, std::index_sequence<I...>)
+{
+  for (uint32_t componentIdx = component_begin; componentIdx < component_end;)
+  {
+    uint32_t chunkIdx = componentIdx >> archetype.chunkSizePower;
+    uint32_t offsetInChunk = componentIdx & archetype.chunkMask;
+    uint32_t entitiesCount = std::min(component_end - componentIdx, archetype.chunkSize - offsetInChunk);
+    event_chunk_iteration<4, CastArgs...>(std::forward<E>(event), std::move(callable_query), entitiesCount, offset_ptr(CastArgs::cast(chunks[I], chunkIdx), offsetInChunk)...);
+    componentIdx += entitiesCount;
+  }
+}
+
 template<size_t N, typename ...CastArgs, typename E, typename Callable, std::size_t... I>
-static void event_invoke_for_entity(ecs_details::Archetype &archetype, const ecs::ToComponentMap &chunks, uint32_t component_idx, E &&event, Callable &&callable_query, std::index_sequence<I...>)
+static void event_invoke_for_entity(ecs_details::Archetype &archetype, ecs::ToComponentMap chunks, uint32_t component_idx, E &&event, Callable &&callable_query, std::index_sequence<I...>)
 {
   uint32_t chunkIdx = component_idx >> archetype.chunkSizePower;
   uint32_t offsetInChunk = component_idx & archetype.chunkMask;
@@ -124,18 +179,67 @@ static void query_iteration(ecs::EcsManager &mgr, ecs::NameHash query_hash, Call
   if (it != mgr.queries.end())
   {
     ecs::Query &query = it->second;
-    for (const auto &[archetypeId, archetypeRecord] : query.archetypesCache)
+    for (uint32_t archetypeIdx = 0, n = query.archetypes.size(); archetypeIdx < n; archetypeIdx++)
+    {
+      ecs_details::Archetype &archetype = *query.archetypes[archetypeIdx].archetype;
+      ecs::mark_dirty(archetype, query.get_tracked_components(archetypeIdx));
+      ecs::mark_written(archetype, query.get_written_collumns(archetypeIdx));
+      query_archetype_iteration<N, CastArgs...>(archetype, query.get_components(archetypeIdx), 0, archetype.getUsedChunkCount(), std::move(query_function), std::make_index_sequence<N>());
+    }
+  }
+}
+
+template<size_t N, typename ...Types, typename Callable>
+static void query_chunks_iteration(ecs::EcsManager &mgr, ecs::NameHash query_hash, Callable &&query_function)
+{
+  auto it = mgr.queries.find(query_hash);
+  if (it != mgr.queries.end())
+  {
+    ecs::Query &query = it->second;
+    for (uint32_t archetypeIdx = 0, n = query.archetypes.size(); archetypeIdx < n; archetypeIdx++)
+    {
+      ecs_details::Archetype &archetype = *query.archetypes[archetypeIdx].archetype;
+      ecs::mark_dirty(archetype, query.get_tracked_components(archetypeIdx));
+      ecs::mark_written(archetype, query.get_written_collumns(archetypeIdx));
+      query_archetype_chunk_iteration<N, Types...>(archetype, query.get_components(archetypeIdx), 0, archetype.getUsedChunkCount(), query_function, std::make_index_sequence<N>());
+    }
+  }
+}
+
+// every (archetype, chunk) pair is performed as a separate job on the mgr.jobScheduler,
+// query_function is shared between jobs and should be thread safe
+template<size_t N, typename ...CastArgs, typename Callable>
+static void query_parallel_iteration(ecs::EcsManager &mgr, ecs::NameHash query_hash, Callable &&query_function)
+{
+  if (!mgr.jobScheduler)
+  {
+    query_iteration<N, CastArgs...>(mgr, query_hash, std::forward<Callable>(query_function));
+    return;
+  }
+  auto it = mgr.queries.find(query_hash);
+  if (it != mgr.queries.end())
+  {
+    ecs::Query &query = it->second;
+    for (uint32_t archetypeIdx = 0, n = query.archetypes.size(); archetypeIdx < n; archetypeIdx++)
     {
-      ecs_details::Archetype &archetype = *archetypeRecord.archetype;
-      const ecs::ToComponentMap &toComponentIndex = archetypeRecord.toComponentIndex;
-      ecs::mark_dirty(archetype, archetypeRecord.toTrackedComponent);
-      query_archetype_iteration<N, CastArgs...>(archetype, toComponentIndex, std::move(query_function), std::make_index_sequence<N>());
+      ecs::mark_dirty(*query.archetypes[archetypeIdx].archetype, query.get_tracked_components(archetypeIdx));
+      ecs::mark_written(*query.archetypes[archetypeIdx].archetype, query.get_written_collumns(archetypeIdx));
     }
+    std::vector<ecs::ArchetypeChunkJob> jobs;
+    ecs::gather_chunk_jobs(query, jobs);
+    // query hash is the source and chunk job index is the job index, as in perform_system
+    const uint64_t querySource = ecs::CommandScope::nested_source(ecs::CommandScope::current_source(), query_hash);
+    mgr.jobScheduler->parallel_for(jobs.size(), [&](uint32_t job_idx) {
+      ecs::CommandScope commandScope(ecs::CommandScope::job_source(querySource, job_idx));
+      const ecs::ArchetypeChunkJob &job = jobs[job_idx];
+      ecs_details::Archetype &archetype = *query.archetypes[job.archetypeIdx].archetype;
+      query_archetype_iteration<N, CastArgs...>(archetype, query.get_components(job.archetypeIdx), job.chunkIdx, job.chunkIdx + 1, query_function, std::make_index_sequence<N>());
+    });
   }
 }
 
 template<size_t N, typename ...CastArgs, typename Callable, std::size_t... I>
-static void query_invoke_for_entity_impl(ecs_details::Archetype &archetype, const ecs::ToComponentMap &chunks, uint32_t component_idx, Callable &&callable_query, std::index_sequence<I...>)
+static void query_invoke_for_entity_impl(ecs_details::Archetype &archetype, ecs::ToComponentMap chunks, uint32_t component_idx, Callable &&callable_query, std::index_sequence<I...>)
 {
   uint32_t chunkIdx = component_idx >> archetype.chunkSizePower;
   uint32_t offsetInChunk = component_idx & archetype.chunkMask;
@@ -149,18 +253,17 @@ static void query_invoke_for_entity(ecs::EcsManager &mgr, ecs::EntityId eid, ecs
   if (it != mgr.queries.end())
   {
     ecs::Query &query = it->second;
-    ecs::ArchetypeId archetypeId;
+    ecs_details::Archetype *entityArchetype;
     uint32_t componentIdx;
-    if (mgr.entityContainer.get(eid, archetypeId, componentIdx))
+    if (mgr.entityContainer.get(eid, entityArchetype, componentIdx))
     {
-      auto ait = query.archetypesCache.find(archetypeId);
-      if (ait != query.archetypesCache.end())
+      int archetypeIdx = query.find_archetype(entityArchetype->archetypeId);
+      if (archetypeIdx != -1)
       {
-        const ecs::ArchetypeRecord &archetypeRecord = ait->second;
-        ecs_details::Archetype &archetype = *archetypeRecord.archetype;
-        const ecs::ToComponentMap &toComponentIndex = archetypeRecord.toComponentIndex;
-        ecs::mark_dirty(archetype, archetypeRecord.toTrackedComponent, componentIdx);
-        query_invoke_for_entity_impl<N, CastArgs...>(archetype, toComponentIndex, componentIdx, std::move(query_function), std::make_index_sequence<N>());
+        ecs_details::Archetype &archetype = *query.archetypes[archetypeIdx].archetype;
+        ecs::mark_dirty(archetype, query.get_tracked_components(archetypeIdx), componentIdx);
+        ecs::mark_written(archetype, query.get_written_collumns(archetypeIdx), componentIdx);
+        query_invoke_for_entity_impl<N, CastArgs...>(archetype, query.get_components(archetypeIdx), componentIdx, std::move(query_function), std::make_index_sequence<N>());
       }
     }
   }
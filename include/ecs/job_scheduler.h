@@ -0,0 +1,86 @@
+#pragma once
+
+#include "ecs/config.h"
+#include <atomic>
+#include <mutex>
+#include <deque>
+#include <thread>
+#include <condition_variable>
+
+namespace ecs_details
+{
+
+struct JobGroup
+{
+  std::atomic<uint32_t> pendingJobs = 0;
+};
+
+struct Job
+{
+  using JobFunction = void (*)(const void *context, uint32_t job_idx);
+  JobFunction function;
+  const void *context;
+  uint32_t jobIdx;
+  JobGroup *group;
+};
+
+// mutex protected deque, owner thread pops from the back, other threads steal from the front
+struct JobQueue
+{
+  std::mutex mutex;
+  std::deque<Job> jobs;
+
+  void push(const Job *jobs_begin, uint32_t jobs_count);
+  bool pop(Job &job);
+  bool steal(Job &job);
+};
+
+// work-stealing scheduler. Queue 0 belongs to the threads outside of the scheduler (main thread),
+// queues [1..workerCount] belong to the worker threads.
+// Waiting thread helps to execute jobs, so nested parallel_for calls are allowed.
+struct JobScheduler
+{
+  std::vector<std::unique_ptr<JobQueue>> queues;
+  std::vector<std::thread> workers;
+  std::mutex sleepMutex;
+  std::condition_variable wakeUp;
+  std::atomic<uint32_t> queuedJobs = 0;
+  std::atomic<bool> stopped = false;
+
+  JobScheduler(uint32_t worker_count);
+  ~JobScheduler();
+
+  JobScheduler(const JobScheduler &) = delete;
+  JobScheduler &operator=(const JobScheduler &) = delete;
+
+  uint32_t worker_count() const { return workers.size(); }
+
+  void submit(Job::JobFunction function, const void *context, uint32_t job_count, JobGroup &group);
+  void wait(JobGroup &group);
+
+  // calls callable(i) for i in [0, count) and returns when all calls are finished
+  template<typename Callable>
+  void parallel_for(uint32_t count, const Callable &callable)
+  {
+    if (count == 0)
+      return;
+    if (workers.empty() || count == 1)
+    {
+      for (uint32_t i = 0; i < count; i++)
+        callable(i);
+      return;
+    }
+    JobGroup group;
+    submit([](const void *context, uint32_t job_idx) { (*(const Callable *)context)(job_idx); }, &callable, count, group);
+    wait(group);
+  }
+
+  // 0 for the threads outside of the scheduler, [1..workerCount] for the worker threads
+  uint32_t current_queue_index() const;
+
+private:
+  bool try_execute_job(uint32_t queue_idx);
+  void worker_loop(uint32_t queue_idx);
+};
+
+} // namespace ecs_details
@@ -2,25 +2,31 @@
 
 #include "ecs/config.h"
 #include "ecs/archetype.h"
+#include <span>
 
 namespace ecs
 {
 
-using ToComponentMap = std::vector<std::vector<char *> *>;
+// column chunks of the archetype for every component of the querySignature, points to Query::archetypesComponents
+using ToComponentMap = std::vector<char *> *const *;
 
 struct ArchetypeRecord
 {
   ecs_details::Archetype *archetype = nullptr;
-  // ArchetypeId archetypeId = 0;
-  ToComponentMap toComponentIndex;
-  std::vector<int> toTrackedComponent;
-  ArchetypeRecord() = default;
-  ArchetypeRecord(ecs_details::Archetype *archetype, ToComponentMap &&toComponentIndex, std::vector<int> &&toTrackedComponent) :
-      archetype(archetype), toComponentIndex(std::move(toComponentIndex)), toTrackedComponent(std::move(toTrackedComponent)) {}
+  uint32_t trackedOffset = 0; // range in Query::archetypesTrackedComponents
+  uint32_t trackedCount = 0;
+  uint32_t writtenOffset = 0; // range in Query::archetypesWrittenCollumns
+  uint32_t writtenCount = 0;
 };
 
-void mark_dirty(ecs_details::Archetype &archetype, const std::vector<int> &to_tracked_component, uint32_t component_idx);
-void mark_dirty(ecs_details::Archetype &archetype, const std::vector<int> &to_tracked_component);
+void mark_dirty(ecs_details::Archetype &archetype, std::span<const int> to_tracked_component, uint32_t component_idx);
+void mark_dirty(ecs_details::Archetype &archetype, std::span<const int> to_tracked_component);
+
+// stamps Collumn::chunkVersions of the written collumns with version
+void mark_written(ecs_details::Archetype &archetype, std::span<const int> written_collumns, uint32_t chunk_begin, uint32_t chunk_end, uint64_t version);
+// with the current EcsManager::changeVersion
+void mark_written(ecs_details::Archetype &archetype, std::span<const int> written_collumns, uint32_t component_idx);
+void mark_written(ecs_details::Archetype &archetype, std::span<const int> written_collumns);
 
 struct Query
 {
@@ -40,13 +46,26 @@ struct Query
     ComponentAccess access;
   };
 
-  ska::flat_hash_map<ArchetypeId, ArchetypeRecord> archetypesCache;
+  // matched archetypes are stored densely for iteration, archetypeToIndex is used only for the unicast lookups
+  std::vector<ArchetypeRecord> archetypes;
+  std::vector<std::vector<char *> *> archetypesComponents; // querySignature.size() pointers per archetype
+  std::vector<int> archetypesTrackedComponents;
+  std::vector<int> archetypesWrittenCollumns; // collumns of READ_WRITE components, for chunk versions
+  ska::flat_hash_map<ArchetypeId, uint32_t> archetypeToIndex;
 
   std::vector<ComponentAccessInfo> querySignature;
 
   std::vector<ComponentId> requireComponents; // components without reading access
   std::vector<ComponentId> excludeComponents;
 
+  // archetype prefilter, built from requireComponents, non optional querySignature and excludeComponents.
+  // Components unknown at build time make masks incomplete, they are rebuilt when componentMap grows
+  ecs_details::ComponentMask requireMask;
+  ecs_details::ComponentMask excludeMask;
+  uint32_t maskComponentCount = 0; // componentMap size at the last build, 0 if not built
+  bool hasUnknownRequired = false;
+  bool hasUnknownExcluded = false;
+
   std::vector<ecs_details::tiny_string> before;
   std::vector<ecs_details::tiny_string> after;
 
@@ -54,32 +73,71 @@ struct Query
   ecs_details::tiny_string uniqueName;
   NameHash nameHash;
 
+  ToComponentMap get_components(uint32_t archetype_idx) const
+  {
+    return archetypesComponents.data() + archetype_idx * querySignature.size();
+  }
+
+  std::span<const int> get_tracked_components(uint32_t archetype_idx) const
+  {
+    const ArchetypeRecord &record = archetypes[archetype_idx];
+    return std::span<const int>(archetypesTrackedComponents.data() + record.trackedOffset, record.trackedCount);
+  }
+
+  std::span<const int> get_written_collumns(uint32_t archetype_idx) const
+  {
+    const ArchetypeRecord &record = archetypes[archetype_idx];
+    return std::span<const int>(archetypesWrittenCollumns.data() + record.writtenOffset, record.writtenCount);
+  }
+
+  // returns -1 if archetype doesn't match the query
+  int find_archetype(ArchetypeId archetype_id) const
+  {
+    auto it = archetypeToIndex.find(archetype_id);
+    return it != archetypeToIndex.end() ? (int)it->second : -1;
+  }
 };
 
 // static_assert(sizeof(Query) == 184);
-// static_assert(sizeof(Query::archetypesCache) == 40);
 // static_assert(sizeof(Query::before) == 24);
 
 struct System final : public Query
 {
-  using SystemUpdateHandler = void (*)(ecs_details::Archetype &archetype, const ToComponentMap &to_archetype_component);
+  using SystemUpdateHandler = void (*)(ecs_details::Archetype &archetype, ToComponentMap to_archetype_component, uint32_t chunk_begin, uint32_t chunk_end);
   ecs_details::tiny_string stage;
   SystemUpdateHandler update_archetype;
+  bool isJob = false; // iterate archetype chunks as separate jobs
+  // ECS_SYSTEM(changed=...): chunks where none of these components were written since the last run are skipped
+  std::vector<ComponentId> changedComponents;
+  mutable uint64_t lastRunVersion = 0; // EcsManager::changeVersion of the last run
+};
+
+// access-conflict DAG of the stage systems, built in sort_systems.
+// Systems conflict if one of them writes component (or singleton) that other reads or writes.
+// Indices point to the mgr.systems[stage] vector. Only consecutive job systems are performed concurrently,
+// other systems keep the sorted order.
+struct StageExecutionPlan
+{
+  std::vector<std::vector<uint32_t>> dependencies; // dependencies[i] - systems that should be finished before system i
+  std::vector<std::vector<uint32_t>> waves; // systems of one wave don't conflict and can be performed concurrently
 };
 
 struct EventHandler final : public Query
 {
-  using BroadcastEventHandler = void (*)(ecs_details::Archetype &archetype, const ToComponentMap &to_archetype_component, EventId event_id, const void *event_ptr);
-  using UnicastEventHandler = void (*)(ecs_details::Archetype &archetype, const ToComponentMap &to_archetype_component, uint32_t component_idx, EventId event_id, const void *event_ptr);
+  using BroadcastEventHandler = void (*)(ecs_details::Archetype &archetype, ToComponentMap to_archetype_component, EventId event_id, const void *event_ptr);
+  using UnicastEventHandler = void (*)(ecs_details::Archetype &archetype, ToComponentMap to_archetype_component, uint32_t component_idx, EventId event_id, const void *event_ptr);
+  // for entities [component_begin, component_end) of the archetype
+  using RangeEventHandler = void (*)(ecs_details::Archetype &archetype, ToComponentMap to_archetype_component, uint32_t component_begin, uint32_t component_end, EventId event_id, const void *event_ptr);
 
   std::vector<EventId> eventIds;
   std::vector<ComponentId> trackedComponents;
   BroadcastEventHandler broadcastEvent;
   UnicastEventHandler unicastEvent;
+  RangeEventHandler rangeEvent;
 };
 
-// using BroadcastReadbackHandler = void (*)(ecs_details::Archetype &archetype, const ToComponentMap &to_archetype_component, EventId event_id, void *event_ptr);
-// using UnicastReadbackHandler = void (*)(ecs_details::Archetype &archetype, const ToComponentMap &to_archetype_component, EntityId eid, EventId event_id, void *event_ptr);
+// using BroadcastReadbackHandler = void (*)(ecs_details::Archetype &archetype, ToComponentMap to_archetype_component, EventId event_id, void *event_ptr);
+// using UnicastReadbackHandler = void (*)(ecs_details::Archetype &archetype, ToComponentMap to_archetype_component, EntityId eid, EventId event_id, void *event_ptr);
 
 struct EcsManager;
 
@@ -89,7 +147,19 @@ void register_event(EcsManager &mgr, EventHandler &&event);
 
 bool try_registrate(ecs::EcsManager &mgr, ecs::Query &query, const ecs_details::Archetype *archetype);
 
-//helper function
+// archetype chunk as a separate unit of parallel work
+struct ArchetypeChunkJob
+{
+  uint32_t archetypeIdx; // index in Query::archetypes
+  uint32_t chunkIdx;
+};
+
+// gathers only chunks with entities, trailing chunks can be empty
+void gather_chunk_jobs(const Query &query, std::vector<ArchetypeChunkJob> &jobs);
+
+//helper function, doesn't use chunk versions
 void perform_system(const System &system);
+// run job systems on the mgr.jobScheduler, other systems are performed as perform_system(system)
+void perform_system(EcsManager &mgr, const System &system);
 
 }
\ No newline at end of file
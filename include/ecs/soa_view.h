@@ -0,0 +1,31 @@
+#pragma once
+
+#include "ecs/config.h"
+#include <span>
+#include <type_traits>
+
+namespace ecs
+{
+
+template<typename T>
+struct TypeInfo;
+
+// lane-wise view of the SoA components in the chunk, lane(k)[i] is the k-th field of the i-th component.
+// T is declared with ECS_SOA_TYPE_DECLARATION, const T gives read only access
+template<typename T>
+struct SoaView
+{
+  using Info = TypeInfo<typename std::remove_const<T>::type>;
+  using LaneType = std::conditional_t<std::is_const_v<T>, const typename Info::SoaLaneType, typename Info::SoaLaneType>;
+  static constexpr uint32_t laneCount = Info::soaLaneCount;
+  static_assert(laneCount != 0, "type isn't declared with ECS_SOA_TYPE_DECLARATION");
+
+  LaneType *data;
+  uint32_t count;
+  uint32_t laneStride; // chunk size, lanes are placed one after another
+
+  std::span<LaneType> lane(uint32_t k) const { return std::span<LaneType>(data + k * laneStride, count); }
+  size_t size() const { return count; }
+};
+
+} // namespace ecs
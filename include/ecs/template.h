@@ -3,6 +3,23 @@
 #include "ecs/config.h"
 #include "ecs/component_init.h"
 
+namespace ecs_details
+{
+// how to initialize one archetype collumn on entity creation, precomputed at template registration
+struct ComponentRecipe
+{
+  enum class Source : uint8_t
+  {
+    TemplateData, // copy of the template value
+    Default, // template has no value for component, construct default
+    EntityId // entity id of the created entity
+  };
+  const ecs::Any *templateData = nullptr; // points into Template::args, which never rehashes after registration
+  int overrideSlot = -1; // index in positional overrides or -1
+  Source source = Source::Default;
+};
+} // namespace ecs_details
+
 namespace ecs
 {
 using TrackedComponentMap = ska::flat_hash_set<ecs::NameHash>;
@@ -13,14 +30,20 @@ struct Template
   ArchetypeId archetypeId;
   TrackedComponentMap trackedComponents;
   std::vector<TemplateId> composition;
+  std::vector<ecs_details::ComponentRecipe> recipe; // aligned to the archetype collumns
+  uint32_t overrideSlotCount = 0;
 };
 
 struct TemplateInit
 {
   InitializerList args = InitializerList(InitializerList::Empty{});
   std::vector<ecs_details::tiny_string> trackedComponents;
+  // components which are passed positionally to create_entity_sync(mgr, templateId, std::span<ecs::Any>), in this order
+  std::vector<ecs_details::tiny_string> overrideSlots;
   ecs_details::tiny_string name;
   ArchetypeChunkSize chunkSizePower = ArchetypeChunkSize::Thousands;
+  // used only if archetype doesn't exist yet, templates with the same components share archetype
+  ArchetypeChunkLayout chunkLayout = ArchetypeChunkLayout::PerCollumn;
 };
 
 }
\ No newline at end of file
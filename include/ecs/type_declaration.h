@@ -11,6 +11,11 @@ using Destructor = void (*)(void *mem);
 using CopyConstructor = void (*)(void *dest, const void *src);
 using MoveConstructor = void (*)(void *dest, void *src);
 using CompareAndAssign = bool (*)(const void *new_value, void *old_value); // return true if value changed
+// range versions for count contiguous elements
+using DestructorN = void (*)(void *mem, uint32_t count);
+using CopyConstructorN = void (*)(void *dest, const void *src, uint32_t count);
+using MoveConstructorN = void (*)(void *dest, void *src, uint32_t count);
+using HashValue = uint64_t (*)(const void *value);
 
 struct TypeDeclaration
 {
@@ -20,15 +25,28 @@ struct TypeDeclaration
   CopyConstructor copy_construct = nullptr;
   MoveConstructor move_construct = nullptr;
   CompareAndAssign compare_and_assign = nullptr; // return true if value changed
+  DestructorN destruct_n = nullptr;
+  CopyConstructorN copy_construct_n = nullptr;
+  MoveConstructorN move_construct_n = nullptr;
+  HashValue hash_value = nullptr; // for digest tracking
   TypeId typeId = 0;
   uint32_t sizeOfElement = 0;
   uint32_t alignmentOfElement = 1;
-  bool isTriviallyRelocatable = false;
+  bool isTriviallyRelocatable = false; // can be moved to the new place by memcpy without destruction of the old one
+  bool isTriviallyDestructible = false;
+  bool isBitwiseComparable = false; // compare_and_assign is memcmp and memcpy
   bool isSingleton = false;
+  bool isTag = false; // empty type, takes part in archetype type but has no collumn
+  bool trackByDigest = false; // tracked collumn keeps hash_value of the previous value instead of its copy
+  uint8_t soaLaneCount = 0; // if not 0, component is stored in chunk as soaLaneCount separate arrays of equal fields (xxxx..yyyy..zzzz)
 };
 
-static_assert(sizeof(TypeDeclaration) == 64);
+// SoA components are gathered to the temporary buffer of this size for per entity operations
+static constexpr uint32_t MAX_SOA_TYPE_SIZE = 256;
 
-using TypeDeclarationMap = ska::flat_hash_map<TypeId, TypeDeclaration>;
+static_assert(sizeof(TypeDeclaration) == 104);
+
+// declarations are referenced by archetype collumns, so they are allocated separately
+using TypeDeclarationMap = ska::flat_hash_map<TypeId, std::unique_ptr<TypeDeclaration>>;
 
 } // namespace ecs
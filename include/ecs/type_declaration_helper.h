@@ -1,5 +1,25 @@
 #pragma once
 #include "ecs/type_declaration.h"
+#include <functional>
+
+namespace ecs
+{
+
+// specialize with value = true to track component by 64 bit digest instead of the copy of the previous value,
+// for big components and containers. Specialization can define static uint64_t hash(const T &),
+// otherwise std::hash or bytes of trivially copyable type are hashed.
+// Collision of digests hides the change, so it is opt-in
+template <typename T>
+struct track_by_digest : std::false_type {};
+
+// specialize with value = true if operator== of trivially copyable T is the same as byte comparison
+// (no padding, no custom operator==), then tracking compares whole chunks with memcmp.
+// Only scalars with unique object representations take this path by default, so float, float3 and other POD structs
+// need the opt-in. For floats -0.0 and 0.0 are reported as changed, equal NaN bytes as unchanged
+template <typename T>
+struct track_bitwise : std::false_type {};
+
+} // namespace ecs
 
 namespace ecs_details
 {
@@ -28,6 +48,24 @@ void move_construct(void *dest, void *src)
   new (dest) T(std::move(*(T *)src));
 }
 
+template <typename T>
+void destruct_n(void *data, uint32_t count)
+{
+  std::destroy_n((T *)data, count);
+}
+
+template <typename T>
+void copy_construct_n(void *dest, const void *src, uint32_t count)
+{
+  std::uninitialized_copy_n((const T *)src, count, (T *)dest);
+}
+
+template <typename T>
+void move_construct_n(void *dest, void *src, uint32_t count)
+{
+  std::uninitialized_move_n((T *)src, count, (T *)dest);
+}
+
 // return true if value changed
 template <typename T>
 bool compare_and_assign(const void *new_value, void *old_value)
@@ -50,6 +88,47 @@ struct is_equality_comparable<T, std::void_t<decltype(std::declval<T>() == std::
 template <typename T>
 constexpr bool is_equality_comparable_v = is_equality_comparable<T>::value;
 
+// operator== of T is the same as byte comparison, so tracking can compare whole chunks with memcmp
+template <typename T>
+struct is_bitwise_comparable : std::bool_constant<(std::is_scalar_v<T> && std::has_unique_object_representations_v<T>) || ecs::track_bitwise<T>::value> {};
+
+template <typename T, typename = void>
+struct is_std_hashable : std::false_type {};
+
+template <typename T>
+struct is_std_hashable<T, std::void_t<decltype(std::hash<T>{}(std::declval<const T &>()))>> : std::true_type {};
+
+template <typename T, typename = void>
+struct has_digest_hash : std::false_type {};
+
+template <typename T>
+struct has_digest_hash<T, std::void_t<decltype(ecs::track_by_digest<T>::hash(std::declval<const T &>()))>> : std::true_type {};
+
+// ecs::track_by_digest<T>::hash, std::hash or bytes of trivially copyable type
+template <typename T>
+uint64_t hash_value(const void *value)
+{
+  if constexpr (has_digest_hash<T>::value)
+  {
+    return ecs::track_by_digest<T>::hash(*(const T *)value);
+  }
+  else if constexpr (is_std_hashable<T>::value)
+  {
+    return std::hash<T>{}(*(const T *)value);
+  }
+  else
+  {
+    const unsigned char *bytes = (const unsigned char *)value;
+    uint64_t h = 14695981039346656037ull;
+    for (size_t i = 0; i < sizeof(T); i++)
+      h = (h ^ bytes[i]) * 1099511628211ull;
+    return h;
+  }
+}
+
+template <typename T>
+constexpr bool is_hashable_v = has_digest_hash<T>::value || is_std_hashable<T>::value || std::is_trivially_copyable_v<T>;
+
 } // namespace ecs_details
 
 namespace ecs
@@ -62,17 +141,35 @@ TypeDeclaration create_type_declaration()
   type_declaration.typeName = ecs::TypeInfo<T>::typeName;
   type_declaration.typeId = ecs::TypeInfo<T>::typeId;
   type_declaration.isTriviallyRelocatable = ecs::TypeInfo<T>::isTriviallyRelocatable;
+  type_declaration.isTriviallyDestructible = std::is_trivially_destructible_v<T>;
+  static_assert(!ecs::track_bitwise<T>::value || std::is_trivially_copyable_v<T>, "ecs::track_bitwise needs trivially copyable type");
+  type_declaration.isBitwiseComparable = ecs_details::is_bitwise_comparable<T>::value && std::is_trivially_copyable_v<T>;
   type_declaration.isSingleton = ecs::TypeInfo<T>::isSingleton;
+  type_declaration.isTag = std::is_empty_v<T> && !ecs::TypeInfo<T>::isSingleton;
+  type_declaration.soaLaneCount = ecs::TypeInfo<T>::soaLaneCount;
   type_declaration.sizeOfElement = sizeof(T);
   type_declaration.alignmentOfElement = alignof(T);
   type_declaration.construct_default = ecs_details::construct_default<T>;
   type_declaration.destruct = ecs_details::destruct<T>;
+  type_declaration.destruct_n = ecs_details::destruct_n<T>;
   if constexpr (std::is_copy_constructible_v<T>)
+  {
     type_declaration.copy_construct = ecs_details::copy_construct<T>;
+    type_declaration.copy_construct_n = ecs_details::copy_construct_n<T>;
+  }
   if constexpr (std::is_move_constructible_v<T>)
+  {
     type_declaration.move_construct = ecs_details::move_construct<T>;
+    type_declaration.move_construct_n = ecs_details::move_construct_n<T>;
+  }
   if constexpr (std::is_copy_constructible_v<T> && ecs_details::is_equality_comparable_v<T>)
     type_declaration.compare_and_assign = ecs_details::compare_and_assign<T>;
+  if constexpr (ecs::track_by_digest<T>::value)
+  {
+    static_assert(ecs_details::is_hashable_v<T>, "Type tracked by digest needs static hash(const T &) in ecs::track_by_digest<T> or std::hash<T>");
+    type_declaration.hash_value = ecs_details::hash_value<T>;
+    type_declaration.trackByDigest = true;
+  }
   return type_declaration;
 }
 
@@ -87,12 +184,34 @@ struct TypeInfo;
     static constexpr const char *typeName = STRING_ALIAS; \
     static constexpr bool isTriviallyRelocatable = IS_TRIVIALLY_RELOCATABLE; \
     static constexpr bool isSingleton = IS_SINGLETON; \
+    static constexpr uint32_t soaLaneCount = 0; \
+    using SoaLaneType = void; \
+  };
+
+// CPP_TYPE is stored in chunk as structure of arrays, every LANE_TYPE field is a separate array (xxxx..yyyy..zzzz).
+// Such components are available in chunk systems as ecs::SoaView<CPP_TYPE>.
+#define ECS_SOA_TYPE_DECLARATION_ALIAS(CPP_TYPE, STRING_ALIAS, LANE_TYPE) \
+  static_assert(std::is_trivially_copyable_v<CPP_TYPE> && std::is_trivially_destructible_v<CPP_TYPE>, "SoA type should be POD"); \
+  static_assert(sizeof(CPP_TYPE) % sizeof(LANE_TYPE) == 0 && sizeof(CPP_TYPE) <= ecs::MAX_SOA_TYPE_SIZE, "SoA type should consist of LANE_TYPE fields"); \
+  static_assert(sizeof(CPP_TYPE) / sizeof(LANE_TYPE) <= UINT8_MAX, "TypeDeclaration::soaLaneCount can't store more than 255 lanes"); \
+  template<> \
+  struct ecs::TypeInfo<CPP_TYPE> \
+  { \
+    static constexpr ecs::TypeId typeId = ecs::hash(STRING_ALIAS); \
+    static constexpr const char *typeName = STRING_ALIAS; \
+    static constexpr bool isTriviallyRelocatable = true; \
+    static constexpr bool isSingleton = false; \
+    static constexpr uint32_t soaLaneCount = sizeof(CPP_TYPE) / sizeof(LANE_TYPE); \
+    using SoaLaneType = LANE_TYPE; \
   };
 
+// types with self references (e.g. libstdc++ std::string) can't be relocated by memcpy.
+// Only trivially copyable types are relocated by memcpy by default, types with user defined copy or move
+// are relocated by move constructor, use ECS_RELOCATABLE_TYPE_DECLARATION for the types which are known to be safe
 template<typename T>
 struct is_trivially_relocatable
 {
-  static constexpr bool value = sizeof(T) < 1024;
+  static constexpr bool value = std::is_trivially_copyable_v<T>;
 };
 
 #define ECS_TYPE_DECLARATION(CPP_TYPE) ECS_TYPE_DECLARATION_VERBOSE(CPP_TYPE, #CPP_TYPE, is_trivially_relocatable<CPP_TYPE>::value, false)
@@ -103,6 +222,8 @@ struct is_trivially_relocatable
 #define ECS_RELOCATABLE_TYPE_DECLARATION_ALIAS(CPP_TYPE, STRING_ALIAS) ECS_TYPE_DECLARATION_VERBOSE(CPP_TYPE, STRING_ALIAS, true, false)
 #define ECS_NON_RELOCATABLE_TYPE_DECLARATION_ALIAS(CPP_TYPE, STRING_ALIAS) ECS_TYPE_DECLARATION_VERBOSE(CPP_TYPE, STRING_ALIAS, false, false)
 
+#define ECS_SOA_TYPE_DECLARATION(CPP_TYPE, LANE_TYPE) ECS_SOA_TYPE_DECLARATION_ALIAS(CPP_TYPE, #CPP_TYPE, LANE_TYPE)
+
 #define ECS_SINGLETON_TYPE_DECLARATION(CPP_TYPE) ECS_TYPE_DECLARATION_VERBOSE(CPP_TYPE, #CPP_TYPE, false, true)
 #define ECS_SINGLETON_TYPE_DECLARATION_ALIAS(CPP_TYPE, STRING_ALIAS) ECS_TYPE_DECLARATION_VERBOSE(CPP_TYPE, STRING_ALIAS, false, true)
 
@@ -2,6 +2,7 @@
 #include "ecs/ecs_manager.h"
 #include "ecs/builtin_events.h"
 #include <assert.h>
+#include <algorithm>
 
 namespace ecs
 {
@@ -14,13 +15,53 @@ namespace ecs_details
 static const ecs::TypeDeclaration *find_type_declaration(const ecs::TypeDeclarationMap &type_map, ecs::TypeId type_id)
 {
   const auto it = type_map.find(type_id);
-  return it != type_map.end() ? &it->second : nullptr;
+  return it != type_map.end() ? it->second.get() : nullptr;
 }
 
+// storage of TrackedCollumn::isDigest collumns
+static const ecs::TypeDeclaration *get_digest_type_declaration()
+{
+  static const ecs::TypeDeclaration digestTypeDeclaration = []() {
+    ecs::TypeDeclaration typeDeclaration;
+    typeDeclaration.typeName = "tracked_digest";
+    typeDeclaration.typeId = ecs::hash("tracked_digest");
+    typeDeclaration.isTriviallyRelocatable = true;
+    typeDeclaration.isTriviallyDestructible = true;
+    typeDeclaration.sizeOfElement = sizeof(uint64_t);
+    typeDeclaration.alignmentOfElement = alignof(uint64_t);
+    typeDeclaration.construct_default = ecs_details::construct_default<uint64_t>;
+    typeDeclaration.destruct = ecs_details::destruct<uint64_t>;
+    typeDeclaration.destruct_n = ecs_details::destruct_n<uint64_t>;
+    typeDeclaration.copy_construct = ecs_details::copy_construct<uint64_t>;
+    typeDeclaration.copy_construct_n = ecs_details::copy_construct_n<uint64_t>;
+    typeDeclaration.move_construct = ecs_details::move_construct<uint64_t>;
+    typeDeclaration.move_construct_n = ecs_details::move_construct_n<uint64_t>;
+    return typeDeclaration;
+  }();
+  return &digestTypeDeclaration;
+}
+
+// calls callable(first_index, count) for every part of [begin, begin + count) which lies in one chunk
+template<typename Callable>
+static void for_each_chunk_part(const Archetype &archetype, uint32_t begin, uint32_t count, Callable &&callable)
+{
+  while (count > 0)
+  {
+    const uint32_t partCount = std::min(count, archetype.chunkSize - (begin & archetype.chunkMask));
+    callable(begin, partCount);
+    begin += partCount;
+    count -= partCount;
+  }
+}
+
+// components are hashed in sorted order, so the id doesn't depend on the iteration order of type
+// and archetypes built by transitions get the same id as the template ones
 static ecs::ArchetypeId get_archetype_id(const ArchetypeComponentType &type)
 {
+  std::vector<std::pair<ecs::ComponentId, bool>> components(type.begin(), type.end());
+  std::sort(components.begin(), components.end());
   uint32_t id = 0;
-  for (const auto [componentId, tracked] : type)
+  for (const auto &[componentId, tracked] : components)
   {
     id = ecs::fnv_hash(componentId, id);
     id = ecs::fnv_hash((uint32_t)tracked, id);
@@ -28,18 +69,26 @@ static ecs::ArchetypeId get_archetype_id(const ArchetypeComponentType &type)
   return id;
 }
 
-Archetype::Archetype(const ecs::EcsManager &mgr, ecs::ArchetypeId archetype_id, ArchetypeComponentType &&_type, ecs::ArchetypeChunkSize chunk_size_power) :
+Archetype::Archetype(const ecs::EcsManager &mgr, ecs::ArchetypeId archetype_id, ArchetypeComponentType &&_type, ecs::ArchetypeChunkSize chunk_size_power, ecs::ArchetypeChunkLayout chunk_layout) :
   type(std::move(_type)),
   archetypeId(archetype_id),
   chunkSize(1 << chunk_size_power),
   chunkSizePower(chunk_size_power),
-  chunkMask(chunkSize - 1)
+  chunkMask(chunkSize - 1),
+  chunkLayout(chunk_layout),
+  chunkAllocator(mgr.chunkAllocator.get()),
+  changeVersion(&mgr.changeVersion)
 {
   assert(!type.empty());
   collumns.reserve(type.size());
   componentToCollumnIndex.reserve(type.size());
+  denseCollumnIndex.resize(mgr.componentMap.size(), -1);
   for (const auto [componentId, isTracked] : type)
   {
+    // archetypes are created only from registered components
+    auto cmpIt = mgr.componentMap.find(componentId);
+    if (cmpIt != mgr.componentMap.end())
+      componentMask.set(cmpIt->second->denseIndex);
     const ecs::TypeId typeId = ecs::get_type_id(componentId);
     const ecs::TypeDeclaration *typeDeclaration = find_type_declaration(mgr.typeMap, typeId);
     if (typeDeclaration == nullptr)
@@ -47,62 +96,251 @@ Archetype::Archetype(const ecs::EcsManager &mgr, ecs::ArchetypeId archetype_id,
       ECS_LOG_ERROR(mgr).log("Type with hash %x not found", typeId);
       continue;
     }
+    // tags are only part of the archetype type, there is nothing to store
+    if (typeDeclaration->isTag)
+      continue;
     uint32_t componentIndex = collumns.size();
-    collumns.emplace_back(chunk_size_power, typeDeclaration->sizeOfElement, typeDeclaration->alignmentOfElement, typeId, typeDeclaration->typeName.c_str(), componentId);
+    collumns.emplace_back(chunk_size_power, typeDeclaration, componentId);
+    collumnTrackedIndex.push_back(-1);
 
     componentToCollumnIndex.emplace(componentId, componentIndex);
+    if (cmpIt != mgr.componentMap.end())
+      denseCollumnIndex[cmpIt->second->denseIndex] = componentIndex;
 
-    if (isTracked)
+    if (isTracked && trackedCollumns.size() == MAX_TRACKED_COMPONENTS)
+    {
+      ECS_LOG_ERROR(mgr).log("Archetype can't track more than %d components, %s is not tracked", MAX_TRACKED_COMPONENTS, typeDeclaration->typeName.c_str());
+    }
+    else if (isTracked)
     {
       uint32_t trackedComponentIndex = componentToTrackedCollumnIndex.size();
       componentToTrackedCollumnIndex.emplace(componentId, trackedComponentIndex);
-      trackedCollumns.emplace_back(chunk_size_power, typeDeclaration->sizeOfElement, typeDeclaration->alignmentOfElement, typeId, typeDeclaration->typeName.c_str(), componentId, componentIndex);
+      collumnTrackedIndex[componentIndex] = trackedComponentIndex;
+      const bool byDigest = typeDeclaration->trackByDigest && typeDeclaration->hash_value != nullptr;
+      trackedCollumns.emplace_back(chunk_size_power, byDigest ? get_digest_type_declaration() : typeDeclaration, componentId, componentIndex, byDigest);
     }
   }
+
+  if (chunkLayout == ecs::ArchetypeChunkLayout::SingleAllocation)
+  {
+    const auto place_collumn = [&](Collumn &collumn) {
+      chunkBlockSize = (chunkBlockSize + collumn.containerAlignment - 1) / collumn.containerAlignment * collumn.containerAlignment;
+      chunkBlockAlignment = std::max(chunkBlockAlignment, collumn.containerAlignment);
+      collumn.chunkOffset = chunkBlockSize;
+      chunkBlockSize += chunkSize * collumn.sizeOfElement;
+    };
+    for (Collumn &collumn : collumns)
+      place_collumn(collumn);
+    for (TrackedCollumn &trackedCollumn : trackedCollumns)
+      place_collumn(trackedCollumn);
+  }
 }
 
-static void try_add_chunk(Archetype &archetype, int requiredEntityCount)
+Archetype::~Archetype()
 {
-  while (archetype.entityCount + requiredEntityCount > archetype.capacity)
+  while (chunkCount > 0)
+    release_last_chunk();
+}
+
+void Archetype::add_chunk()
+{
+  capacity += chunkSize;
+  chunkCount++;
+  if (chunkLayout == ecs::ArchetypeChunkLayout::SingleAllocation)
   {
-    archetype.capacity += archetype.chunkSize;
-    archetype.chunkCount++;
-    for (ecs_details::Collumn &collumn : archetype.collumns)
+    char *block = chunkAllocator->allocate(chunkBlockSize, chunkBlockAlignment);
+    chunkBlocks.push_back(block);
+    for (Collumn &collumn : collumns)
+      collumn.chunks.push_back(block + collumn.chunkOffset);
+    for (TrackedCollumn &trackedCollumn : trackedCollumns)
+      trackedCollumn.chunks.push_back(block + trackedCollumn.chunkOffset);
+  }
+  else
+  {
+    for (Collumn &collumn : collumns)
+      collumn.chunks.push_back(chunkAllocator->allocate(collumn.chunk_bytes(), collumn.containerAlignment));
+    for (TrackedCollumn &trackedCollumn : trackedCollumns)
+      trackedCollumn.chunks.push_back(chunkAllocator->allocate(trackedCollumn.chunk_bytes(), trackedCollumn.containerAlignment));
+  }
+  for (TrackedCollumn &trackedCollumn : trackedCollumns)
+    trackedCollumn.dirtyState.resize(capacity);
+  const uint64_t version = getChangeVersion();
+  for (Collumn &collumn : collumns)
+    collumn.chunkVersions.push_back(version);
+}
+
+void Archetype::release_last_chunk()
+{
+  capacity -= chunkSize;
+  chunkCount--;
+  if (chunkLayout == ecs::ArchetypeChunkLayout::SingleAllocation)
+  {
+    chunkAllocator->deallocate(chunkBlocks.back(), chunkBlockSize, chunkBlockAlignment);
+    chunkBlocks.pop_back();
+    for (Collumn &collumn : collumns)
+      collumn.chunks.pop_back();
+    for (TrackedCollumn &trackedCollumn : trackedCollumns)
+      trackedCollumn.chunks.pop_back();
+  }
+  else
+  {
+    for (Collumn &collumn : collumns)
     {
-      collumn.add_chunk();
+      chunkAllocator->deallocate(collumn.chunks.back(), collumn.chunk_bytes(), collumn.containerAlignment);
+      collumn.chunks.pop_back();
     }
-    for (ecs_details::TrackedCollumn &trackedCollumn : archetype.trackedCollumns)
+    for (TrackedCollumn &trackedCollumn : trackedCollumns)
     {
-      trackedCollumn.add_chunk();
-      trackedCollumn.dirtyState.resize(archetype.capacity, false);
+      chunkAllocator->deallocate(trackedCollumn.chunks.back(), trackedCollumn.chunk_bytes(), trackedCollumn.containerAlignment);
+      trackedCollumn.chunks.pop_back();
     }
   }
+  for (Collumn &collumn : collumns)
+    collumn.chunkVersions.pop_back();
+}
+
+void Archetype::mark_chunk_written(uint32_t chunk_idx)
+{
+  const uint64_t version = getChangeVersion();
+  for (Collumn &collumn : collumns)
+    collumn.chunkVersions[chunk_idx] = version;
+}
+
+uint32_t Archetype::release_empty_chunks(uint32_t max_chunks)
+{
+  const uint32_t usedChunkCount = getUsedChunkCount();
+  uint32_t releasedCount = 0;
+  while (chunkCount > usedChunkCount && releasedCount < max_chunks)
+  {
+    release_last_chunk();
+    releasedCount++;
+  }
+  for (TrackedCollumn &trackedCollumn : trackedCollumns)
+    trackedCollumn.dirtyState.resize(capacity);
+  return releasedCount;
+}
+
+// pointer to the component for construction. SoA component is constructed in the temporary buffer
+// and scattered to the lanes on destruction
+struct ComponentWriter
+{
+  const Archetype &archetype;
+  Collumn &collumn;
+  uint32_t index;
+  alignas(std::max_align_t) char buffer[ecs::MAX_SOA_TYPE_SIZE];
+  void *data;
+  ComponentWriter(const Archetype &archetype, Collumn &collumn, uint32_t index) :
+    archetype(archetype), collumn(collumn), index(index), data(collumn.soaLaneCount ? buffer : archetype.getData(collumn, index)) {}
+  ~ComponentWriter()
+  {
+    if (collumn.soaLaneCount)
+      archetype.scatterData(collumn, index, buffer);
+  }
+};
+
+// copies component between collumns of the same type, SoA components are trivially copyable
+static void copy_component(const Archetype &archetype, Collumn &dst_collumn, uint32_t dst_index, const Collumn &src_collumn, uint32_t src_index)
+{
+  if (src_collumn.soaLaneCount)
+  {
+    alignas(std::max_align_t) char buffer[ecs::MAX_SOA_TYPE_SIZE];
+    archetype.gatherData(src_collumn, src_index, buffer);
+    archetype.scatterData(dst_collumn, dst_index, buffer);
+  }
+  else
+  {
+    src_collumn.typeDeclaration->copy_construct(archetype.getData(dst_collumn, dst_index), archetype.getData(src_collumn, src_index));
+  }
+}
+
+// moves component to the place of the destroyed one, source is destroyed too
+static void relocate_component(const Archetype &archetype, Collumn &collumn, uint32_t dst_index, uint32_t src_index)
+{
+  const ecs::TypeDeclaration *type_declaration = collumn.typeDeclaration;
+  void *dst = archetype.getData(collumn, dst_index);
+  void *src = archetype.getData(collumn, src_index);
+  if (type_declaration->isTriviallyRelocatable)
+  {
+    memcpy(dst, src, collumn.sizeOfElement);
+  }
+  else
+  {
+    type_declaration->move_construct(dst, src);
+    if (!type_declaration->isTriviallyDestructible)
+      type_declaration->destruct(src);
+  }
+}
+
+static uint64_t get_component_digest(const Archetype &archetype, const Collumn &collumn, uint32_t index)
+{
+  if (collumn.soaLaneCount)
+  {
+    alignas(std::max_align_t) char buffer[ecs::MAX_SOA_TYPE_SIZE];
+    archetype.gatherData(collumn, index, buffer);
+    return collumn.typeDeclaration->hash_value(buffer);
+  }
+  return collumn.typeDeclaration->hash_value(archetype.getData(collumn, index));
+}
+
+// tracked value of the new entity starts from the current one
+static void init_tracked_component(const Archetype &archetype, TrackedCollumn &tracked_collumn, const Collumn &collumn, uint32_t index)
+{
+  if (tracked_collumn.isDigest)
+    *(uint64_t *)archetype.getData(tracked_collumn, index) = get_component_digest(archetype, collumn, index);
+  else
+    copy_component(archetype, tracked_collumn, index, collumn, index);
+}
+
+static void try_add_chunk(Archetype &archetype, int requiredEntityCount)
+{
+  while (archetype.entityCount + requiredEntityCount > archetype.capacity)
+  {
+    archetype.add_chunk();
+  }
 }
 
-void add_entity_to_archetype(Archetype &archetype, ecs::EcsManager &mgr, const ecs::InitializerList &template_init, ecs::InitializerList &&override_list)
+struct OverrideData
+{
+  bool found = false;
+  void *data = nullptr; // nullptr means default construction
+  ecs::TypeId typeId = 0;
+};
+
+// find_override returns the override data for collumn
+template<typename FindOverride>
+static void add_entity_to_archetype(Archetype &archetype, ecs::EcsManager &mgr, const ecs::Template &template_record, ecs::EntityId eid, FindOverride &&find_override)
 {
   try_add_chunk(archetype, 1);
-  for (ecs_details::Collumn &collumn : archetype.collumns)
+  assert(template_record.recipe.size() == archetype.collumns.size());
+  for (uint32_t i = 0, n = archetype.collumns.size(); i < n; i++)
   {
-    void *dstData = archetype.getData(collumn, archetype.entityCount);
-    const ecs::TypeDeclaration *typeDeclaration = find_type_declaration(mgr.typeMap, collumn.typeId);
-    // firstly check initialization data in override_list and move it
-    auto it = override_list.args.find(collumn.componentId);
-    if (it != override_list.args.end())
+    ecs_details::Collumn &collumn = archetype.collumns[i];
+    const ComponentRecipe &recipe = template_record.recipe[i];
+    ComponentWriter writer(archetype, collumn, archetype.entityCount);
+    void *dstData = writer.data;
+    const ecs::TypeDeclaration *typeDeclaration = collumn.typeDeclaration;
+    if (recipe.source == ComponentRecipe::Source::EntityId)
     {
-      void *srcData = it->second.data();
+      new (dstData) ecs::EntityId(eid);
+      continue;
+    }
+    // firstly check initialization data in overrides and move it
+    const OverrideData overrideData = find_override(collumn, recipe);
+    if (overrideData.found)
+    {
+      void *srcData = overrideData.data;
       if (srcData != nullptr)
       {
-        if (it->second.typeId == typeDeclaration->typeId)
+        if (overrideData.typeId == typeDeclaration->typeId)
         {
           typeDeclaration->move_construct(dstData, srcData);
           continue;
         }
         else
         {
-          const char *componentName = mgr.componentMap.find(it->first)->second->name.c_str();
-          const char *receivedType = mgr.typeMap.find(it->second.typeId)->second.typeName.c_str();
-          const char *expectedType = mgr.typeMap.find(collumn.typeId)->second.typeName.c_str();
+          const char *componentName = mgr.componentMap.find(collumn.componentId)->second->name.c_str();
+          const char *receivedType = mgr.typeMap.find(overrideData.typeId)->second->typeName.c_str();
+          const char *expectedType = typeDeclaration->typeName.c_str();
           ECS_LOG_ERROR(mgr).log("Component %s has type %s but expected %s, during create_entity",
             componentName, receivedType, expectedType);
         }
@@ -113,12 +351,10 @@ void add_entity_to_archetype(Archetype &archetype, ecs::EcsManager &mgr, const e
         continue;
       }
     }
-    // then check initialization data in template_init and copy it
-    auto it2 = template_init.args.find(collumn.componentId);
-    if (it2 != template_init.args.end())
+    // then copy template data
+    if (recipe.source == ComponentRecipe::Source::TemplateData)
     {
-      assert(it2->second.typeId == collumn.typeId);
-      typeDeclaration->copy_construct(dstData, it2->second.data());
+      typeDeclaration->copy_construct(dstData, recipe.templateData->data());
       continue;
     }
     // if there is no initialization data, construct default
@@ -130,23 +366,53 @@ void add_entity_to_archetype(Archetype &archetype, ecs::EcsManager &mgr, const e
   for (ecs_details::TrackedCollumn &trackedCollumn : archetype.trackedCollumns)
   {
     const ecs_details::Collumn &collumn = archetype.collumns[trackedCollumn.collumnIdx];
-    const ecs::TypeDeclaration *typeDeclaration = find_type_declaration(mgr.typeMap, collumn.typeId);
-    const void *srcData = archetype.getData(collumn, archetype.entityCount);
-    void *trackedData = archetype.getData(trackedCollumn, archetype.entityCount);
-    typeDeclaration->copy_construct(trackedData, srcData);
+    init_tracked_component(archetype, trackedCollumn, collumn, archetype.entityCount);
   }
 
+  archetype.mark_chunk_written(archetype.entityCount >> archetype.chunkSizePower);
   archetype.entityCount++;
+}
+
+void add_entity_to_archetype(Archetype &archetype, ecs::EcsManager &mgr, const ecs::Template &template_record, ecs::EntityId eid, ecs::InitializerList &&override_list)
+{
+  const bool hasOverrides = !override_list.args.empty();
+  add_entity_to_archetype(archetype, mgr, template_record, eid, [&](const Collumn &collumn, const ComponentRecipe &) -> OverrideData {
+    if (!hasOverrides)
+      return {};
+    auto it = override_list.args.find(collumn.componentId);
+    return it != override_list.args.end() ? OverrideData{true, it->second.data(), it->second.typeId} : OverrideData{};
+  });
   ecs_details::consume_init_list(mgr, std::move(override_list));
 }
 
+void add_entity_to_archetype(Archetype &archetype, ecs::EcsManager &mgr, const ecs::Template &template_record, ecs::EntityId eid, ecs::FlatInitializerList &&override_list)
+{
+  add_entity_to_archetype(archetype, mgr, template_record, eid, [&](const Collumn &collumn, const ComponentRecipe &) -> OverrideData {
+    if (override_list.empty())
+      return {};
+    const ecs::FlatInitializerList::Entry *entry = override_list.find(collumn.componentId);
+    return entry ? OverrideData{true, override_list.data(*entry), entry->typeId} : OverrideData{};
+  });
+  override_list.clear();
+}
+
+void add_entity_to_archetype(Archetype &archetype, ecs::EcsManager &mgr, const ecs::Template &template_record, ecs::EntityId eid, std::span<ecs::Any> overrides)
+{
+  add_entity_to_archetype(archetype, mgr, template_record, eid, [&](const Collumn &, const ComponentRecipe &recipe) -> OverrideData {
+    if (recipe.overrideSlot < 0 || recipe.overrideSlot >= (int)overrides.size())
+      return {};
+    ecs::Any &overrideData = overrides[recipe.overrideSlot];
+    return OverrideData{true, overrideData.data(), overrideData.typeId};
+  });
+}
+
 void add_entities_to_archetype(Archetype &archetype, ecs::EcsManager &mgr, const ecs::InitializerList &template_init, ecs::InitializerSoaList &&override_soa_list)
 {
   int requiredEntityCount = override_soa_list.size();
   try_add_chunk(archetype, requiredEntityCount);
   for (ecs_details::Collumn &collumn : archetype.collumns)
   {
-    const ecs::TypeDeclaration *typeDeclaration = find_type_declaration(mgr.typeMap, collumn.typeId);
+    const ecs::TypeDeclaration *typeDeclaration = collumn.typeDeclaration;
 
     // firstly check initialization data in override_soa_list and move it
     auto it = override_soa_list.args.find(collumn.componentId);
@@ -155,17 +421,31 @@ void add_entities_to_archetype(Archetype &archetype, ecs::EcsManager &mgr, const
       ecs::ComponentDataSoa &componentDataSoa = it->second;
       if (componentDataSoa.typeId == collumn.typeId)
       {
-        for (int i = 0; i < requiredEntityCount; i++)
+        // source vector destroys its elements later, so memcpy is valid only for trivially destructible types
+        if (collumn.soaLaneCount)
         {
-          typeDeclaration->move_construct(archetype.getData(collumn, archetype.entityCount + i), componentDataSoa.get_data(i));
+          for (int i = 0; i < requiredEntityCount; i++)
+            archetype.scatterData(collumn, archetype.entityCount + i, componentDataSoa.get_data(i));
+        }
+        else
+        {
+          const bool canMemcpy = typeDeclaration->isTriviallyRelocatable && typeDeclaration->isTriviallyDestructible;
+          const uint32_t startIndex = archetype.entityCount;
+          for_each_chunk_part(archetype, startIndex, requiredEntityCount, [&](uint32_t first, uint32_t count) {
+            void *src = componentDataSoa.get_data(first - startIndex);
+            if (canMemcpy)
+              memcpy(archetype.getData(collumn, first), src, count * collumn.sizeOfElement);
+            else
+              typeDeclaration->move_construct_n(archetype.getData(collumn, first), src, count);
+          });
         }
         continue;
       }
       else
       {
         const char *componentName = mgr.componentMap.find(it->first)->second->name.c_str();
-        const char *receivedType = mgr.typeMap.find(componentDataSoa.typeId)->second.typeName.c_str();
-        const char *expectedType = mgr.typeMap.find(collumn.typeId)->second.typeName.c_str();
+        const char *receivedType = mgr.typeMap.find(componentDataSoa.typeId)->second->typeName.c_str();
+        const char *expectedType = mgr.typeMap.find(collumn.typeId)->second->typeName.c_str();
         ECS_LOG_ERROR(mgr).log("Component %s has type %s but expected %s, during create_entities",
           componentName, receivedType, expectedType);
       }
@@ -177,14 +457,14 @@ void add_entities_to_archetype(Archetype &archetype, ecs::EcsManager &mgr, const
       const ecs::Any &componentData = it2->second;
       for (int i = 0; i < requiredEntityCount; i++)
       {
-        typeDeclaration->copy_construct(archetype.getData(collumn, archetype.entityCount + i), componentData.data());
+        typeDeclaration->copy_construct(ComponentWriter(archetype, collumn, archetype.entityCount + i).data, componentData.data());
       }
       continue;
     }
     // if there is no initialization data, construct default
     for (int i = 0; i < requiredEntityCount; i++)
     {
-      typeDeclaration->construct_default(archetype.getData(collumn, archetype.entityCount + i));
+      typeDeclaration->construct_default(ComponentWriter(archetype, collumn, archetype.entityCount + i).data);
     }
     // but this is error because we have to have initialization data for all components
     ECS_LOG_ERROR(mgr).log("No initialization data for component %s", collumn.debugName.c_str());
@@ -193,68 +473,137 @@ void add_entities_to_archetype(Archetype &archetype, ecs::EcsManager &mgr, const
   for (ecs_details::TrackedCollumn &trackedCollumn : archetype.trackedCollumns)
   {
     const ecs_details::Collumn &collumn = archetype.collumns[trackedCollumn.collumnIdx];
-    const ecs::TypeDeclaration *typeDeclaration = find_type_declaration(mgr.typeMap, collumn.typeId);
-
-    for (int i = 0; i < requiredEntityCount; i++)
+    if (collumn.soaLaneCount || trackedCollumn.isDigest)
     {
-      const void *srcData = archetype.getData(collumn, archetype.entityCount + i);
-      void *trackedData = archetype.getData(trackedCollumn, archetype.entityCount + i);
-      typeDeclaration->copy_construct(trackedData, srcData);
+      for (int i = 0; i < requiredEntityCount; i++)
+        init_tracked_component(archetype, trackedCollumn, collumn, archetype.entityCount + i);
+      continue;
     }
+    for_each_chunk_part(archetype, archetype.entityCount, requiredEntityCount, [&](uint32_t first, uint32_t count) {
+      collumn.typeDeclaration->copy_construct_n(archetype.getData(trackedCollumn, first), archetype.getData(collumn, first), count);
+    });
   }
 
+  for_each_chunk_part(archetype, archetype.entityCount, requiredEntityCount, [&](uint32_t first, uint32_t) {
+    archetype.mark_chunk_written(first >> archetype.chunkSizePower);
+  });
   archetype.entityCount += requiredEntityCount;
 }
 
-static void remove_entity_from_archetype_collumn(Archetype &archetype, ecs_details::Collumn &collumn, const ecs::TypeDeclarationMap &type_map, uint32_t entityIndex)
+static void remove_entity_from_archetype_collumn(Archetype &archetype, ecs_details::Collumn &collumn, uint32_t entityIndex)
 {
-  const ecs::TypeDeclaration *typeDeclaration = find_type_declaration(type_map, collumn.typeId);
-  void *removedEntityComponentPtr = archetype.getData(collumn, entityIndex);
-  typeDeclaration->destruct(removedEntityComponentPtr);
+  const ecs::TypeDeclaration *typeDeclaration = collumn.typeDeclaration;
+  if (collumn.soaLaneCount)
+  {
+    if (entityIndex != archetype.entityCount - 1)
+      copy_component(archetype, collumn, entityIndex, collumn, archetype.entityCount - 1);
+    return;
+  }
+  if (!typeDeclaration->isTriviallyDestructible)
+    typeDeclaration->destruct(archetype.getData(collumn, entityIndex));
   if (entityIndex != archetype.entityCount - 1)
   {
-    void *lastEntityComponentPtr = archetype.getData(collumn, archetype.entityCount - 1);
-    typeDeclaration->move_construct(removedEntityComponentPtr, lastEntityComponentPtr);
+    relocate_component(archetype, collumn, entityIndex, archetype.entityCount - 1);
   }
 }
 
-void remove_entity_from_archetype(Archetype &archetype, const ecs::TypeDeclarationMap &type_map, uint32_t entityIndex)
+void remove_entity_from_archetype(Archetype &archetype, uint32_t entityIndex)
 {
   for (ecs_details::Collumn &collumn : archetype.collumns)
   {
-    remove_entity_from_archetype_collumn(archetype, collumn, type_map, entityIndex);
+    remove_entity_from_archetype_collumn(archetype, collumn, entityIndex);
   }
   for (ecs_details::TrackedCollumn &collumn : archetype.trackedCollumns)
   {
-    remove_entity_from_archetype_collumn(archetype, collumn, type_map, entityIndex);
+    remove_entity_from_archetype_collumn(archetype, collumn, entityIndex);
     if (entityIndex != archetype.entityCount - 1)
     {
-      const bool isDirty = collumn.dirtyState[archetype.entityCount - 1];
-      collumn.dirtyState[entityIndex] = isDirty;
+      collumn.dirtyState.assign(entityIndex, collumn.dirtyState.test(archetype.entityCount - 1));
     }
   }
+  if (entityIndex != archetype.entityCount - 1)
+    archetype.mark_chunk_written(entityIndex >> archetype.chunkSizePower);
   archetype.entityCount--;
 }
 
-static void destroy_all_entities_from_archetype_collumn(Archetype &archetype, ecs_details::Collumn &collumn, const ecs::TypeDeclarationMap &type_map)
+using EntityMove = std::pair<uint32_t, uint32_t>; // (hole, source)
+
+static void remove_entities_from_archetype_collumn(Archetype &archetype, ecs_details::Collumn &collumn, std::span<const uint32_t> sorted_indices, std::span<const EntityMove> moves)
+{
+  const ecs::TypeDeclaration *typeDeclaration = collumn.typeDeclaration;
+  if (collumn.soaLaneCount)
+  {
+    for (const auto &[hole, source] : moves)
+      copy_component(archetype, collumn, hole, collumn, source);
+    return;
+  }
+  if (!typeDeclaration->isTriviallyDestructible)
+  {
+    for (uint32_t entityIndex : sorted_indices)
+    {
+      typeDeclaration->destruct(archetype.getData(collumn, entityIndex));
+    }
+  }
+  for (const auto &[hole, source] : moves)
+  {
+    relocate_component(archetype, collumn, hole, source);
+  }
+}
+
+void remove_entities_from_archetype(Archetype &archetype, std::span<const uint32_t> sorted_indices)
 {
-  const ecs::TypeDeclaration *typeDeclaration = find_type_declaration(type_map, collumn.typeId);
-  for (uint32_t i = 0; i < archetype.entityCount; i++)
+  const uint32_t removedCount = sorted_indices.size();
+  const uint32_t newEntityCount = archetype.entityCount - removedCount;
+  // every hole below newEntityCount takes the last entity which is not removed
+  std::vector<EntityMove> moves;
+  for (uint32_t i = 0, source = archetype.entityCount, tail = removedCount; i < removedCount && sorted_indices[i] < newEntityCount; i++)
   {
-    void *entityComponentPtr = archetype.getData(collumn, i);
-    typeDeclaration->destruct(entityComponentPtr);
+    source--;
+    while (tail > 0 && sorted_indices[tail - 1] == source)
+    {
+      tail--;
+      source--;
+    }
+    moves.emplace_back(sorted_indices[i], source);
   }
+
+  for (ecs_details::Collumn &collumn : archetype.collumns)
+  {
+    remove_entities_from_archetype_collumn(archetype, collumn, sorted_indices, moves);
+  }
+  for (ecs_details::TrackedCollumn &collumn : archetype.trackedCollumns)
+  {
+    remove_entities_from_archetype_collumn(archetype, collumn, sorted_indices, moves);
+    for (const auto &[hole, source] : moves)
+    {
+      collumn.dirtyState.assign(hole, collumn.dirtyState.test(source));
+    }
+  }
+  for (const auto &[hole, source] : moves)
+    archetype.mark_chunk_written(hole >> archetype.chunkSizePower);
+  archetype.entityCount = newEntityCount;
+}
+
+static void destroy_all_entities_from_archetype_collumn(Archetype &archetype, ecs_details::Collumn &collumn)
+{
+  const ecs::TypeDeclaration *typeDeclaration = collumn.typeDeclaration;
+  // SoA components are trivially destructible
+  if (collumn.soaLaneCount || typeDeclaration->isTriviallyDestructible)
+    return;
+  for_each_chunk_part(archetype, 0, archetype.entityCount, [&](uint32_t first, uint32_t count) {
+    typeDeclaration->destruct_n(archetype.getData(collumn, first), count);
+  });
 }
 
-void destroy_all_entities_from_archetype(Archetype &archetype, const ecs::TypeDeclarationMap &type_map)
+void destroy_all_entities_from_archetype(Archetype &archetype)
 {
   for (ecs_details::Collumn &collumn : archetype.collumns)
   {
-    destroy_all_entities_from_archetype_collumn(archetype, collumn, type_map);
+    destroy_all_entities_from_archetype_collumn(archetype, collumn);
   }
   for (ecs_details::TrackedCollumn &collumn : archetype.trackedCollumns)
   {
-    destroy_all_entities_from_archetype_collumn(archetype, collumn, type_map);
+    destroy_all_entities_from_archetype_collumn(archetype, collumn);
   }
   archetype.entityCount = 0;
 }
@@ -268,13 +617,13 @@ bool try_registrate_track(ecs::EcsManager &mgr, const std::vector<ecs::Component
     if (componentIndex != -1)
     {
       const ecs::TypeDeclaration *typeDeclaration = ecs_details::find_type_declaration(mgr.typeMap, ecs::get_type_id(componentId));
-      if (!typeDeclaration->compare_and_assign)
+      if (!typeDeclaration->compare_and_assign && !archetype.trackedCollumns[componentIndex].isDigest)
       {
         ECS_LOG_ERROR(mgr).log("Type %s has no compare_and_assign function, and can't be tracked", typeDeclaration->typeName.c_str());
         continue;
       }
       assert(componentIndex < ecs_details::MAX_TRACKED_COMPONENTS);
-      mask |= 1u << componentIndex;
+      mask |= TrackMask(1) << componentIndex;
     }
   }
   if (mask != 0u)
@@ -288,9 +637,29 @@ bool try_registrate_track(ecs::EcsManager &mgr, const std::vector<ecs::Component
   }
 }
 
-static void register_archetype(ecs::EcsManager &mgr, ecs_details::Archetype &&archetype)
+void build_event_handler_table(ecs::EcsManager &mgr, Archetype &archetype)
+{
+  archetype.eventHandlers.clear();
+  archetype.eventToHandlers.clear();
+  for (const auto &[eventId, handlers] : mgr.eventIdToHandlers)
+  {
+    const uint32_t offset = archetype.eventHandlers.size();
+    for (ecs::NameHash handlerId : handlers)
+    {
+      auto hndlIt = mgr.events.find(handlerId);
+      if (hndlIt == mgr.events.end())
+        continue;
+      int archetypeIdx = hndlIt->second.find_archetype(archetype.archetypeId);
+      if (archetypeIdx != -1)
+        archetype.eventHandlers.push_back({&hndlIt->second, (uint32_t)archetypeIdx});
+    }
+    if (archetype.eventHandlers.size() > offset)
+      archetype.eventToHandlers.emplace(eventId, std::make_pair(offset, uint32_t(archetype.eventHandlers.size() - offset)));
+  }
+}
+
+static void register_archetype(ecs::EcsManager &mgr, std::unique_ptr<ecs_details::Archetype> &&archetypePtr)
 {
-  std::unique_ptr<ecs_details::Archetype> archetypePtr = std::make_unique<ecs_details::Archetype>(std::move(archetype));
   for (auto &[id, query] : mgr.queries)
   {
     try_registrate(mgr, query, archetypePtr.get());
@@ -310,10 +679,153 @@ static void register_archetype(ecs::EcsManager &mgr, ecs_details::Archetype &&ar
       ecs_details::try_registrate_track(mgr, query.trackedComponents, *archetypePtr, query.nameHash);
     }
   }
-  mgr.archetypeMap[archetype.archetypeId] = std::move(archetypePtr);
+  build_event_handler_table(mgr, *archetypePtr);
+  const ecs::ArchetypeId archetypeId = archetypePtr->archetypeId;
+  mgr.archetypeList.push_back(archetypePtr.get());
+  mgr.archetypeMap[archetypeId] = std::move(archetypePtr);
+}
+
+static Archetype *get_or_create_archetype(ecs::EcsManager &mgr, ArchetypeComponentType &&type, ecs::ArchetypeChunkSize chunk_size_power, ecs::ArchetypeChunkLayout chunk_layout)
+{
+  const ecs::ArchetypeId archetypeId = get_archetype_id(type);
+  auto it = mgr.archetypeMap.find(archetypeId);
+  if (it != mgr.archetypeMap.end())
+  {
+    if (it->second->type != type)
+    {
+      ECS_LOG_ERROR(mgr).log("Archetype id %x collision, archetypes with different components are merged", archetypeId);
+      assert(false && "archetype id collision");
+    }
+    return it->second.get();
+  }
+  std::unique_ptr<Archetype> archetype = std::make_unique<Archetype>(mgr, archetypeId, std::move(type), chunk_size_power, chunk_layout);
+  Archetype *archetypePtr = archetype.get();
+  register_archetype(mgr, std::move(archetype));
+  return archetypePtr;
+}
+
+static ArchetypeTransition make_transition(const Archetype &source, Archetype &target, ecs::ComponentId removed_component)
+{
+  ArchetypeTransition transition;
+  transition.target = &target;
+  transition.sourceCollumns.reserve(target.collumns.size());
+  for (const Collumn &collumn : target.collumns)
+    transition.sourceCollumns.push_back(source.getComponentCollumnIndex(collumn.componentId));
+  transition.removedCollumn = source.getComponentCollumnIndex(removed_component);
+  return transition;
+}
+
+const ArchetypeTransition *get_add_component_transition(ecs::EcsManager &mgr, Archetype &archetype, ecs::ComponentId component_id)
+{
+  auto it = archetype.addTransitions.find(component_id);
+  if (it != archetype.addTransitions.end())
+    return &it->second;
+  if (archetype.type.count(component_id) > 0)
+    return nullptr;
+  if (find_type_declaration(mgr.typeMap, ecs::get_type_id(component_id)) == nullptr)
+  {
+    ECS_LOG_ERROR(mgr).log("Type with hash %x not found", ecs::get_type_id(component_id));
+    return nullptr;
+  }
+  ArchetypeComponentType type = archetype.type;
+  type.emplace(component_id, false);
+  Archetype *target = get_or_create_archetype(mgr, std::move(type), ecs::ArchetypeChunkSize(archetype.chunkSizePower), archetype.chunkLayout);
+  return &archetype.addTransitions.emplace(component_id, make_transition(archetype, *target, component_id)).first->second;
+}
+
+const ArchetypeTransition *get_remove_component_transition(ecs::EcsManager &mgr, Archetype &archetype, ecs::ComponentId component_id)
+{
+  auto it = archetype.removeTransitions.find(component_id);
+  if (it != archetype.removeTransitions.end())
+    return &it->second;
+  if (archetype.type.count(component_id) == 0)
+    return nullptr;
+  ArchetypeComponentType type = archetype.type;
+  type.erase(component_id);
+  Archetype *target = get_or_create_archetype(mgr, std::move(type), ecs::ArchetypeChunkSize(archetype.chunkSizePower), archetype.chunkLayout);
+  return &archetype.removeTransitions.emplace(component_id, make_transition(archetype, *target, component_id)).first->second;
+}
+
+// moves component to the other archetype, source is destroyed
+static void relocate_component(const Archetype &dst_archetype, Collumn &dst_collumn, uint32_t dst_index, const Archetype &src_archetype, Collumn &src_collumn, uint32_t src_index)
+{
+  if (src_collumn.soaLaneCount)
+  {
+    alignas(std::max_align_t) char buffer[ecs::MAX_SOA_TYPE_SIZE];
+    src_archetype.gatherData(src_collumn, src_index, buffer);
+    dst_archetype.scatterData(dst_collumn, dst_index, buffer);
+    return;
+  }
+  const ecs::TypeDeclaration *typeDeclaration = src_collumn.typeDeclaration;
+  void *dst = dst_archetype.getData(dst_collumn, dst_index);
+  void *src = src_archetype.getData(src_collumn, src_index);
+  if (typeDeclaration->isTriviallyRelocatable)
+  {
+    memcpy(dst, src, src_collumn.sizeOfElement);
+  }
+  else
+  {
+    typeDeclaration->move_construct(dst, src);
+    if (!typeDeclaration->isTriviallyDestructible)
+      typeDeclaration->destruct(src);
+  }
+}
+
+uint32_t move_entity_to_archetype(Archetype &archetype, uint32_t entity_index, const ArchetypeTransition &transition, void *new_component_data)
+{
+  Archetype &target = *transition.target;
+  try_add_chunk(target, 1);
+  const uint32_t targetIndex = target.entityCount;
+  for (uint32_t i = 0, n = target.collumns.size(); i < n; i++)
+  {
+    Collumn &collumn = target.collumns[i];
+    const int sourceCollumn = transition.sourceCollumns[i];
+    if (sourceCollumn >= 0)
+    {
+      relocate_component(target, collumn, targetIndex, archetype, archetype.collumns[sourceCollumn], entity_index);
+      continue;
+    }
+    ComponentWriter writer(target, collumn, targetIndex);
+    if (new_component_data)
+      collumn.typeDeclaration->move_construct(writer.data, new_component_data);
+    else
+      collumn.typeDeclaration->construct_default(writer.data);
+  }
+  // tracked values start from the current ones, so transition doesn't trigger track events
+  for (TrackedCollumn &trackedCollumn : target.trackedCollumns)
+  {
+    init_tracked_component(target, trackedCollumn, target.collumns[trackedCollumn.collumnIdx], targetIndex);
+    trackedCollumn.dirtyState.assign(targetIndex, false);
+  }
+  target.mark_chunk_written(targetIndex >> target.chunkSizePower);
+  target.entityCount++;
+
+  if (transition.removedCollumn >= 0)
+  {
+    Collumn &removedCollumn = archetype.collumns[transition.removedCollumn];
+    if (!removedCollumn.soaLaneCount && !removedCollumn.typeDeclaration->isTriviallyDestructible)
+      removedCollumn.typeDeclaration->destruct(archetype.getData(removedCollumn, entity_index));
+  }
+  // components of entity_index are moved out already, the last entity fills the hole
+  const uint32_t lastIndex = archetype.entityCount - 1;
+  for (Collumn &collumn : archetype.collumns)
+  {
+    if (entity_index != lastIndex)
+      relocate_component(archetype, collumn, entity_index, archetype, collumn, lastIndex);
+  }
+  for (TrackedCollumn &trackedCollumn : archetype.trackedCollumns)
+  {
+    remove_entity_from_archetype_collumn(archetype, trackedCollumn, entity_index);
+    if (entity_index != lastIndex)
+      trackedCollumn.dirtyState.assign(entity_index, trackedCollumn.dirtyState.test(lastIndex));
+  }
+  if (entity_index != lastIndex)
+    archetype.mark_chunk_written(entity_index >> archetype.chunkSizePower);
+  archetype.entityCount--;
+  return targetIndex;
 }
 
-ecs::ArchetypeId get_or_create_archetype(ecs::EcsManager &mgr, ecs::InitializerList &components, const ecs::TrackedComponentMap &tracked_component_map, ecs::ArchetypeChunkSize chunk_size_power, const char *template_name)
+ecs::ArchetypeId get_or_create_archetype(ecs::EcsManager &mgr, ecs::InitializerList &components, const ecs::TrackedComponentMap &tracked_component_map, ecs::ArchetypeChunkSize chunk_size_power, ecs::ArchetypeChunkLayout chunk_layout, const char *template_name)
 {
   ArchetypeComponentType type;
   type.reserve(components.size());
@@ -334,15 +846,15 @@ ecs::ArchetypeId get_or_create_archetype(ecs::EcsManager &mgr, ecs::InitializerL
       else
       {
         const char *componentName = cmpIt->second->name.c_str();
-        const char *receivedType = mgr.typeMap.find(arg.second.typeId)->second.typeName.c_str();
-        const char *expectedType = mgr.typeMap.find(cmpIt->second->typeId)->second.typeName.c_str();
+        const char *receivedType = mgr.typeMap.find(arg.second.typeId)->second->typeName.c_str();
+        const char *expectedType = mgr.typeMap.find(cmpIt->second->typeId)->second->typeName.c_str();
         ECS_LOG_ERROR(mgr).log("Component %s has type %s but expected %s, during instantiation template \"%s\"",
           componentName, receivedType, expectedType, template_name);
       }
     }
     else
     {
-      const char *receivedType = mgr.typeMap.find(arg.second.typeId)->second.typeName.c_str();
+      const char *receivedType = mgr.typeMap.find(arg.second.typeId)->second->typeName.c_str();
       ECS_LOG_ERROR(mgr).log("Component %llx of type %s not found, during instantiation template \"%s\"", arg.first, receivedType, template_name);
     }
 
@@ -350,47 +862,147 @@ ecs::ArchetypeId get_or_create_archetype(ecs::EcsManager &mgr, ecs::InitializerL
     continue;
   }
 
-  ecs::ArchetypeId archetypeId = get_archetype_id(type);
+  return get_or_create_archetype(mgr, std::move(type), chunk_size_power, chunk_layout)->archetypeId;
+}
+
 
-  if (mgr.archetypeMap.find(archetypeId) == mgr.archetypeMap.end())
+// compares the component with its tracked copy and updates the copy, returns true if it was changed
+static bool track_component(Archetype &archetype, const Collumn &collumn, TrackedCollumn &tracked_collumn, uint32_t linear_index)
+{
+  const ecs::TypeDeclaration *typeDeclaration = collumn.typeDeclaration;
+  if (tracked_collumn.isDigest)
+  {
+    const uint64_t digest = get_component_digest(archetype, collumn, linear_index);
+    uint64_t &oldDigest = *(uint64_t *)archetype.getData(tracked_collumn, linear_index);
+    if (digest == oldDigest)
+      return false;
+    oldDigest = digest;
+    return true;
+  }
+  if (collumn.soaLaneCount)
   {
-    register_archetype(mgr, Archetype(mgr, archetypeId, std::move(type), chunk_size_power));
+    alignas(std::max_align_t) char newComponent[ecs::MAX_SOA_TYPE_SIZE];
+    alignas(std::max_align_t) char oldComponent[ecs::MAX_SOA_TYPE_SIZE];
+    archetype.gatherData(collumn, linear_index, newComponent);
+    archetype.gatherData(tracked_collumn, linear_index, oldComponent);
+    assert(typeDeclaration->compare_and_assign != nullptr);
+    if (!typeDeclaration->compare_and_assign(newComponent, oldComponent))
+      return false;
+    archetype.scatterData(tracked_collumn, linear_index, oldComponent);
+    return true;
   }
-
-  return archetypeId;
+  const char *newComponentPtr = archetype.getData(collumn, linear_index);
+  char *oldComponentPtr = archetype.getData(tracked_collumn, linear_index);
+  if (typeDeclaration->isBitwiseComparable)
+  {
+    if (memcmp(newComponentPtr, oldComponentPtr, collumn.sizeOfElement) == 0)
+      return false;
+    memcpy(oldComponentPtr, newComponentPtr, collumn.sizeOfElement);
+    return true;
+  }
+  assert(typeDeclaration->compare_and_assign != nullptr);
+  return typeDeclaration->compare_and_assign(newComponentPtr, oldComponentPtr);
 }
 
+// compares [chunk_begin, chunk_begin + count) part of the tracked collumn, all of it or only dirty entities.
+// Sets track_bit in entity_masks (indexed from chunk_begin) for changed entities, returns track_bit if any of them changed
+static TrackMask track_collumn_chunk(Archetype &archetype, const Collumn &collumn, TrackedCollumn &tracked_collumn,
+  uint32_t chunk_idx, uint32_t count, TrackMask track_bit, TrackMask *entity_masks)
+{
+  const uint32_t chunkBegin = chunk_idx << archetype.chunkSizePower;
+  TrackMask chunkMask = 0u;
+
+  if ((tracked_collumn.dirtyFlags & TrackedCollumn::DIRTY_ALL) == 0u)
+  {
+    // only entities marked by mark_dirty(index) can be changed
+    if (!tracked_collumn.dirtyState.test_chunk(chunk_idx))
+      return 0u;
+    tracked_collumn.dirtyState.for_each_set(chunkBegin, chunkBegin + count, [&](uint32_t linear_index) {
+      if (track_component(archetype, collumn, tracked_collumn, linear_index))
+      {
+        entity_masks[linear_index - chunkBegin] |= track_bit;
+        chunkMask = track_bit;
+      }
+    });
+    return chunkMask;
+  }
+
+  if (collumn.typeDeclaration->isBitwiseComparable && !tracked_collumn.isDigest)
+  {
+    // usually nothing changed, one memcmp per chunk (or SoA lane) skips it
+    const char *newChunk = collumn.chunks[chunk_idx];
+    const char *oldChunk = tracked_collumn.chunks[chunk_idx];
+    bool changed = false;
+    if (collumn.soaLaneCount == 0)
+    {
+      changed = memcmp(newChunk, oldChunk, count * collumn.sizeOfElement) != 0;
+    }
+    else
+    {
+      for (uint32_t lane = 0; lane < collumn.soaLaneCount && !changed; lane++)
+      {
+        const uint32_t laneOffset = lane * collumn.chunkSize * collumn.soaLaneSize;
+        changed = memcmp(newChunk + laneOffset, oldChunk + laneOffset, count * collumn.soaLaneSize) != 0;
+      }
+    }
+    if (!changed)
+      return 0u;
+  }
+  for (uint32_t i = 0; i < count; i++)
+  {
+    if (track_component(archetype, collumn, tracked_collumn, chunkBegin + i))
+    {
+      entity_masks[i] |= track_bit;
+      chunkMask = track_bit;
+    }
+  }
+  return chunkMask;
+}
 
 void track_changes(ecs::EcsManager &mgr, ecs_details::Archetype &archetype)
 {
   if (archetype.trackedEvents.empty() || archetype.trackedCollumns.empty())
     return;
 
-  std::vector<TrackMask> trackMaskPerEntity;
-  trackMaskPerEntity.reserve(archetype.entityCount);
-  for (uint32_t i = 0; i < archetype.entityCount; i++)
+  TrackMask dirtyCollumns = 0u;
+  for (uint32_t j = 0, n = archetype.trackedCollumns.size(); j < n; j++)
   {
-    ecs_details::TrackMask entityMask = 0u;
+    assert(j < ecs_details::MAX_TRACKED_COMPONENTS);
+    if (archetype.trackedCollumns[j].dirtyFlags != ecs_details::TrackedCollumn::CLEAN)
+      dirtyCollumns |= TrackMask(1) << j;
+  }
 
-    for (uint32_t j = 0, n = archetype.trackedCollumns.size(); j < n; j++)
-    {
-      ecs_details::TrackedCollumn &trackedCollumn = archetype.trackedCollumns[j];
-      if (trackedCollumn.dirtyFlags == ecs_details::TrackedCollumn::CLEAN)
-        continue;
-      const ecs_details::Collumn &collumn = archetype.collumns[trackedCollumn.collumnIdx];
-
-      const ecs::TypeDeclaration *typeDeclaration = find_type_declaration(mgr.typeMap, collumn.typeId);
-      assert(typeDeclaration->compare_and_assign != nullptr);
-      const char *newComponentPtr = archetype.getData(collumn, i);
-      char *oldComponentPtr = archetype.getData(trackedCollumn, i);
-      bool changed = typeDeclaration->compare_and_assign(newComponentPtr, oldComponentPtr);
-      if (changed)
+  const uint32_t chunkCount = archetype.getUsedChunkCount();
+  std::vector<TrackMask> trackMaskPerEntity;
+  std::vector<TrackMask> trackMaskPerChunk; // union of the entity masks of the chunk
+  if (dirtyCollumns != 0u && chunkCount > 0)
+  {
+    trackMaskPerEntity.resize(archetype.entityCount, 0u);
+    trackMaskPerChunk.resize(chunkCount, 0u);
+    // chunks are independent, so they are compared in parallel, collumn by collumn inside the chunk
+    const auto track_chunk = [&](uint32_t chunk_idx) {
+      const uint32_t chunkBegin = chunk_idx << archetype.chunkSizePower;
+      const uint32_t count = std::min(archetype.chunkSize, archetype.entityCount - chunkBegin);
+      TrackMask chunkMask = 0u;
+      for (uint32_t j = 0, n = archetype.trackedCollumns.size(); j < n; j++)
       {
-        assert(j < ecs_details::MAX_TRACKED_COMPONENTS);
-        entityMask |= 1u << j;
+        if ((dirtyCollumns & (TrackMask(1) << j)) == 0u)
+          continue;
+        TrackedCollumn &trackedCollumn = archetype.trackedCollumns[j];
+        const Collumn &collumn = archetype.collumns[trackedCollumn.collumnIdx];
+        chunkMask |= track_collumn_chunk(archetype, collumn, trackedCollumn, chunk_idx, count, TrackMask(1) << j, trackMaskPerEntity.data() + chunkBegin);
       }
+      trackMaskPerChunk[chunk_idx] = chunkMask;
+    };
+    if (mgr.jobScheduler)
+    {
+      mgr.jobScheduler->parallel_for(chunkCount, track_chunk);
+    }
+    else
+    {
+      for (uint32_t chunkIdx = 0; chunkIdx < chunkCount; chunkIdx++)
+        track_chunk(chunkIdx);
     }
-    trackMaskPerEntity.emplace_back(entityMask);
   }
 
   for (ecs_details::TrackedCollumn &trackedCollumn : archetype.trackedCollumns)
@@ -398,17 +1010,25 @@ void track_changes(ecs::EcsManager &mgr, ecs_details::Archetype &archetype)
     trackedCollumn.reset_dirty();
   }
 
+  // events can change the archetype, so they are sent after comparison on the calling thread
   const ecs::OnTrack event;
-  for (uint32_t i = 0, n = trackMaskPerEntity.size(); i < n; i++)
+  for (uint32_t chunkIdx = 0, n = trackMaskPerChunk.size(); chunkIdx < n; chunkIdx++)
   {
-    ecs_details::TrackMask entityMask = trackMaskPerEntity[i];
-    if (entityMask != 0u)
+    if (trackMaskPerChunk[chunkIdx] == 0u)
+      continue;
+    const uint32_t chunkBegin = chunkIdx << archetype.chunkSizePower;
+    const uint32_t chunkEnd = std::min(chunkBegin + archetype.chunkSize, (uint32_t)trackMaskPerEntity.size());
+    for (uint32_t i = chunkBegin; i < chunkEnd; i++)
     {
-      for (const auto &[event_hash, mask] : archetype.trackedEvents)
+      ecs_details::TrackMask entityMask = trackMaskPerEntity[i];
+      if (entityMask != 0u)
       {
-        if ((entityMask & mask) != 0u)
+        for (const auto &[event_hash, mask] : archetype.trackedEvents)
         {
-          ecs::perform_event_immediate(mgr, archetype.archetypeId, i, event_hash, ecs::EventInfo<ecs::OnTrack>::eventId, &event);
+          if ((entityMask & mask) != 0u)
+          {
+            ecs::perform_event_immediate(mgr, archetype.archetypeId, i, event_hash, ecs::EventInfo<ecs::OnTrack>::eventId, &event);
+          }
         }
       }
     }
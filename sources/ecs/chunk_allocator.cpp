@@ -0,0 +1,56 @@
+#include "ecs/chunk_allocator.h"
+#include <new>
+
+namespace ecs
+{
+
+char *PoolChunkAllocator::allocate(size_t size, size_t alignment)
+{
+  {
+    std::lock_guard<std::mutex> lock(mutex);
+    auto it = freeLists.find(get_key(size, alignment));
+    if (it != freeLists.end() && !it->second.empty())
+    {
+      char *data = it->second.back();
+      it->second.pop_back();
+      cachedBytes -= size;
+      return data;
+    }
+  }
+  return new (std::align_val_t{alignment}) char[size];
+}
+
+void PoolChunkAllocator::deallocate(char *data, size_t size, size_t alignment)
+{
+  {
+    std::lock_guard<std::mutex> lock(mutex);
+    if (cachedBytes + size <= maxCachedBytes)
+    {
+      freeLists[get_key(size, alignment)].push_back(data);
+      cachedBytes += size;
+      return;
+    }
+  }
+  operator delete[] (data, size, std::align_val_t{alignment});
+}
+
+void PoolChunkAllocator::release_cached()
+{
+  std::lock_guard<std::mutex> lock(mutex);
+  for (auto &[key, freeList] : freeLists)
+  {
+    const size_t size = key >> 32;
+    const size_t alignment = key & 0xFFFFFFFFu;
+    for (char *data : freeList)
+      operator delete[] (data, size, std::align_val_t{alignment});
+  }
+  freeLists.clear();
+  cachedBytes = 0;
+}
+
+PoolChunkAllocator::~PoolChunkAllocator()
+{
+  release_cached();
+}
+
+} // namespace ecs
@@ -4,27 +4,50 @@
 #include "ecs/builtin_events.h"
 
 #include <span>
+#include <chrono>
+#include <algorithm>
 #include <assert.h>
 
 ECS_TYPE_DECLARATION_ALIAS(ecs::EntityId, "EntityId")
 
 namespace ecs_details
 {
-  ecs::ArchetypeId get_or_create_archetype(ecs::EcsManager &mgr, ecs::InitializerList &components, const ecs::TrackedComponentMap &tracked_component_map, ecs::ArchetypeChunkSize chunk_size_power, const char *template_name);
+  ecs::ArchetypeId get_or_create_archetype(ecs::EcsManager &mgr, ecs::InitializerList &components, const ecs::TrackedComponentMap &tracked_component_map, ecs::ArchetypeChunkSize chunk_size_power, ecs::ArchetypeChunkLayout chunk_layout, const char *template_name);
   void track_changes(ecs::EcsManager &mgr, ecs_details::Archetype &archetype);
 }
 
 namespace ecs
 {
 
-static void perform_event_immediate(EcsManager &mgr, ArchetypeId archetypeId, uint32_t componentIdx, EventId event_id, const void *event_ptr);
+static void perform_event_immediate(ecs_details::Archetype &archetype, uint32_t componentIdx, EventId event_id, const void *event_ptr);
+static void perform_event_immediate(ecs_details::Archetype &archetype, std::span<const uint32_t> component_indices, EventId event_id, const void *event_ptr);
+static void perform_event_immediate(ecs_details::Archetype &archetype, uint32_t component_begin, uint32_t component_end, EventId event_id, const void *event_ptr);
 
-EcsManager::EcsManager()
+// entity moved to the place of the removed one should point to the new index
+static void relocate_entity(EcsManager &mgr, ecs_details::Archetype &archetype, uint32_t component_index)
+{
+  const int eidCollumnIndex = archetype.getComponentCollumnIndex(mgr.eidComponentId);
+  const ecs::EntityId movedEid = *(const ecs::EntityId *)archetype.getData(archetype.collumns[eidCollumnIndex], component_index);
+  mgr.entityContainer.relocate(movedEid, component_index);
+}
+
+// collumns keep pointers to the declarations, so existing declaration is updated in place
+static void add_type_declaration(EcsManager &mgr, const TypeDeclaration &type_declaration)
+{
+  std::unique_ptr<TypeDeclaration> &typeDeclaration = mgr.typeMap[type_declaration.typeId];
+  if (typeDeclaration)
+    *typeDeclaration = type_declaration;
+  else
+    typeDeclaration = std::make_unique<TypeDeclaration>(type_declaration);
+}
+
+EcsManager::EcsManager() : chunkAllocator(std::make_unique<PoolChunkAllocator>())
 {
   TypeDeclaration entityIdTypeDeclaration = create_type_declaration<ecs::EntityId>();
   EntityIdTypeId = entityIdTypeDeclaration.typeId;
-  typeMap[EntityIdTypeId] = std::move(entityIdTypeDeclaration);
+  add_type_declaration(*this, entityIdTypeDeclaration);
   eidComponentId = ecs::get_or_add_component(*this, EntityIdTypeId, "eid");
+  commandBuffers.push_back(std::make_unique<CommandBuffer>());
 }
 
 void register_all_codegen_files(ecs::EcsManager &mgr)
@@ -39,8 +62,7 @@ void register_all_type_declarations(ecs::EcsManager &mgr)
 {
   for (ecs_details::TypeDeclarationInfo *info = ecs_details::TypeDeclarationInfo::tail; info; info = info->next)
   {
-    const ecs::TypeDeclaration &type_declaration = info->type_declaration;
-    mgr.typeMap[type_declaration.typeId] = type_declaration;
+    add_type_declaration(mgr, info->type_declaration);
   }
 }
 
@@ -56,27 +78,26 @@ ComponentId get_or_add_component(EcsManager &mgr, TypeId typeId, const char *com
   componentDeclaration->typeId = typeId;
   componentDeclaration->name = component_name;
   componentDeclaration->componentId = componentId;
+  componentDeclaration->denseIndex = mgr.componentMap.size();
   mgr.componentMap[componentId] = std::move(componentDeclaration);
   return componentId;
 }
 
-static void create_entity_sync(EcsManager &mgr, ecs::EntityId eid, ecs_details::Archetype &archetype, const InitializerList &template_init, InitializerList &&override_list)
+template<typename Overrides>
+static void create_entity_sync(EcsManager &mgr, ecs::EntityId eid, ecs_details::Archetype &archetype, const Template &template_record, Overrides &&overrides)
 {
   uint32_t entityIndex = archetype.entityCount;
   // entity was destroyed already
-  if (!mgr.entityContainer.mutate(eid, archetype.archetypeId, entityIndex))
+  if (!mgr.entityContainer.mutate(eid, &archetype, entityIndex))
     return;
-  override_list.push_back(ecs::ComponentInit(mgr.eidComponentId, ecs::EntityId(eid)));
-  // can be not equal if template has unregistered components. Not terrible, but not good. In this case, we should skip them
-  assert(archetype.type.size() <= template_init.size());
-  ecs_details::add_entity_to_archetype(archetype, mgr, template_init, std::move(override_list));
+  ecs_details::add_entity_to_archetype(archetype, mgr, template_record, eid, std::forward<Overrides>(overrides));
 
   const OnAppear event;
-  perform_event_immediate(mgr, archetype.archetypeId, entityIndex, ecs::EventInfo<OnAppear>::eventId, &event);
+  perform_event_immediate(archetype, entityIndex, ecs::EventInfo<OnAppear>::eventId, &event);
 }
 
-
-ecs::EntityId create_entity_sync(EcsManager &mgr, TemplateId templateId, InitializerList &&init_list)
+template<typename Overrides>
+static ecs::EntityId create_entity_sync_impl(EcsManager &mgr, TemplateId templateId, Overrides &&overrides)
 {
   auto it = mgr.templates.find(templateId);
   if (it == mgr.templates.end())
@@ -93,14 +114,44 @@ ecs::EntityId create_entity_sync(EcsManager &mgr, TemplateId templateId, Initial
     return EntityId();
   }
   ecs::EntityId eid = mgr.entityContainer.allocate_entity(ecs_details::EntityState::Alive);
-  create_entity_sync(mgr, eid, *it2->second, templateRecord.args, std::move(init_list));
+  create_entity_sync(mgr, eid, *it2->second, templateRecord, std::forward<Overrides>(overrides));
   return eid;
 }
 
+ecs::EntityId create_entity_sync(EcsManager &mgr, TemplateId templateId, InitializerList &&init_list)
+{
+  return create_entity_sync_impl(mgr, templateId, std::move(init_list));
+}
+
+ecs::EntityId create_entity_sync(EcsManager &mgr, TemplateId templateId, FlatInitializerList &&init_list)
+{
+  return create_entity_sync_impl(mgr, templateId, std::move(init_list));
+}
+
+ecs::EntityId create_entity_sync(EcsManager &mgr, TemplateId templateId, std::span<ecs::Any> overrides)
+{
+  auto it = mgr.templates.find(templateId);
+  if (it != mgr.templates.end() && it->second.overrideSlotCount != overrides.size())
+  {
+    ECS_LOG_ERROR(mgr).log("Template \"%s\" expects %u positional overrides, but %u were passed",
+      it->second.name.c_str(), it->second.overrideSlotCount, (uint32_t)overrides.size());
+  }
+  return create_entity_sync_impl(mgr, templateId, overrides);
+}
+
 ecs::EntityId create_entity(EcsManager &mgr, TemplateId templateId, InitializerList &&init_list)
 {
   ecs::EntityId eid = mgr.entityContainer.allocate_entity(ecs_details::EntityState::AsyncCreation);
   mgr.delayedEntities.push_back(ecs::EcsManager::DelayedEntity(templateId, eid, std::move(init_list)));
+  mgr.delayedEntities.back().sequence = mgr.delayedEntitySequence++;
+  return eid;
+}
+
+ecs::EntityId create_entity(EcsManager &mgr, TemplateId templateId, FlatInitializerList &&init_list)
+{
+  ecs::EntityId eid = mgr.entityContainer.allocate_entity(ecs_details::EntityState::AsyncCreation);
+  mgr.delayedFlatEntities.emplace_back(templateId, eid, std::move(init_list));
+  mgr.delayedFlatEntities.back().sequence = mgr.delayedEntitySequence++;
   return eid;
 }
 
@@ -110,19 +161,16 @@ static std::vector<EntityId> create_entities(EcsManager &mgr, std::vector<Entity
   const uint32_t startEntityIndex = archetype.entityCount;
   uint32_t entityIndex = startEntityIndex;
 
-  eids.erase(eids.begin(), std::remove_if(eids.begin(), eids.end(), [&mgr, &archetype, &entityIndex](EntityId eid) {
-    return !mgr.entityContainer.mutate(eid, archetype.archetypeId, entityIndex++);
-  }));
+  eids.erase(std::remove_if(eids.begin(), eids.end(), [&mgr, &archetype, &entityIndex](EntityId eid) {
+    return !mgr.entityContainer.mutate(eid, &archetype, entityIndex++);
+  }), eids.end());
 
   override_soa_list.push_back(ecs::ComponentSoaInit(mgr.eidComponentId, std::move(eids)));
   assert(archetype.type.size() == template_init.size());
   ecs_details::add_entities_to_archetype(archetype, mgr, template_init, std::move(override_soa_list));
 
   const OnAppear event;
-  for (uint32_t i = 0; i < requiredEntityCount; i++)
-  {
-    perform_event_immediate(mgr, archetype.archetypeId, startEntityIndex + i, ecs::EventInfo<OnAppear>::eventId, &event);
-  }
+  perform_event_immediate(archetype, startEntityIndex, startEntityIndex + requiredEntityCount, ecs::EventInfo<OnAppear>::eventId, &event);
   return eids;
 }
 
@@ -159,64 +207,428 @@ std::vector<EntityId> create_entities(EcsManager &mgr, TemplateId templateId, In
 
 bool destroy_entity_sync(EcsManager &mgr, ecs::EntityId eid)
 {
-  ecs::ArchetypeId archetypeId;
+  ecs_details::Archetype *archetypePtr;
   uint32_t componentIndex;
-  if (mgr.entityContainer.get(eid, archetypeId, componentIndex))
+  if (mgr.entityContainer.get(eid, archetypePtr, componentIndex))
   {
-    auto it = mgr.archetypeMap.find(archetypeId);
-    if (it == mgr.archetypeMap.end())
-    {
-      ECS_LOG_ERROR(mgr).log("Archetype with hash %x not found", archetypeId);
-      return false;
-    }
+    ecs_details::Archetype &archetype = *archetypePtr;
     const OnDisappear event;
-    perform_event_immediate(mgr, archetypeId, componentIndex, ecs::EventInfo<OnDisappear>::eventId, &event);
+    perform_event_immediate(archetype, componentIndex, ecs::EventInfo<OnDisappear>::eventId, &event);
 
-    ecs_details::Archetype &archetype = *it->second;
-    ecs_details::remove_entity_from_archetype(archetype, mgr.typeMap, componentIndex);
+    ecs_details::remove_entity_from_archetype(archetype, componentIndex);
+    if (componentIndex < archetype.entityCount)
+      relocate_entity(mgr, archetype, componentIndex);
     mgr.entityContainer.destroy_entity(eid);
     return true;
   }
   return false;
 }
 
+static ecs_details::Archetype *find_entity_archetype(EcsManager &mgr, EntityId eid, uint32_t &component_index)
+{
+  ecs_details::Archetype *archetype;
+  if (!mgr.entityContainer.get(eid, archetype, component_index))
+    return nullptr;
+  return archetype;
+}
+
+static void move_entity_to_archetype(EcsManager &mgr, EntityId eid, ecs_details::Archetype &archetype, uint32_t component_index, const ecs_details::ArchetypeTransition &transition, void *new_component_data)
+{
+  const uint32_t targetIndex = ecs_details::move_entity_to_archetype(archetype, component_index, transition, new_component_data);
+  if (component_index < archetype.entityCount)
+    relocate_entity(mgr, archetype, component_index);
+  mgr.entityContainer.relocate(eid, transition.target, targetIndex);
+}
+
+bool add_component_sync(EcsManager &mgr, EntityId eid, ComponentInit &&component)
+{
+  uint32_t componentIndex;
+  ecs_details::Archetype *archetype = find_entity_archetype(mgr, eid, componentIndex);
+  if (archetype == nullptr)
+    return false;
+  auto cmpIt = mgr.componentMap.find(component.componentId);
+  if (cmpIt == mgr.componentMap.end())
+  {
+    ECS_LOG_ERROR(mgr).log("Component %llx not found, during add_component", component.componentId);
+    return false;
+  }
+  if (component.data() != nullptr && cmpIt->second->typeId != component.typeId)
+  {
+    const char *receivedType = mgr.typeMap.find(component.typeId)->second->typeName.c_str();
+    const char *expectedType = mgr.typeMap.find(cmpIt->second->typeId)->second->typeName.c_str();
+    ECS_LOG_ERROR(mgr).log("Component %s has type %s but expected %s, during add_component",
+      cmpIt->second->name.c_str(), receivedType, expectedType);
+    return false;
+  }
+  const int collumnIdx = archetype->getComponentCollumnIndex(component.componentId);
+  if (collumnIdx != -1)
+  {
+    // entity already has the component, replace the value
+    ecs_details::Collumn &collumn = archetype->collumns[collumnIdx];
+    const int trackedCollumnIdx = archetype->getComponentTrackedCollumnIndex(component.componentId);
+    if (trackedCollumnIdx != -1)
+      archetype->trackedCollumns[trackedCollumnIdx].mark_dirty(componentIndex);
+    ecs::mark_written(*archetype, std::span<const int>(&collumnIdx, 1), componentIndex);
+    if (component.data() == nullptr)
+      return true;
+    if (collumn.soaLaneCount)
+    {
+      archetype->scatterData(collumn, componentIndex, component.data());
+    }
+    else
+    {
+      void *data = archetype->getData(collumn, componentIndex);
+      collumn.typeDeclaration->destruct(data);
+      collumn.typeDeclaration->move_construct(data, component.data());
+    }
+    return true;
+  }
+  if (archetype->hasComponent(component.componentId))
+    return true; // tag is already here, nothing to replace
+  const ecs_details::ArchetypeTransition *transition = ecs_details::get_add_component_transition(mgr, *archetype, component.componentId);
+  if (transition == nullptr)
+    return false;
+  move_entity_to_archetype(mgr, eid, *archetype, componentIndex, *transition, component.data());
+  return true;
+}
+
+bool remove_component_sync(EcsManager &mgr, EntityId eid, ComponentId component_id)
+{
+  if (component_id == mgr.eidComponentId)
+  {
+    ECS_LOG_ERROR(mgr).log("Component eid can't be removed");
+    return false;
+  }
+  uint32_t componentIndex;
+  ecs_details::Archetype *archetype = find_entity_archetype(mgr, eid, componentIndex);
+  if (archetype == nullptr)
+    return false;
+  const ecs_details::ArchetypeTransition *transition = ecs_details::get_remove_component_transition(mgr, *archetype, component_id);
+  if (transition == nullptr)
+    return false;
+  move_entity_to_archetype(mgr, eid, *archetype, componentIndex, *transition, nullptr);
+  return true;
+}
+
+void add_component(EcsManager &mgr, EntityId eid, ComponentInit &&component)
+{
+  const ComponentId componentId = component.componentId;
+  mgr.delayedComponentChanges.push_back({eid, componentId, std::move(static_cast<ecs::Any &&>(component)), false});
+}
+
+void remove_component(EcsManager &mgr, EntityId eid, ComponentId component_id)
+{
+  mgr.delayedComponentChanges.push_back({eid, component_id, ecs::Any(), true});
+}
+
+void destroy_entities_sync(EcsManager &mgr, std::span<const ecs::EntityId> eids)
+{
+  struct DestroyedEntity
+  {
+    ecs::ArchetypeId archetypeId;
+    uint32_t componentIndex;
+    ecs::EntityId eid;
+    ecs_details::Archetype *archetype;
+  };
+  std::vector<DestroyedEntity> destroyedEntities;
+  destroyedEntities.reserve(eids.size());
+  for (ecs::EntityId eid : eids)
+  {
+    ecs_details::Archetype *archetype;
+    uint32_t componentIndex;
+    if (mgr.entityContainer.get(eid, archetype, componentIndex))
+      destroyedEntities.push_back({archetype->archetypeId, componentIndex, eid, archetype});
+  }
+  std::sort(destroyedEntities.begin(), destroyedEntities.end(), [](const DestroyedEntity &a, const DestroyedEntity &b) {
+    return a.archetypeId != b.archetypeId ? a.archetypeId < b.archetypeId : a.componentIndex < b.componentIndex;
+  });
+  destroyedEntities.erase(std::unique(destroyedEntities.begin(), destroyedEntities.end(), [](const DestroyedEntity &a, const DestroyedEntity &b) {
+    return a.archetypeId == b.archetypeId && a.componentIndex == b.componentIndex;
+  }), destroyedEntities.end());
+
+  const OnDisappear event;
+  std::vector<uint32_t> componentIndices;
+  for (uint32_t groupBegin = 0, groupEnd = 0, n = destroyedEntities.size(); groupBegin < n; groupBegin = groupEnd)
+  {
+    const ecs::ArchetypeId archetypeId = destroyedEntities[groupBegin].archetypeId;
+    componentIndices.clear();
+    for (groupEnd = groupBegin; groupEnd < n && destroyedEntities[groupEnd].archetypeId == archetypeId; groupEnd++)
+      componentIndices.push_back(destroyedEntities[groupEnd].componentIndex);
+
+    ecs_details::Archetype &archetype = *destroyedEntities[groupBegin].archetype;
+    perform_event_immediate(archetype, componentIndices, ecs::EventInfo<OnDisappear>::eventId, &event);
+
+    ecs_details::remove_entities_from_archetype(archetype, componentIndices);
+    for (uint32_t componentIndex : componentIndices)
+    {
+      if (componentIndex >= archetype.entityCount)
+        break;
+      relocate_entity(mgr, archetype, componentIndex);
+    }
+    for (uint32_t i = groupBegin; i < groupEnd; i++)
+      mgr.entityContainer.destroy_entity(destroyedEntities[i].eid);
+  }
+}
+
 void destroy_entity(EcsManager &mgr, ecs::EntityId eid)
 {
   if (mgr.entityContainer.mark_as_destroyed(eid))
     mgr.delayedEntitiesDestroy.push_back(eid);
 }
 
-void perform_delayed_entities_creation(EcsManager &mgr)
+EcsManager::CommandBuffer &get_command_buffer(EcsManager &mgr)
 {
-  // need take into account that entity can be added/removed during OnAppear/OnDisappear events
+  const uint32_t threadIdx = mgr.jobScheduler ? mgr.jobScheduler->current_queue_index() : 0;
+  assert(threadIdx < mgr.commandBuffers.size());
+  return *mgr.commandBuffers[threadIdx];
+}
 
-  uint32_t delayedEntityDestroyCount = mgr.delayedEntitiesDestroy.size();
-  uint32_t delayedEntityCount = mgr.delayedEntities.size();
-  uint32_t delayedEntitySoaCount = mgr.delayedEntitiesSoa.size();
+static thread_local CommandKey threadCommandKey;
 
-  for (uint32_t i = 0, n = delayedEntityDestroyCount; i < n; i++)
+CommandScope::CommandScope(uint64_t source) : previous(threadCommandKey)
+{
+  threadCommandKey = CommandKey{source, 0};
+}
+
+CommandScope::~CommandScope()
+{
+  threadCommandKey = previous;
+}
+
+uint64_t CommandScope::current_source()
+{
+  return threadCommandKey.source;
+}
+
+uint64_t CommandScope::job_source(uint64_t parent_source, uint32_t job_idx)
+{
+  // 64-bit FNV-1a over parent_source and job_idx
+  uint64_t h = 14695981039346656037ull;
+  for (uint32_t i = 0; i < 8; i++)
+    h = (h ^ ((parent_source >> (i * 8)) & 0xFF)) * 1099511628211ull;
+  for (uint32_t i = 0; i < 4; i++)
+    h = (h ^ ((job_idx >> (i * 8)) & 0xFF)) * 1099511628211ull;
+  return h;
+}
+
+uint64_t CommandScope::nested_source(uint64_t parent_source, uint64_t source)
+{
+  if (parent_source == 0)
+    return source;
+  // 64-bit FNV-1a over parent_source and source
+  uint64_t h = 14695981039346656037ull;
+  for (uint32_t i = 0; i < 8; i++)
+    h = (h ^ ((parent_source >> (i * 8)) & 0xFF)) * 1099511628211ull;
+  for (uint32_t i = 0; i < 8; i++)
+    h = (h ^ ((source >> (i * 8)) & 0xFF)) * 1099511628211ull;
+  return h;
+}
+
+CommandKey CommandScope::next_key()
+{
+  return CommandKey{threadCommandKey.source, threadCommandKey.sequence++};
+}
+
+CommandKey next_command_key(const EcsManager &mgr)
+{
+  const CommandKey key = CommandScope::next_key();
+  // keys of different threads without scope are equal, so their commands are merged in thread order
+  if (mgr.deterministicCommands && key.source == 0 && mgr.jobScheduler && mgr.jobScheduler->current_queue_index() != 0)
   {
-    destroy_entity_sync(mgr, mgr.delayedEntitiesDestroy[i]);
+    ECS_LOG_ERROR(mgr).log("Command is recorded by job outside of CommandScope, its order is not deterministic");
+    assert(false && "deterministic command without CommandScope");
   }
+  return key;
+}
+
+// provisional ids are taken from the top of index range with any generation, far from real entities.
+// The provisional number is stored in the index low bits and in the generation
+static constexpr uint32_t PROVISIONAL_INDEX_BITS = 20;
+static constexpr uint32_t PROVISIONAL_INDEX_END = ecs::EntityId::MAX_ENTITIES_COUNT - 1; // the last index is invalid EntityId
+static constexpr uint32_t PROVISIONAL_INDEX_BEGIN = PROVISIONAL_INDEX_END - (1u << PROVISIONAL_INDEX_BITS);
+static constexpr uint32_t PROVISIONAL_NUMBER_MASK = (1u << PROVISIONAL_INDEX_BITS) * ecs::EntityId::MAX_GENERATIONS_COUNT - 1;
 
-  for (uint32_t i = 0, n = delayedEntityCount; i < n; i++)
+static bool is_provisional_entity(ecs::EntityId eid, uint32_t &provisional_number)
+{
+  if (eid.entityIndex < PROVISIONAL_INDEX_BEGIN || eid.entityIndex >= PROVISIONAL_INDEX_END)
+    return false;
+  provisional_number = (eid.generation << PROVISIONAL_INDEX_BITS) | (eid.entityIndex - PROVISIONAL_INDEX_BEGIN);
+  return true;
+}
+
+// depends only on the recorded history, not on the thread which recorded the command
+static uint32_t get_provisional_number(uint32_t merge_count, const CommandKey &key)
+{
+  // 64-bit FNV-1a over merge_count, key.source and key.sequence
+  uint64_t h = 14695981039346656037ull;
+  const auto hash_bytes = [&h](uint64_t value, uint32_t byte_count) {
+    for (uint32_t i = 0; i < byte_count; i++)
+      h = (h ^ ((value >> (i * 8)) & 0xFF)) * 1099511628211ull;
+  };
+  hash_bytes(merge_count, 4);
+  hash_bytes(key.source, 8);
+  hash_bytes(key.sequence, 4);
+  return uint32_t(h ^ (h >> 32)) & PROVISIONAL_NUMBER_MASK;
+}
+
+ecs::EntityId resolve_entity(const EcsManager &mgr, ecs::EntityId eid)
+{
+  uint32_t provisionalNumber;
+  if (!is_provisional_entity(eid, provisionalNumber))
+    return eid;
+  auto it = mgr.provisionalEntities.find(provisionalNumber);
+  return it != mgr.provisionalEntities.end() ? it->second : ecs::EntityId();
+}
+
+ecs::EntityId create_entity_mt(EcsManager &mgr, TemplateId templateId, FlatInitializerList &&init_list)
+{
+  const CommandKey key = next_command_key(mgr);
+  ecs::EntityId eid;
+  if (mgr.deterministicCommands)
   {
-    EcsManager::DelayedEntity &entity = mgr.delayedEntities[i];
-    auto it = mgr.templates.find(entity.templateId);
-    if (it == mgr.templates.end())
+    // index is allocated on merge, in order of CommandKey
+    const uint32_t provisionalNumber = get_provisional_number(mgr.commandMergeCount, key);
+    eid.entityIndex = PROVISIONAL_INDEX_BEGIN + (provisionalNumber & ((1u << PROVISIONAL_INDEX_BITS) - 1));
+    eid.generation = provisionalNumber >> PROVISIONAL_INDEX_BITS;
+  }
+  else
+  {
+    eid = mgr.entityContainer.reserve_entity();
+  }
+  EcsManager::CommandBuffer &buffer = get_command_buffer(mgr);
+  buffer.createdEntities.emplace_back(templateId, eid, std::move(init_list));
+  buffer.createdEntityKeys.push_back(key);
+  return eid;
+}
+
+void destroy_entity_mt(EcsManager &mgr, ecs::EntityId eid)
+{
+  EcsManager::CommandBuffer &buffer = get_command_buffer(mgr);
+  buffer.destroyedEntities.push_back(eid);
+  buffer.destroyedEntityKeys.push_back(next_command_key(mgr));
+}
+
+// calls apply(buffer, command_idx) for the commands of all buffers in order of thread index,
+// or sorted by CommandKey if mgr.deterministicCommands (equal keys keep thread order)
+template<typename GetKeys, typename Apply>
+static void for_each_buffered_command(EcsManager &mgr, GetKeys &&get_keys, Apply &&apply)
+{
+  if (!mgr.deterministicCommands)
+  {
+    for (std::unique_ptr<EcsManager::CommandBuffer> &buffer : mgr.commandBuffers)
     {
-      ECS_LOG_ERROR(mgr).log("Template with hash %x not found", entity.templateId);
-      continue;
+      for (uint32_t i = 0, n = get_keys(*buffer).size(); i < n; i++)
+        apply(*buffer, i);
     }
-    const Template &templateRecord = it->second;
+    return;
+  }
+  struct CommandRef
+  {
+    CommandKey key;
+    uint32_t bufferIdx;
+    uint32_t commandIdx;
+  };
+  std::vector<CommandRef> commands;
+  for (uint32_t bufferIdx = 0, n = mgr.commandBuffers.size(); bufferIdx < n; bufferIdx++)
+  {
+    const std::vector<CommandKey> &keys = get_keys(*mgr.commandBuffers[bufferIdx]);
+    for (uint32_t i = 0, m = keys.size(); i < m; i++)
+      commands.push_back({keys[i], bufferIdx, i});
+  }
+  std::stable_sort(commands.begin(), commands.end(), [](const CommandRef &a, const CommandRef &b) { return a.key < b.key; });
+  for (const CommandRef &command : commands)
+  {
+    apply(*mgr.commandBuffers[command.bufferIdx], command.commandIdx);
+  }
+}
 
-    auto it2 = mgr.archetypeMap.find(templateRecord.archetypeId);
-    if (it2 == mgr.archetypeMap.end())
+// moves recorded commands to the main thread queues
+static void merge_command_buffers_entities(EcsManager &mgr)
+{
+  mgr.provisionalEntities.clear();
+  for_each_buffered_command(mgr,
+    [](EcsManager::CommandBuffer &buffer) -> const std::vector<CommandKey> & { return buffer.createdEntityKeys; },
+    [&mgr](EcsManager::CommandBuffer &buffer, uint32_t idx)
+  {
+    EcsManager::DelayedFlatEntity &entity = buffer.createdEntities[idx];
+    uint32_t provisionalNumber;
+    if (is_provisional_entity(entity.eid, provisionalNumber))
     {
-      ECS_LOG_ERROR(mgr).log("Archetype with hash %x not found", templateRecord.archetypeId);
-      continue;
+      const ecs::EntityId eid = mgr.entityContainer.allocate_entity(ecs_details::EntityState::AsyncCreation);
+      assert(eid.entityIndex < PROVISIONAL_INDEX_BEGIN);
+      // numbers are hashes of the keys, the first entity in CommandKey order keeps the colliding number
+      if (!mgr.provisionalEntities.emplace(provisionalNumber, eid).second)
+        ECS_LOG_ERROR(mgr).log("Provisional entity id collision, resolve_entity returns the first created entity");
+      entity.eid = eid;
+    }
+    else
+    {
+      mgr.entityContainer.activate_reserved_entity(entity.eid, ecs_details::EntityState::AsyncCreation);
     }
-    create_entity_sync(mgr, entity.eid, *it2->second, templateRecord.args, std::move(entity.initList));
+    mgr.delayedFlatEntities.push_back(std::move(entity));
+    mgr.delayedFlatEntities.back().sequence = mgr.delayedEntitySequence++;
+  });
+  for_each_buffered_command(mgr,
+    [](EcsManager::CommandBuffer &buffer) -> const std::vector<CommandKey> & { return buffer.destroyedEntityKeys; },
+    [&mgr](EcsManager::CommandBuffer &buffer, uint32_t idx)
+  {
+    destroy_entity(mgr, resolve_entity(mgr, buffer.destroyedEntities[idx]));
+  });
+  mgr.commandMergeCount++;
+  for (std::unique_ptr<EcsManager::CommandBuffer> &buffer : mgr.commandBuffers)
+  {
+    buffer->createdEntities.clear();
+    buffer->createdEntityKeys.clear();
+    buffer->destroyedEntities.clear();
+    buffer->destroyedEntityKeys.clear();
+  }
+}
+
+template<typename DelayedEntity>
+static void create_delayed_entity(EcsManager &mgr, DelayedEntity &entity)
+{
+  auto it = mgr.templates.find(entity.templateId);
+  if (it == mgr.templates.end())
+  {
+    ECS_LOG_ERROR(mgr).log("Template with hash %x not found", entity.templateId);
+    return;
+  }
+  const Template &templateRecord = it->second;
+
+  auto it2 = mgr.archetypeMap.find(templateRecord.archetypeId);
+  if (it2 == mgr.archetypeMap.end())
+  {
+    ECS_LOG_ERROR(mgr).log("Archetype with hash %x not found", templateRecord.archetypeId);
+    return;
+  }
+  create_entity_sync(mgr, entity.eid, *it2->second, templateRecord, std::move(entity.initList));
+}
+
+void perform_delayed_entities_creation(EcsManager &mgr)
+{
+  merge_command_buffers_entities(mgr);
+  // need take into account that entity can be added/removed during OnAppear/OnDisappear events
+
+  uint32_t delayedEntityDestroyCount = mgr.delayedEntitiesDestroy.size();
+  uint32_t delayedEntityCount = mgr.delayedEntities.size();
+  uint32_t delayedFlatEntityCount = mgr.delayedFlatEntities.size();
+  uint32_t delayedEntitySoaCount = mgr.delayedEntitiesSoa.size();
+  uint32_t delayedComponentChangeCount = mgr.delayedComponentChanges.size();
+
+  if (delayedEntityDestroyCount > 0)
+  {
+    // OnDisappear handlers can add new entities to delayedEntitiesDestroy
+    const std::vector<ecs::EntityId> destroyList(mgr.delayedEntitiesDestroy.begin(), mgr.delayedEntitiesDestroy.begin() + delayedEntityDestroyCount);
+    destroy_entities_sync(mgr, destroyList);
+  }
+
+  // both queues are sorted by sequence, merge them to keep the order of create_entity calls
+  for (uint32_t i = 0, j = 0; i < delayedEntityCount || j < delayedFlatEntityCount;)
+  {
+    if (j == delayedFlatEntityCount || (i < delayedEntityCount && mgr.delayedEntities[i].sequence < mgr.delayedFlatEntities[j].sequence))
+      create_delayed_entity(mgr, mgr.delayedEntities[i++]);
+    else
+      create_delayed_entity(mgr, mgr.delayedFlatEntities[j++]);
   }
 
   for (uint32_t i = 0, n = delayedEntitySoaCount; i < n; i++)
@@ -238,7 +650,17 @@ void perform_delayed_entities_creation(EcsManager &mgr)
     }
     create_entities(mgr, std::move(entity.eids), *it2->second, templateRecord.args, std::move(entity.initSoaList));
   }
+  for (uint32_t i = 0, n = delayedComponentChangeCount; i < n; i++)
+  {
+    EcsManager::DelayedComponentChange &change = mgr.delayedComponentChanges[i];
+    if (change.remove)
+      remove_component_sync(mgr, change.eid, change.componentId);
+    else
+      add_component_sync(mgr, change.eid, ComponentInit(std::move(change.value)));
+  }
+  mgr.delayedComponentChanges.erase(mgr.delayedComponentChanges.begin(), mgr.delayedComponentChanges.begin() + delayedComponentChangeCount);
   mgr.delayedEntities.erase(mgr.delayedEntities.begin(), mgr.delayedEntities.begin() + delayedEntityCount);
+  mgr.delayedFlatEntities.erase(mgr.delayedFlatEntities.begin(), mgr.delayedFlatEntities.begin() + delayedFlatEntityCount);
   mgr.delayedEntitiesSoa.erase(mgr.delayedEntitiesSoa.begin(), mgr.delayedEntitiesSoa.begin() + delayedEntitySoaCount);
   mgr.delayedEntitiesDestroy.erase(mgr.delayedEntitiesDestroy.begin(), mgr.delayedEntitiesDestroy.begin() + delayedEntityDestroyCount);
 }
@@ -254,10 +676,12 @@ void perform_event_immediate(EcsManager &mgr, EventId event_id, const void *even
       if (hndlIt != mgr.events.end())
       {
         EventHandler &handler = hndlIt->second;
-        for (const auto &[archetypeId, archetypeRecord] : handler.archetypesCache)
+        for (uint32_t archetypeIdx = 0, n = handler.archetypes.size(); archetypeIdx < n; archetypeIdx++)
         {
-          ecs::mark_dirty(*archetypeRecord.archetype, archetypeRecord.toTrackedComponent);
-          handler.broadcastEvent(*archetypeRecord.archetype, archetypeRecord.toComponentIndex, event_id, event_ptr);
+          ecs_details::Archetype &archetype = *handler.archetypes[archetypeIdx].archetype;
+          ecs::mark_dirty(archetype, handler.get_tracked_components(archetypeIdx));
+          ecs::mark_written(archetype, handler.get_written_collumns(archetypeIdx));
+          handler.broadcastEvent(archetype, handler.get_components(archetypeIdx), event_id, event_ptr);
         }
       }
     }
@@ -270,42 +694,90 @@ void perform_event_immediate(EcsManager &mgr, ArchetypeId archetypeId, uint32_t
   if (hndlIt != mgr.events.end())
   {
     EventHandler &handler = hndlIt->second;
-    auto ait = handler.archetypesCache.find(archetypeId);
-    if (ait != handler.archetypesCache.end())
+    int archetypeIdx = handler.find_archetype(archetypeId);
+    if (archetypeIdx != -1)
     {
-      const auto &archetypeRecord = ait->second;
-      ecs_details::Archetype &archetype = *archetypeRecord.archetype;
-      const ecs::ToComponentMap &toComponentIndex = archetypeRecord.toComponentIndex;
-      ecs::mark_dirty(archetype, archetypeRecord.toTrackedComponent, componentIdx);
-      handler.unicastEvent(archetype, toComponentIndex, componentIdx, event_id, event_ptr);
+      ecs_details::Archetype &archetype = *handler.archetypes[archetypeIdx].archetype;
+      ecs::mark_dirty(archetype, handler.get_tracked_components(archetypeIdx), componentIdx);
+      ecs::mark_written(archetype, handler.get_written_collumns(archetypeIdx), componentIdx);
+      handler.unicastEvent(archetype, handler.get_components(archetypeIdx), componentIdx, event_id, event_ptr);
     }
   }
 }
 
-static void perform_event_immediate(EcsManager &mgr, ArchetypeId archetypeId, uint32_t componentIdx, EventId event_id, const void *event_ptr)
+// handlers are taken from the archetype dispatch table, once for all entities of the archetype
+static void perform_event_immediate(ecs_details::Archetype &archetype, std::span<const uint32_t> component_indices, EventId event_id, const void *event_ptr)
 {
-  auto it = mgr.eventIdToHandlers.find(event_id);
-  if (it != mgr.eventIdToHandlers.end())
+  for (const ecs_details::ArchetypeEventHandler &record : archetype.getEventHandlers(event_id))
   {
-    for (NameHash queryId : it->second)
+    EventHandler &handler = *record.handler;
+    const uint32_t archetypeIdx = record.archetypeIdx;
+    for (uint32_t componentIdx : component_indices)
+    {
+      ecs::mark_dirty(archetype, handler.get_tracked_components(archetypeIdx), componentIdx);
+      ecs::mark_written(archetype, handler.get_written_collumns(archetypeIdx), componentIdx);
+      handler.unicastEvent(archetype, handler.get_components(archetypeIdx), componentIdx, event_id, event_ptr);
+    }
+  }
+}
+
+static void perform_event_immediate(ecs_details::Archetype &archetype, uint32_t component_begin, uint32_t component_end, EventId event_id, const void *event_ptr)
+{
+  for (const ecs_details::ArchetypeEventHandler &record : archetype.getEventHandlers(event_id))
+  {
+    EventHandler &handler = *record.handler;
+    const uint32_t archetypeIdx = record.archetypeIdx;
+    std::span<const int> trackedComponents = handler.get_tracked_components(archetypeIdx);
+    if (!trackedComponents.empty())
+    {
+      for (uint32_t componentIdx = component_begin; componentIdx < component_end; componentIdx++)
+        ecs::mark_dirty(archetype, trackedComponents, componentIdx);
+    }
+    if (component_begin < component_end)
     {
-      perform_event_immediate(mgr, archetypeId, componentIdx, queryId, event_id, event_ptr);
+      ecs::mark_written(archetype, handler.get_written_collumns(archetypeIdx), component_begin >> archetype.chunkSizePower,
+        ((component_end - 1) >> archetype.chunkSizePower) + 1, archetype.getChangeVersion());
     }
+    handler.rangeEvent(archetype, handler.get_components(archetypeIdx), component_begin, component_end, event_id, event_ptr);
+  }
+}
+
+static void perform_event_immediate(ecs_details::Archetype &archetype, uint32_t componentIdx, EventId event_id, const void *event_ptr)
+{
+  for (const ecs_details::ArchetypeEventHandler &record : archetype.getEventHandlers(event_id))
+  {
+    EventHandler &handler = *record.handler;
+    const uint32_t archetypeIdx = record.archetypeIdx;
+    ecs::mark_dirty(archetype, handler.get_tracked_components(archetypeIdx), componentIdx);
+    ecs::mark_written(archetype, handler.get_written_collumns(archetypeIdx), componentIdx);
+    handler.unicastEvent(archetype, handler.get_components(archetypeIdx), componentIdx, event_id, event_ptr);
   }
 }
 
 void perform_event_immediate(EcsManager &mgr, EntityId eid, EventId event_id, const void *event_ptr)
 {
-  ArchetypeId archetypeId;
+  ecs_details::Archetype *archetype;
   uint32_t componentIdx;
-  if (mgr.entityContainer.get(eid, archetypeId, componentIdx))
+  if (mgr.entityContainer.get(eid, archetype, componentIdx))
   {
-    perform_event_immediate(mgr, archetypeId, componentIdx, event_id, event_ptr);
+    perform_event_immediate(*archetype, componentIdx, event_id, event_ptr);
   }
 }
 
 void perform_delayed_events(EcsManager &mgr)
 {
+  for_each_buffered_command(mgr,
+    [](EcsManager::CommandBuffer &buffer) -> const std::vector<CommandKey> & { return buffer.eventKeys; },
+    [&mgr](EcsManager::CommandBuffer &buffer, uint32_t idx)
+  {
+    mgr.delayedEvents.push_back(std::move(buffer.events[idx]));
+    mgr.delayedEvents.back().entityId = resolve_entity(mgr, mgr.delayedEvents.back().entityId);
+  });
+  for (std::unique_ptr<EcsManager::CommandBuffer> &buffer : mgr.commandBuffers)
+  {
+    buffer->events.clear();
+    buffer->eventKeys.clear();
+  }
   for (const EcsManager::DelayedEvent &event : mgr.delayedEvents)
   {
     if (event.broadcastEvent)
@@ -320,6 +792,45 @@ void perform_delayed_events(EcsManager &mgr)
   mgr.delayedEvents.clear();
 }
 
+static void build_template_recipe(EcsManager &mgr, Template &template_record, const std::vector<ecs_details::tiny_string> &override_slots)
+{
+  const ecs_details::Archetype &archetype = *mgr.archetypeMap.find(template_record.archetypeId)->second;
+  template_record.recipe.resize(archetype.collumns.size());
+  template_record.overrideSlotCount = override_slots.size();
+  for (uint32_t i = 0, n = archetype.collumns.size(); i < n; i++)
+  {
+    const ecs_details::Collumn &collumn = archetype.collumns[i];
+    ecs_details::ComponentRecipe &recipe = template_record.recipe[i];
+    if (collumn.componentId == mgr.eidComponentId)
+    {
+      recipe.source = ecs_details::ComponentRecipe::Source::EntityId;
+      continue;
+    }
+    auto it = template_record.args.args.find(collumn.componentId);
+    if (it != template_record.args.args.end())
+    {
+      recipe.source = ecs_details::ComponentRecipe::Source::TemplateData;
+      recipe.templateData = &it->second;
+    }
+  }
+  for (uint32_t slot = 0; slot < override_slots.size(); slot++)
+  {
+    const ecs::NameHash nameHash = hash(override_slots[slot].c_str());
+    int collumnIdx = -1;
+    for (uint32_t i = 0, n = archetype.collumns.size(); i < n && collumnIdx < 0; i++)
+    {
+      if (ecs::get_component_name_hash(archetype.collumns[i].componentId) == nameHash)
+        collumnIdx = i;
+    }
+    if (collumnIdx < 0)
+    {
+      ECS_LOG_ERROR(mgr).log("Override slot %s not found in template \"%s\"", override_slots[slot].c_str(), template_record.name.c_str());
+      continue;
+    }
+    template_record.recipe[collumnIdx].overrideSlot = slot;
+  }
+}
+
 static TemplateId template_registration(
   EcsManager &mgr,
   ComponentId eid_component_id,
@@ -364,11 +875,13 @@ static TemplateId template_registration(
       }
     }
   }
-  ArchetypeId archetypeId = ecs_details::get_or_create_archetype(mgr, template_init.args, trackedComponents, template_init.chunkSizePower, _name);
+  ArchetypeId archetypeId = ecs_details::get_or_create_archetype(mgr, template_init.args, trackedComponents, template_init.chunkSizePower, template_init.chunkLayout, _name);
 
-  Template templateRecord{std::move(template_init.name), std::move(template_init.args), archetypeId, std::move(trackedComponents), {}};
+  Template templateRecord{std::move(template_init.name), std::move(template_init.args), archetypeId, std::move(trackedComponents), {}, {}, 0};
 
-  mgr.templates[templateId] = std::move(templateRecord);
+  // recipe points into templateRecord.args, flat_hash_map keeps its storage on move
+  Template &registeredTemplate = mgr.templates[templateId] = std::move(templateRecord);
+  build_template_recipe(mgr, registeredTemplate, template_init.overrideSlots);
 
   return templateId;
 }
@@ -403,76 +916,213 @@ void destroy_entities(EcsManager &mgr)
   {
     if (entity.entityState == ecs_details::EntityState::Alive)
     {
-      perform_event_immediate(mgr, entity.archetypeId, entity.componentIndex, ecs::EventInfo<OnDisappear>::eventId, &event);
+      perform_event_immediate(*entity.archetype, entity.componentIndex, ecs::EventInfo<OnDisappear>::eventId, &event);
     }
   }
   for (auto &[id, archetype] : mgr.archetypeMap)
   {
-    ecs_details::destroy_all_entities_from_archetype(*archetype, mgr.typeMap);
+    ecs_details::destroy_all_entities_from_archetype(*archetype);
+    // chunks are reused by the next entities of any archetype with the same chunk size
+    archetype->release_empty_chunks();
   }
   mgr.entityContainer.entityRecords.clear();
   mgr.entityContainer.freeIndices.clear();
 }
 
-template <typename T, bool checkTracking>
-static T get_component_impl(EcsManager &mgr, EntityId eid, ComponentId componentId)
+uint32_t shrink_archetypes(EcsManager &mgr, uint32_t budget_us, bool shrink_tracked_bitsets)
 {
-  ecs::ArchetypeId archetypeId;
-  uint32_t componentIndex;
-  if (mgr.entityContainer.get(eid, archetypeId, componentIndex))
+  const uint32_t archetypeCount = mgr.archetypeList.size();
+  if (archetypeCount == 0)
+    return 0;
+  const auto deadline = std::chrono::steady_clock::now() + std::chrono::microseconds(budget_us);
+  mgr.shrinkArchetypeCursor %= archetypeCount;
+  uint32_t releasedCount = 0;
+  for (uint32_t i = 0; i < archetypeCount; i++)
   {
-    auto it = mgr.archetypeMap.find(archetypeId);
-    if (it == mgr.archetypeMap.end())
+    ecs_details::Archetype &archetype = *mgr.archetypeList[mgr.shrinkArchetypeCursor];
+    uint32_t archetypeReleasedCount = 0;
+    bool outOfBudget = false;
+    // one chunk per step, freeing of the chunk can be expensive with custom allocator
+    while (archetype.release_empty_chunks(1) == 1)
     {
-      ECS_LOG_ERROR(mgr).log("Archetype with hash %x not found", archetypeId);
-      return nullptr;
+      archetypeReleasedCount++;
+      if (std::chrono::steady_clock::now() >= deadline)
+      {
+        outOfBudget = true;
+        break;
+      }
     }
-    ecs_details::Archetype &archetype = *it->second;
-    int collumnIdx = archetype.getComponentCollumnIndex(componentId);
+    if (shrink_tracked_bitsets && archetypeReleasedCount > 0)
+    {
+      for (ecs_details::TrackedCollumn &trackedCollumn : archetype.trackedCollumns)
+        trackedCollumn.dirtyState.shrink_to_fit();
+    }
+    releasedCount += archetypeReleasedCount;
+    if (outOfBudget)
+      break;
+
+    mgr.shrinkArchetypeCursor = (mgr.shrinkArchetypeCursor + 1) % archetypeCount;
+    // archetypes without empty chunks are cheap to skip, so the call doesn't stop before the first released chunk
+    if (releasedCount > 0 && std::chrono::steady_clock::now() >= deadline)
+      break;
+  }
+  if (releasedCount > 0)
+    ECS_LOG_INFO_VERBOSE(mgr).log("shrink_archetypes released %u chunks", releasedCount);
+  return releasedCount;
+}
+
+ComponentHandle get_component_handle(const EcsManager &mgr, ComponentId componentId)
+{
+  ComponentHandle component;
+  component.componentId = componentId;
+  auto cmpIt = mgr.componentMap.find(componentId);
+  if (cmpIt != mgr.componentMap.end())
+    component.denseIndex = cmpIt->second->denseIndex;
+  return component;
+}
+
+template <bool checkTracking>
+static ecs_details::Collumn *find_component_collumn(EcsManager &mgr, EntityId eid, ComponentHandle component, ecs_details::Archetype *&archetype, uint32_t &componentIndex)
+{
+  if (mgr.entityContainer.get(eid, archetype, componentIndex))
+  {
+    // the component could be registered after the handle was resolved
+    const uint32_t denseIndex = component.denseIndex != UINT32_MAX ? component.denseIndex : get_component_handle(mgr, component.componentId).denseIndex;
+    int collumnIdx = archetype->getDenseCollumnIndex(denseIndex);
     if (collumnIdx != -1)
     {
+      assert(archetype->collumns[collumnIdx].componentId == component.componentId);
       if constexpr (checkTracking)
       {
-        int trackedCollumnIdx = archetype.getComponentTrackedCollumnIndex(componentId);
+        int trackedCollumnIdx = archetype->collumnTrackedIndex[collumnIdx];
         if (trackedCollumnIdx != -1)
         {
-          archetype.trackedCollumns[trackedCollumnIdx].mark_dirty(componentIndex);
+          archetype->trackedCollumns[trackedCollumnIdx].mark_dirty(componentIndex);
         }
+        ecs::mark_written(*archetype, std::span<const int>(&collumnIdx, 1), componentIndex);
       }
-      return archetype.getData(archetype.collumns[collumnIdx], componentIndex);
+      return &archetype->collumns[collumnIdx];
     }
   }
   return nullptr;
 }
 
+template <typename T, bool checkTracking>
+static T get_component_impl(EcsManager &mgr, EntityId eid, ComponentHandle component)
+{
+  ecs_details::Archetype *archetype;
+  uint32_t componentIndex;
+  ecs_details::Collumn *collumn = find_component_collumn<checkTracking>(mgr, eid, component, archetype, componentIndex);
+  if (collumn == nullptr)
+    return nullptr;
+  if (collumn->soaLaneCount)
+  {
+    ECS_LOG_ERROR(mgr).log("Component %s is stored as SoA and can't be accessed by pointer", collumn->debugName.c_str());
+    return nullptr;
+  }
+  return archetype->getData(*collumn, componentIndex);
+}
+
+bool read_soa_component(EcsManager &mgr, EntityId eid, ComponentHandle component, void *dst)
+{
+  ecs_details::Archetype *archetype;
+  uint32_t componentIndex;
+  ecs_details::Collumn *collumn = find_component_collumn<false>(mgr, eid, component, archetype, componentIndex);
+  if (collumn == nullptr || collumn->soaLaneCount == 0)
+    return false;
+  archetype->gatherData(*collumn, componentIndex, dst);
+  return true;
+}
+
+bool write_soa_component(EcsManager &mgr, EntityId eid, ComponentHandle component, const void *src)
+{
+  ecs_details::Archetype *archetype;
+  uint32_t componentIndex;
+  ecs_details::Collumn *collumn = find_component_collumn<true>(mgr, eid, component, archetype, componentIndex);
+  if (collumn == nullptr || collumn->soaLaneCount == 0)
+    return false;
+  archetype->scatterData(*collumn, componentIndex, src);
+  return true;
+}
+
+bool read_soa_component(EcsManager &mgr, EntityId eid, ComponentId componentId, void *dst)
+{
+  return read_soa_component(mgr, eid, get_component_handle(mgr, componentId), dst);
+}
+
+bool write_soa_component(EcsManager &mgr, EntityId eid, ComponentId componentId, const void *src)
+{
+  return write_soa_component(mgr, eid, get_component_handle(mgr, componentId), src);
+}
+
+const void *get_component(EcsManager &mgr, EntityId eid, ComponentHandle component)
+{
+  return get_component_impl<const void *, false>(mgr, eid, component);
+}
+
+void *get_rw_component(EcsManager &mgr, EntityId eid, ComponentHandle component)
+{
+  return get_component_impl<void *, true>(mgr, eid, component);
+}
+
 const void *get_component(EcsManager &mgr, EntityId eid, ComponentId componentId)
 {
-  return get_component_impl<const void *, false>(mgr, eid, componentId);
+  return get_component(mgr, eid, get_component_handle(mgr, componentId));
 }
 
 void *get_rw_component(EcsManager &mgr, EntityId eid, ComponentId componentId)
 {
-  return get_component_impl<void *, true>(mgr, eid, componentId);
+  return get_rw_component(mgr, eid, get_component_handle(mgr, componentId));
+}
+
+bool has_component(EcsManager &mgr, EntityId eid, ComponentHandle component)
+{
+  ecs_details::Archetype *archetype;
+  uint32_t componentIndex;
+  if (!mgr.entityContainer.get(eid, archetype, componentIndex))
+    return false;
+  const uint32_t denseIndex = component.denseIndex != UINT32_MAX ? component.denseIndex : get_component_handle(mgr, component.componentId).denseIndex;
+  return archetype->componentMask.test(denseIndex);
+}
+
+bool has_component(EcsManager &mgr, EntityId eid, ComponentId componentId)
+{
+  return has_component(mgr, eid, get_component_handle(mgr, componentId));
 }
 
 void init_singletons(EcsManager &mgr)
 {
   for (const auto &[typeId, typeDecl] : mgr.typeMap)
   {
-    if (typeDecl.isSingleton)
+    if (typeDecl->isSingleton)
     {
-      if (typeDecl.construct_default)
+      if (typeDecl->construct_default)
       {
-        mgr.singletons[typeId] = ecs::SingletonComponent(typeDecl);
+        mgr.singletons[typeId] = ecs::SingletonComponent(*typeDecl);
       }
       else
       {
-        ECS_LOG_ERROR(mgr).log("Singleton component %s has no default constructor", typeDecl.typeName.c_str());
+        ECS_LOG_ERROR(mgr).log("Singleton component %s has no default constructor", typeDecl->typeName.c_str());
       }
     }
   }
 }
 
+void init_job_scheduler(EcsManager &mgr, int worker_count)
+{
+  if (worker_count < 0)
+  {
+    worker_count = std::max(int(std::thread::hardware_concurrency()) - 1, 0);
+  }
+  mgr.jobScheduler.reset();
+  mgr.jobScheduler = std::make_unique<ecs_details::JobScheduler>(worker_count);
+  while (mgr.commandBuffers.size() < uint32_t(worker_count) + 1)
+  {
+    mgr.commandBuffers.push_back(std::make_unique<EcsManager::CommandBuffer>());
+  }
+  ECS_LOG_INFO_VERBOSE(mgr).log("Job scheduler started with %d workers", worker_count);
+}
+
 
 void track_changes(ecs::EcsManager &mgr)
 {
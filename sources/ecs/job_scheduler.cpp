@@ -0,0 +1,131 @@
+#include "ecs/job_scheduler.h"
+#include <assert.h>
+
+namespace ecs_details
+{
+
+// queue index of the worker thread, valid only for the scheduler stored in threadScheduler
+static thread_local const JobScheduler *threadScheduler = nullptr;
+static thread_local uint32_t threadQueueIndex = 0;
+
+void JobQueue::push(const Job *jobs_begin, uint32_t jobs_count)
+{
+  std::lock_guard<std::mutex> lock(mutex);
+  jobs.insert(jobs.end(), jobs_begin, jobs_begin + jobs_count);
+}
+
+bool JobQueue::pop(Job &job)
+{
+  std::lock_guard<std::mutex> lock(mutex);
+  if (jobs.empty())
+    return false;
+  job = jobs.back();
+  jobs.pop_back();
+  return true;
+}
+
+bool JobQueue::steal(Job &job)
+{
+  std::lock_guard<std::mutex> lock(mutex);
+  if (jobs.empty())
+    return false;
+  job = jobs.front();
+  jobs.pop_front();
+  return true;
+}
+
+JobScheduler::JobScheduler(uint32_t worker_count)
+{
+  queues.reserve(worker_count + 1);
+  for (uint32_t i = 0; i <= worker_count; i++)
+    queues.push_back(std::make_unique<JobQueue>());
+
+  workers.reserve(worker_count);
+  for (uint32_t i = 1; i <= worker_count; i++)
+    workers.emplace_back([this, i]() { worker_loop(i); });
+}
+
+JobScheduler::~JobScheduler()
+{
+  {
+    std::lock_guard<std::mutex> lock(sleepMutex);
+    stopped = true;
+  }
+  wakeUp.notify_all();
+  for (std::thread &worker : workers)
+    worker.join();
+}
+
+uint32_t JobScheduler::current_queue_index() const
+{
+  return threadScheduler == this ? threadQueueIndex : 0;
+}
+
+void JobScheduler::submit(Job::JobFunction function, const void *context, uint32_t job_count, JobGroup &group)
+{
+  constexpr uint32_t BATCH_SIZE = 64;
+  Job batch[BATCH_SIZE];
+
+  group.pendingJobs.fetch_add(job_count, std::memory_order_relaxed);
+  // counted before jobs are published, so fetch_sub after a pop never wraps the counter
+  {
+    std::lock_guard<std::mutex> lock(sleepMutex);
+    queuedJobs.fetch_add(job_count, std::memory_order_relaxed);
+  }
+  JobQueue &queue = *queues[current_queue_index()];
+  for (uint32_t batchBegin = 0; batchBegin < job_count; batchBegin += BATCH_SIZE)
+  {
+    uint32_t batchCount = std::min(job_count - batchBegin, BATCH_SIZE);
+    // push in reverse order, so owner pops jobs in ascending order
+    for (uint32_t i = 0; i < batchCount; i++)
+      batch[i] = Job{function, context, job_count - 1 - (batchBegin + i), &group};
+    queue.push(batch, batchCount);
+  }
+  wakeUp.notify_all();
+}
+
+bool JobScheduler::try_execute_job(uint32_t queue_idx)
+{
+  Job job;
+  bool found = queues[queue_idx]->pop(job);
+  for (uint32_t i = 1, n = queues.size(); !found && i < n; i++)
+  {
+    found = queues[(queue_idx + i) % n]->steal(job);
+  }
+  if (!found)
+    return false;
+
+  queuedJobs.fetch_sub(1, std::memory_order_relaxed);
+  job.function(job.context, job.jobIdx);
+  job.group->pendingJobs.fetch_sub(1, std::memory_order_release);
+  return true;
+}
+
+void JobScheduler::wait(JobGroup &group)
+{
+  const uint32_t queueIdx = current_queue_index();
+  while (group.pendingJobs.load(std::memory_order_acquire) != 0)
+  {
+    if (!try_execute_job(queueIdx))
+      std::this_thread::yield();
+  }
+}
+
+void JobScheduler::worker_loop(uint32_t queue_idx)
+{
+  threadScheduler = this;
+  threadQueueIndex = queue_idx;
+  while (true)
+  {
+    if (try_execute_job(queue_idx))
+      continue;
+
+    std::unique_lock<std::mutex> lock(sleepMutex);
+    wakeUp.wait(lock, [this]() { return stopped || queuedJobs.load(std::memory_order_relaxed) != 0; });
+    if (stopped)
+      break;
+  }
+  threadScheduler = nullptr;
+}
+
+} // namespace ecs_details
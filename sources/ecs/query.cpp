@@ -1,6 +1,7 @@
 #include "ecs/query.h"
 #include "ecs/ecs_manager.h"
 #include <assert.h>
+#include <algorithm>
 
 namespace ecs_details
 {
@@ -144,12 +145,91 @@ void apply_reorder(std::vector<T> &vec, const std::vector<uint32_t> &order)
   vec.swap(tmp);
 }
 
+static bool is_write_access(Query::ComponentAccess access)
+{
+  return access == Query::ComponentAccess::READ_WRITE || access == Query::ComponentAccess::READ_WRITE_OPTIONAL;
+}
+
+static bool has_intersection(const std::vector<ComponentId> &a, const std::vector<ComponentId> &b)
+{
+  for (uint32_t i = 0, j = 0; i < a.size() && j < b.size();)
+  {
+    if (a[i] == b[j])
+      return true;
+    a[i] < b[j] ? i++ : j++;
+  }
+  return false;
+}
+
+static bool has_name(const std::vector<ecs_details::tiny_string> &names, const ecs_details::tiny_string &name)
+{
+  return std::find(names.begin(), names.end(), name) != names.end();
+}
+
+static StageExecutionPlan build_stage_plan(const EcsManager &mgr, const std::vector<System> &systems)
+{
+  struct SystemAccess
+  {
+    std::vector<ComponentId> reads, writes; // sorted
+  };
+  std::vector<SystemAccess> access(systems.size());
+  const auto get_access_key = [&](ComponentId component_id) {
+    auto it = mgr.typeMap.find(get_type_id(component_id));
+    // all singleton components of the same type share one instance
+    return it != mgr.typeMap.end() && it->second->isSingleton ? ComponentId(get_type_id(component_id)) : component_id;
+  };
+  for (uint32_t i = 0; i < systems.size(); i++)
+  {
+    for (const Query::ComponentAccessInfo &info : systems[i].querySignature)
+    {
+      (is_write_access(info.access) ? access[i].writes : access[i].reads).push_back(get_access_key(info.componentId));
+    }
+    // changed filter reads Collumn::chunkVersions written by the other systems, archetype matching reads the archetype type
+    for (const std::vector<ComponentId> *components : {&systems[i].changedComponents, &systems[i].requireComponents, &systems[i].excludeComponents})
+    {
+      for (ComponentId componentId : *components)
+        access[i].reads.push_back(get_access_key(componentId));
+    }
+    std::sort(access[i].reads.begin(), access[i].reads.end());
+    std::sort(access[i].writes.begin(), access[i].writes.end());
+  }
+
+  StageExecutionPlan plan;
+  plan.dependencies.resize(systems.size());
+  std::vector<uint32_t> waveIdx(systems.size(), 0);
+  // systems are already sorted, so earlier system of the conflicting pair is performed first
+  for (uint32_t j = 0; j < systems.size(); j++)
+  {
+    for (uint32_t i = 0; i < j; i++)
+    {
+      bool conflict = has_intersection(access[i].writes, access[j].writes) ||
+                      has_intersection(access[i].writes, access[j].reads) ||
+                      has_intersection(access[i].reads, access[j].writes);
+      bool explicitOrder = has_name(systems[i].before, systems[j].name) || has_name(systems[i].after, systems[j].name) ||
+                           has_name(systems[j].before, systems[i].name) || has_name(systems[j].after, systems[i].name);
+      if (conflict || explicitOrder)
+      {
+        plan.dependencies[j].push_back(i);
+        waveIdx[j] = std::max(waveIdx[j], waveIdx[i] + 1);
+      }
+    }
+    if (waveIdx[j] >= plan.waves.size())
+      plan.waves.resize(waveIdx[j] + 1);
+    plan.waves[waveIdx[j]].push_back(j);
+  }
+  return plan;
+}
+
 void sort_systems(EcsManager &mgr)
 {
+  mgr.stagePlans.clear();
   for (auto &[id, systems] : mgr.systems)
   {
     std::vector<uint32_t> rightOrder = topological_sort(mgr, systems.size(), [&](uint32_t idx) { return &systems[idx]; });
     apply_reorder(systems, rightOrder);
+    const StageExecutionPlan &plan = mgr.stagePlans[id] = build_stage_plan(mgr, systems);
+    if (!systems.empty())
+      ECS_LOG_INFO_VERBOSE(mgr).log("Stage %s: %u systems in %u waves", systems[0].stage.c_str(), (uint32_t)systems.size(), (uint32_t)plan.waves.size());
   }
 
   for (auto &[id, events] : mgr.eventIdToHandlers)
@@ -157,31 +237,72 @@ void sort_systems(EcsManager &mgr)
     std::vector<uint32_t> rightOrder = topological_sort(mgr, events.size(), [&](uint32_t idx) { return &mgr.events[events[idx]]; });
     apply_reorder(events, rightOrder);
   }
+  // handlers order is changed
+  for (ecs_details::Archetype *archetype : mgr.archetypeList)
+    ecs_details::build_event_handler_table(mgr, *archetype);
 }
 
-bool try_registrate(ecs::EcsManager &mgr, ecs::Query &query, const ecs_details::Archetype *archetype)
+static void build_query_masks(const ecs::EcsManager &mgr, ecs::Query &query)
 {
+  query.requireMask.clear();
+  query.excludeMask.clear();
+  query.hasUnknownRequired = false;
+  query.hasUnknownExcluded = false;
+  query.maskComponentCount = mgr.componentMap.size();
+
+  const auto add_required = [&](ComponentId componentId) {
+    // singletons are not stored in archetypes, they are resolved with the column maps
+    auto typeIt = mgr.typeMap.find(get_type_id(componentId));
+    if (typeIt != mgr.typeMap.end() && typeIt->second->isSingleton)
+      return;
+    auto it = mgr.componentMap.find(componentId);
+    if (it != mgr.componentMap.end())
+      query.requireMask.set(it->second->denseIndex);
+    else
+      query.hasUnknownRequired = true;
+  };
   for (ComponentId componentId : query.requireComponents)
+    add_required(componentId);
+  for (const Query::ComponentAccessInfo &componentAccessInfo : query.querySignature)
   {
-    if (archetype->getComponentCollumnIndex(componentId) == -1)
-    {
-      return false;
-    }
+    if (!(componentAccessInfo.access == Query::ComponentAccess::READ_ONLY_OPTIONAL || componentAccessInfo.access == Query::ComponentAccess::READ_WRITE_OPTIONAL))
+      add_required(componentAccessInfo.componentId);
   }
-
   for (ComponentId componentId : query.excludeComponents)
   {
-    if (archetype->getComponentCollumnIndex(componentId) != -1)
-    {
-      return false;
-    }
+    auto it = mgr.componentMap.find(componentId);
+    if (it != mgr.componentMap.end())
+      query.excludeMask.set(it->second->denseIndex);
+    else
+      query.hasUnknownExcluded = true;
   }
+}
 
-  ToComponentMap toComponentIndex;
-  toComponentIndex.reserve(query.querySignature.size());
-  std::vector<int> toTrackedComponentIndex;
-  toTrackedComponentIndex.reserve(query.querySignature.size());
-
+bool try_registrate(ecs::EcsManager &mgr, ecs::Query &query, const ecs_details::Archetype *archetype)
+{
+  if (query.maskComponentCount == 0 ||
+      ((query.hasUnknownRequired || query.hasUnknownExcluded) && query.maskComponentCount != mgr.componentMap.size()))
+  {
+    build_query_masks(mgr, query);
+  }
+  // every archetype component is registered, so the unknown one can't be in the archetype
+  if (query.hasUnknownRequired)
+    return false;
+  if (!archetype->componentMask.contains(query.requireMask) || archetype->componentMask.intersects(query.excludeMask))
+    return false;
+
+  // columns are written directly to the query storage and rolled back if archetype doesn't match
+  const size_t componentsOffset = query.archetypesComponents.size();
+  const size_t trackedOffset = query.archetypesTrackedComponents.size();
+  const size_t writtenOffset = query.archetypesWrittenCollumns.size();
+  std::vector<std::vector<char *> *> &toComponentIndex = query.archetypesComponents;
+  std::vector<int> &toTrackedComponentIndex = query.archetypesTrackedComponents;
+  const auto rollback = [&]() {
+    toComponentIndex.resize(componentsOffset);
+    toTrackedComponentIndex.resize(trackedOffset);
+    query.archetypesWrittenCollumns.resize(writtenOffset);
+    return false;
+  };
 
   for (const Query::ComponentAccessInfo &componentAccessInfo : query.querySignature)
   {
@@ -192,6 +313,7 @@ bool try_registrate(ecs::EcsManager &mgr, ecs::Query &query, const ecs_details::
 
       if (componentAccessInfo.access == Query::ComponentAccess::READ_WRITE || componentAccessInfo.access == Query::ComponentAccess::READ_WRITE_OPTIONAL)
       {
+        query.archetypesWrittenCollumns.push_back(componentIndex);
         int trackedComponentIndex = archetype->getComponentTrackedCollumnIndex(componentAccessInfo.componentId);
         if (trackedComponentIndex != -1)
         {
@@ -199,6 +321,11 @@ bool try_registrate(ecs::EcsManager &mgr, ecs::Query &query, const ecs_details::
         }
       }
     }
+    else if (archetype->hasComponent(componentAccessInfo.componentId) && !archetype->collumns.empty())
+    {
+      // tag has no storage, any collumn gives valid addresses for the empty type
+      toComponentIndex.push_back((std::vector<char *> *)&(archetype->collumns[0].chunks));
+    }
     else
     {
       auto it = mgr.singletons.find(get_type_id(componentAccessInfo.componentId));
@@ -208,7 +335,7 @@ bool try_registrate(ecs::EcsManager &mgr, ecs::Query &query, const ecs_details::
       }
       else if (!(componentAccessInfo.access == Query::ComponentAccess::READ_ONLY_OPTIONAL || componentAccessInfo.access == Query::ComponentAccess::READ_WRITE_OPTIONAL))
       {
-        return false;
+        return rollback();
       }
       else
       {
@@ -217,13 +344,9 @@ bool try_registrate(ecs::EcsManager &mgr, ecs::Query &query, const ecs_details::
     }
   }
 
-  query.archetypesCache.emplace(archetype->archetypeId,
-    ArchetypeRecord(
-      (ecs_details::Archetype *)archetype,
-      std::move(toComponentIndex),
-      std::move(toTrackedComponentIndex)
-    )
-  );
+  query.archetypeToIndex.emplace(archetype->archetypeId, query.archetypes.size());
+  query.archetypes.push_back({(ecs_details::Archetype *)archetype, (uint32_t)trackedOffset, uint32_t(toTrackedComponentIndex.size() - trackedOffset),
+    (uint32_t)writtenOffset, uint32_t(query.archetypesWrittenCollumns.size() - writtenOffset)});
 
   return true;
 }
@@ -272,17 +395,124 @@ void register_event(EcsManager &mgr, EventHandler &&event)
     mgr.eventIdToHandlers[eventId].push_back(event.nameHash);
   }
   mgr.events[event.nameHash] = std::move(event);
+  // events map could be rehashed, all handler pointers are refreshed
+  for (ecs_details::Archetype *archetype : mgr.archetypeList)
+    ecs_details::build_event_handler_table(mgr, *archetype);
 }
 
 void perform_system(const System &system)
 {
-  for (const auto &[archetypeId, archetypeRecord] : system.archetypesCache)
+  for (uint32_t archetypeIdx = 0, n = system.archetypes.size(); archetypeIdx < n; archetypeIdx++)
+  {
+    ecs_details::Archetype &archetype = *system.archetypes[archetypeIdx].archetype;
+    system.update_archetype(archetype, system.get_components(archetypeIdx), 0, archetype.getUsedChunkCount());
+  }
+}
+
+void gather_chunk_jobs(const Query &query, std::vector<ArchetypeChunkJob> &jobs)
+{
+  for (uint32_t archetypeIdx = 0, n = query.archetypes.size(); archetypeIdx < n; archetypeIdx++)
+  {
+    const ecs_details::Archetype &archetype = *query.archetypes[archetypeIdx].archetype;
+    const uint32_t usedChunkCount = archetype.getUsedChunkCount();
+    for (uint32_t chunkIdx = 0; chunkIdx < usedChunkCount; chunkIdx++)
+    {
+      jobs.push_back({archetypeIdx, chunkIdx});
+    }
+  }
+}
+
+// collumns of System::changedComponents in the archetype, returns false if archetype has none of them
+static bool get_changed_collumns(const System &system, const ecs_details::Archetype &archetype, std::vector<int> &changed_collumns)
+{
+  changed_collumns.clear();
+  for (ComponentId componentId : system.changedComponents)
   {
-    system.update_archetype(*archetypeRecord.archetype, archetypeRecord.toComponentIndex);
+    int collumnIdx = archetype.getComponentCollumnIndex(componentId);
+    if (collumnIdx != -1)
+      changed_collumns.push_back(collumnIdx);
   }
+  return !changed_collumns.empty();
 }
 
-void mark_dirty(ecs_details::Archetype &archetype, const std::vector<int> &to_tracked_component, uint32_t component_idx)
+static bool is_chunk_changed(const ecs_details::Archetype &archetype, std::span<const int> changed_collumns, uint32_t chunk_idx, uint64_t last_run_version)
+{
+  for (int collumnIdx : changed_collumns)
+  {
+    if (archetype.collumns[collumnIdx].chunkVersions[chunk_idx] > last_run_version)
+      return true;
+  }
+  return false;
+}
+
+// calls callable(archetype_idx, chunk_begin, chunk_end) for chunk ranges which should be updated by the system
+template<typename Callable>
+static void for_each_system_chunks(const System &system, Callable &&callable)
+{
+  std::vector<int> changedCollumns;
+  for (uint32_t archetypeIdx = 0, n = system.archetypes.size(); archetypeIdx < n; archetypeIdx++)
+  {
+    const ecs_details::Archetype &archetype = *system.archetypes[archetypeIdx].archetype;
+    const uint32_t usedChunkCount = archetype.getUsedChunkCount();
+    if (system.changedComponents.empty())
+    {
+      if (usedChunkCount > 0)
+        callable(archetypeIdx, 0u, usedChunkCount);
+      continue;
+    }
+    if (!get_changed_collumns(system, archetype, changedCollumns))
+      continue;
+    // consecutive changed chunks are updated by one call
+    for (uint32_t chunkIdx = 0; chunkIdx < usedChunkCount;)
+    {
+      if (!is_chunk_changed(archetype, changedCollumns, chunkIdx, system.lastRunVersion))
+      {
+        chunkIdx++;
+        continue;
+      }
+      const uint32_t chunkBegin = chunkIdx;
+      while (chunkIdx < usedChunkCount && is_chunk_changed(archetype, changedCollumns, chunkIdx, system.lastRunVersion))
+        chunkIdx++;
+      callable(archetypeIdx, chunkBegin, chunkIdx);
+    }
+  }
+}
+
+void perform_system(EcsManager &mgr, const System &system)
+{
+  // writes of the system are stamped with its version, so they don't trigger its own changed filter.
+  // The version is taken again after the run, writes outside of systems get a newer one
+  const uint64_t version = mgr.changeVersion.fetch_add(1, std::memory_order_relaxed) + 1;
+  const auto update_chunks = [&](uint32_t archetype_idx, uint32_t chunk_begin, uint32_t chunk_end) {
+    ecs_details::Archetype &archetype = *system.archetypes[archetype_idx].archetype;
+    ecs::mark_written(archetype, system.get_written_collumns(archetype_idx), chunk_begin, chunk_end, version);
+    system.update_archetype(archetype, system.get_components(archetype_idx), chunk_begin, chunk_end);
+  };
+
+  if (!system.isJob || !mgr.jobScheduler || mgr.jobScheduler->worker_count() == 0)
+  {
+    CommandScope commandScope(system.nameHash);
+    for_each_system_chunks(system, update_chunks);
+  }
+  else
+  {
+    std::vector<ArchetypeChunkJob> jobs;
+    for_each_system_chunks(system, [&](uint32_t archetype_idx, uint32_t chunk_begin, uint32_t chunk_end) {
+      for (uint32_t chunkIdx = chunk_begin; chunkIdx < chunk_end; chunkIdx++)
+        jobs.push_back({archetype_idx, chunkIdx});
+    });
+
+    mgr.jobScheduler->parallel_for(jobs.size(), [&](uint32_t job_idx) {
+      CommandScope commandScope(CommandScope::job_source(system.nameHash, job_idx));
+      const ArchetypeChunkJob &job = jobs[job_idx];
+      update_chunks(job.archetypeIdx, job.chunkIdx, job.chunkIdx + 1);
+    });
+  }
+  system.lastRunVersion = version;
+  mgr.changeVersion.fetch_add(1, std::memory_order_relaxed);
+}
+
+void mark_dirty(ecs_details::Archetype &archetype, std::span<const int> to_tracked_component, uint32_t component_idx)
 {
   for (int tracked_component_idx : to_tracked_component)
   {
@@ -290,7 +520,7 @@ void mark_dirty(ecs_details::Archetype &archetype, const std::vector<int> &to_tr
   }
 }
 
-void mark_dirty(ecs_details::Archetype &archetype, const std::vector<int> &to_tracked_component)
+void mark_dirty(ecs_details::Archetype &archetype, std::span<const int> to_tracked_component)
 {
   for (int tracked_component_idx : to_tracked_component)
   {
@@ -298,16 +528,83 @@ void mark_dirty(ecs_details::Archetype &archetype, const std::vector<int> &to_tr
   }
 }
 
+void mark_written(ecs_details::Archetype &archetype, std::span<const int> written_collumns, uint32_t chunk_begin, uint32_t chunk_end, uint64_t version)
+{
+  for (int collumnIdx : written_collumns)
+  {
+    std::vector<uint64_t> &chunkVersions = archetype.collumns[collumnIdx].chunkVersions;
+    std::fill(chunkVersions.begin() + chunk_begin, chunkVersions.begin() + chunk_end, version);
+  }
+}
+
+void mark_written(ecs_details::Archetype &archetype, std::span<const int> written_collumns, uint32_t component_idx)
+{
+  const uint32_t chunkIdx = component_idx >> archetype.chunkSizePower;
+  mark_written(archetype, written_collumns, chunkIdx, chunkIdx + 1, archetype.getChangeVersion());
+}
+
+void mark_written(ecs_details::Archetype &archetype, std::span<const int> written_collumns)
+{
+  mark_written(archetype, written_collumns, 0, archetype.getUsedChunkCount(), archetype.getChangeVersion());
+}
+
+static void perform_systems(EcsManager &mgr, NameHash stage_hash, const std::vector<System> &systems)
+{
+  auto it = mgr.stagePlans.find(stage_hash);
+  // plan is outdated if systems were registered after sort_systems
+  if (!mgr.jobScheduler || mgr.jobScheduler->worker_count() == 0 || it == mgr.stagePlans.end() || it->second.dependencies.size() != systems.size())
+  {
+    for (const System &system : systems)
+    {
+      perform_system(mgr, system);
+    }
+    return;
+  }
+  const StageExecutionPlan &plan = it->second;
+  std::vector<uint32_t> waveIdx(systems.size(), 0);
+  std::vector<std::vector<uint32_t>> waves;
+  for (uint32_t begin = 0; begin < systems.size();)
+  {
+    // access signature doesn't cover entity creation, events and access by eid,
+    // so systems that didn't opt in with job = true are performed one by one in the sorted order
+    if (!systems[begin].isJob)
+    {
+      perform_system(mgr, systems[begin++]);
+      continue;
+    }
+    // consecutive job systems are performed by waves, dependencies before begin are already performed
+    uint32_t end = begin;
+    waves.clear();
+    for (; end < systems.size() && systems[end].isJob; end++)
+    {
+      waveIdx[end] = 0;
+      for (uint32_t dependency : plan.dependencies[end])
+      {
+        if (dependency >= begin)
+          waveIdx[end] = std::max(waveIdx[end], waveIdx[dependency] + 1);
+      }
+      if (waveIdx[end] >= waves.size())
+        waves.resize(waveIdx[end] + 1);
+      waves[waveIdx[end]].push_back(end);
+    }
+    for (const std::vector<uint32_t> &wave : waves)
+    {
+      if (wave.size() > 1)
+        mgr.jobScheduler->parallel_for(wave.size(), [&](uint32_t idx) { perform_system(mgr, systems[wave[idx]]); });
+      else
+        perform_system(mgr, systems[wave[0]]);
+    }
+    begin = end;
+  }
+}
+
 void perform_stage(EcsManager &mgr, const char *stage)
 {
   ecs::NameHash stageHash = ecs::hash(stage);
   auto it = mgr.systems.find(stageHash);
   if (it != mgr.systems.end())
   {
-    for (System &system : it->second)
-    {
-      perform_system(system);
-    }
+    perform_systems(mgr, stageHash, it->second);
   }
 }
 
@@ -315,10 +612,7 @@ void perform_stages(EcsManager &mgr)
 {
   for (auto &[id, systems] : mgr.systems)
   {
-    for (System &system : systems)
-    {
-      perform_system(system);
-    }
+    perform_systems(mgr, id, systems);
   }
 }
 
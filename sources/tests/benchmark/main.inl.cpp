@@ -35,22 +35,22 @@ static void query_perf_test3(ecs::EcsManager &mgr, Callable &&query_function)
   ecs_details::query_iteration<N, ecs_details::Ptr<float3>, ecs_details::Ptr<float3>, ecs_details::Ptr<const float3>>(mgr, queryHash, std::move(query_function));
 }
 
-static void system_perf_test1_implementation(ecs_details::Archetype &archetype, const ecs::ToComponentMap &to_archetype_component)
+static void system_perf_test1_implementation(ecs_details::Archetype &archetype, ecs::ToComponentMap to_archetype_component, uint32_t chunk_begin, uint32_t chunk_end)
 {
   const int N = 1;
-  ecs_details::query_archetype_iteration<N, ecs_details::Ptr<float3>>(archetype, to_archetype_component, system_perf_test1, std::make_index_sequence<N>());
+  ecs_details::query_archetype_iteration<N, ecs_details::Ptr<float3>>(archetype, to_archetype_component, chunk_begin, chunk_end, system_perf_test1, std::make_index_sequence<N>());
 }
 
-static void system_perf_test2_implementation(ecs_details::Archetype &archetype, const ecs::ToComponentMap &to_archetype_component)
+static void system_perf_test2_implementation(ecs_details::Archetype &archetype, ecs::ToComponentMap to_archetype_component, uint32_t chunk_begin, uint32_t chunk_end)
 {
   const int N = 2;
-  ecs_details::query_archetype_iteration<N, ecs_details::Ptr<float3>, ecs_details::Ptr<const float3>>(archetype, to_archetype_component, system_perf_test2, std::make_index_sequence<N>());
+  ecs_details::query_archetype_iteration<N, ecs_details::Ptr<float3>, ecs_details::Ptr<const float3>>(archetype, to_archetype_component, chunk_begin, chunk_end, system_perf_test2, std::make_index_sequence<N>());
 }
 
-static void system_perf_test3_implementation(ecs_details::Archetype &archetype, const ecs::ToComponentMap &to_archetype_component)
+static void system_perf_test3_implementation(ecs_details::Archetype &archetype, ecs::ToComponentMap to_archetype_component, uint32_t chunk_begin, uint32_t chunk_end)
 {
   const int N = 3;
-  ecs_details::query_archetype_iteration<N, ecs_details::Ptr<float3>, ecs_details::Ptr<float3>, ecs_details::Ptr<const float3>>(archetype, to_archetype_component, system_perf_test3, std::make_index_sequence<N>());
+  ecs_details::query_archetype_iteration<N, ecs_details::Ptr<float3>, ecs_details::Ptr<float3>, ecs_details::Ptr<const float3>>(archetype, to_archetype_component, chunk_begin, chunk_end, system_perf_test3, std::make_index_sequence<N>());
 }
 
 static void ecs_registration(ecs::EcsManager &mgr)
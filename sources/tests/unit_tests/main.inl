@@ -4,9 +4,16 @@
 #include "math_helper.h"
 #include "timer.h"
 #include "logger.h"
+#include <thread>
+#include <mutex>
+#include <set>
 
 void query_test(ecs::EcsManager &mgr);
 
+// plain struct without padding, tracking compares its chunks with memcmp
+template<>
+struct ecs::track_bitwise<float3> : std::true_type {};
+
 ECS_TYPE_DECLARATION(int)
 ECS_TYPE_DECLARATION(float3)
 ECS_TYPE_DECLARATION_ALIAS(std::string, "string")
@@ -77,6 +84,42 @@ health_changed(const ecs::Event &, const std::string &name, int health)
 {
   printf("health_changed [%s] %d\n", name.c_str(), health);
 }
+
+static int trackValueCount = 0;
+static int trackValueSum = 0;
+static int trackLabelCount = 0;
+
+ECS_EVENT(track=int track_value)
+track_value_changed(const ecs::OnTrack &, int track_value)
+{
+  trackValueCount++;
+  trackValueSum += track_value;
+}
+
+ECS_EVENT(track=std::string track_label)
+track_label_changed(const ecs::OnTrack &, const std::string &track_label)
+{
+  assert(track_label == "changed label");
+  trackLabelCount++;
+}
+
+static int batchAppearCount = 0;
+static int batchAppearHealthSum = 0;
+static int batchDisappearCount = 0;
+static int batchDisappearHealthSum = 0;
+
+ECS_EVENT() on_batch_appear(const ecs::OnAppear &, int batch_health, const std::string &batch_name)
+{
+  assert(batch_name == "batch entity with long name " + std::to_string(batch_health));
+  batchAppearCount++;
+  batchAppearHealthSum += batch_health;
+}
+
+ECS_EVENT() on_batch_disappear(const ecs::OnDisappear &, int batch_health)
+{
+  batchDisappearCount++;
+  batchDisappearHealthSum += batch_health;
+}
 struct UpdateEvent
 {
 
@@ -112,6 +155,87 @@ multi_event(const ecs::Event &event, ecs::EntityId eid)
     printf("multi_event HeavyEvent [%d/%d]\n", eid.entityIndex, eid.generation);
 }
 
+struct CommandEvent
+{
+  int value;
+};
+
+ECS_EVENT_DECLARATION(CommandEvent)
+
+static std::atomic<int> commandEventCount = 0;
+static std::atomic<int> commandEventSum = 0;
+
+ECS_EVENT() command_event(const CommandEvent &event, int command_health)
+{
+  assert(event.value == command_health);
+  commandEventCount++;
+  commandEventSum += command_health;
+}
+
+// empty type is a tag, it has no collumn in archetype
+struct EnemyTag
+{
+};
+
+ECS_TYPE_DECLARATION(EnemyTag)
+ECS_TYPE_REGISTRATION(EnemyTag)
+
+// big enough to be tracked by digest instead of a shadow copy, bytes are hashed
+struct BigBlock
+{
+  int values[16];
+};
+
+template<>
+struct ecs::track_by_digest<BigBlock> : std::true_type {};
+
+ECS_TYPE_DECLARATION(BigBlock)
+ECS_TYPE_REGISTRATION(BigBlock)
+
+// container has no std::hash, digest is computed by the specialization
+using Inventory = std::vector<int>;
+
+template<>
+struct ecs::track_by_digest<Inventory> : std::true_type
+{
+  static uint64_t hash(const Inventory &inventory)
+  {
+    uint64_t h = inventory.size();
+    for (int item : inventory)
+      h = h * 1099511628211ull + uint64_t(item);
+    return h;
+  }
+};
+
+ECS_TYPE_DECLARATION_ALIAS(Inventory, "Inventory")
+ECS_TYPE_REGISTRATION(Inventory)
+
+// not trivially copyable, but don't point to themselves. Only the declared relocatable one is moved by memcpy
+struct RelocatableHandle
+{
+  static inline int moveCount = 0;
+  int value = 0;
+  RelocatableHandle(int v = 0) : value(v) {}
+  RelocatableHandle(const RelocatableHandle &other) : value(other.value) {}
+  RelocatableHandle(RelocatableHandle &&other) : value(other.value) { moveCount++; }
+  RelocatableHandle &operator=(const RelocatableHandle &) = default;
+};
+
+struct MovableHandle
+{
+  static inline int moveCount = 0;
+  int value = 0;
+  MovableHandle(int v = 0) : value(v) {}
+  MovableHandle(const MovableHandle &other) : value(other.value) {}
+  MovableHandle(MovableHandle &&other) : value(other.value) { moveCount++; }
+  MovableHandle &operator=(const MovableHandle &) = default;
+};
+
+ECS_RELOCATABLE_TYPE_DECLARATION(RelocatableHandle)
+ECS_TYPE_REGISTRATION(RelocatableHandle)
+ECS_TYPE_DECLARATION(MovableHandle)
+ECS_TYPE_REGISTRATION(MovableHandle)
+
 struct SingletonComponent
 {
   int value;
@@ -126,6 +250,1289 @@ update_with_singleton(ecs::EntityId eid, SingletonComponent &singleton)
   printf("update_with_singleton [%d/%d] SingletonComponent.value = %d\n", eid.entityIndex, eid.generation, singleton.value++);
 }
 
+ECS_SYSTEM(job = true; stage = job_act)
+job_move(float3 &job_position, const float3 &job_velocity)
+{
+  job_position = job_position + job_velocity;
+}
+
+static std::atomic<uint32_t> jobReadVelocityCount = 0;
+static std::atomic<uint32_t> jobReadPositionCount = 0;
+
+// only reads job_velocity, can be performed together with job_move
+ECS_SYSTEM(job = true; stage = job_act)
+job_read_velocity(const float3 &job_velocity)
+{
+  ECS_UNUSED(job_velocity);
+  jobReadVelocityCount++;
+}
+
+// reads job_position, should wait for job_move
+ECS_SYSTEM(stage = job_act)
+job_read_position(const float3 &job_position)
+{
+  ECS_UNUSED(job_position);
+  jobReadPositionCount++;
+}
+
+// not job systems, they are performed on the main thread in the sorted order even without conflicts
+static std::vector<std::thread::id> serialSystemThreads;
+static std::vector<ecs_details::tiny_string> serialSystemOrder;
+
+static void record_serial_system(const char *name)
+{
+  serialSystemThreads.push_back(std::this_thread::get_id());
+  if (serialSystemOrder.empty() || serialSystemOrder.back() != ecs_details::tiny_string(name))
+    serialSystemOrder.emplace_back(name);
+}
+
+// conflicts with serial_read_velocity, but not with serial_read_position
+ECS_SYSTEM(stage = serial_act)
+serial_touch_velocity(float3 &job_velocity)
+{
+  ECS_UNUSED(job_velocity);
+  record_serial_system("serial_touch_velocity");
+}
+
+ECS_SYSTEM(stage = serial_act)
+serial_read_velocity(const float3 &job_velocity)
+{
+  ECS_UNUSED(job_velocity);
+  record_serial_system("serial_read_velocity");
+}
+
+ECS_SYSTEM(stage = serial_act)
+serial_read_position(const float3 &job_position)
+{
+  ECS_UNUSED(job_position);
+  record_serial_system("serial_read_position");
+}
+
+static int changedReadCount = 0;
+static int changedSelfCount = 0;
+
+ECS_SYSTEM(changed = int changed_value; stage = changed_act)
+changed_read(const int &changed_value)
+{
+  ECS_UNUSED(changed_value);
+  changedReadCount++;
+}
+
+// own writes don't trigger the changed filter of the system
+ECS_SYSTEM(changed = int changed_value; stage = changed_self_act)
+changed_self(int &changed_value)
+{
+  changed_value++;
+  changedSelfCount++;
+}
+
+// changed filter reads chunk versions of changed_value, so it conflicts with the writer
+ECS_SYSTEM(job = true; stage = changed_plan_act)
+changed_plan_write(int &changed_value)
+{
+  changed_value++;
+}
+
+ECS_SYSTEM(job = true; changed = int changed_value; stage = changed_plan_act)
+changed_plan_read(ecs::EntityId eid)
+{
+  ECS_UNUSED(eid);
+}
+
+ECS_SYSTEM(chunk = true; job = true; stage = chunk_act)
+chunk_move(std::span<float3> job_position, std::span<const float3> job_velocity)
+{
+  assert(job_position.size() == job_velocity.size());
+  for (size_t i = 0; i < job_position.size(); i++)
+    job_position[i] = job_position[i] + job_velocity[i];
+}
+
+struct SoaFloat3
+{
+  float x, y, z;
+  bool operator==(const SoaFloat3 &other) const = default;
+};
+
+ECS_SOA_TYPE_DECLARATION(SoaFloat3, float)
+ECS_TYPE_REGISTRATION(SoaFloat3)
+
+ECS_SYSTEM(chunk = true; stage = soa_act)
+soa_move(ecs::SoaView<SoaFloat3> soa_position, ecs::SoaView<const SoaFloat3> soa_velocity)
+{
+  for (uint32_t k = 0; k < soa_position.laneCount; k++)
+  {
+    std::span<float> position = soa_position.lane(k);
+    std::span<const float> velocity = soa_velocity.lane(k);
+    for (size_t i = 0; i < position.size(); i++)
+      position[i] += velocity[i];
+  }
+}
+
+void soa_test(ecs::EcsManager &mgr)
+{
+  ecs::ComponentId positionId = ecs::get_or_add_component<SoaFloat3>(mgr, "soa_position");
+  ecs::ComponentId velocityId = ecs::get_or_add_component<SoaFloat3>(mgr, "soa_velocity");
+  ecs::TemplateId soaTemplate = template_registration(mgr, "soa_point",
+    {mgr, {
+      {positionId, SoaFloat3{}},
+      {velocityId, SoaFloat3{1, 2, 3}}
+    }}, ecs::ArchetypeChunkSize::Dozens);
+
+  const int SOA_ENTITY_COUNT = 100;
+  std::vector<ecs::EntityId> eids;
+  for (int i = 0; i < SOA_ENTITY_COUNT; i++)
+  {
+    float f = i;
+    eids.push_back(ecs::create_entity_sync(mgr, soaTemplate, {mgr, {{"soa_position", SoaFloat3{f, 2 * f, 3 * f}}}}));
+  }
+  ecs::destroy_entity_sync(mgr, eids[0]);
+
+  const ecs_details::Archetype *archetype = mgr.archetypeMap.find(mgr.templates[soaTemplate].archetypeId)->second.get();
+  const ecs_details::Collumn &positionCollumn = archetype->collumns[archetype->getComponentCollumnIndex(positionId)];
+  assert(positionCollumn.soaLaneCount == 3);
+  // last entity was moved to the place of destroyed one, lanes are xxxx..yyyy..zzzz
+  const float *chunk = (const float *)positionCollumn.chunks[0];
+  assert(chunk[0] == SOA_ENTITY_COUNT - 1 && chunk[1] == 1);
+  assert(chunk[archetype->chunkSize] == 2 * (SOA_ENTITY_COUNT - 1) && chunk[archetype->chunkSize + 1] == 2);
+
+  ecs::perform_stage(mgr, "soa_act");
+  assert(chunk[0] == SOA_ENTITY_COUNT && chunk[archetype->chunkSize] == 2 * SOA_ENTITY_COUNT);
+  ECS_UNUSED(positionCollumn);
+  ECS_UNUSED(chunk);
+
+  assert(ecs::set_component(mgr, eids[1], "soa_position", SoaFloat3{10, 20, 30}));
+  // last entity is checked by raw data above
+  for (int i = 1; i < SOA_ENTITY_COUNT - 1; i++)
+  {
+    float f = i == 1 ? 10 : i;
+    SoaFloat3 position;
+    assert(ecs::read_soa_component(mgr, eids[i], "soa_position", position));
+    assert(position == (i == 1 ? SoaFloat3{f, 2 * f, 3 * f} : SoaFloat3{f + 1, 2 * f + 2, 3 * f + 3}));
+    ECS_UNUSED(position);
+    ECS_UNUSED(f);
+  }
+  printf("soa_test done\n");
+}
+
+void single_allocation_test(ecs::EcsManager &mgr)
+{
+  ecs::ComponentId positionId = ecs::get_or_add_component<float3>(mgr, "block_position");
+  ecs::ComponentId nameId = ecs::get_or_add_component<std::string>(mgr, "block_name");
+  ecs::ComponentId healthId = ecs::get_or_add_component<int>(mgr, "block_health");
+
+  ecs::TemplateInit templateInit;
+  templateInit.name = "block_point";
+  templateInit.chunkSizePower = ecs::ArchetypeChunkSize::Dozens;
+  templateInit.chunkLayout = ecs::ArchetypeChunkLayout::SingleAllocation;
+  templateInit.args = {mgr, {
+    {positionId, float3{}},
+    {nameId, std::string{}},
+    {healthId, 0}
+  }};
+  templateInit.trackedComponents = {"block_health"};
+  ecs::TemplateId blockTemplate = template_registration(mgr, std::move(templateInit));
+
+  const int BLOCK_ENTITY_COUNT = 100;
+  std::vector<ecs::EntityId> eids;
+  for (int i = 0; i < BLOCK_ENTITY_COUNT; i++)
+  {
+    eids.push_back(ecs::create_entity_sync(mgr, blockTemplate, {mgr, {
+      {"block_position", float3{(float)i, 0, 0}},
+      {"block_name", std::string("block entity with long name ") + std::to_string(i)},
+      {"block_health", i}
+    }}));
+  }
+
+  ecs_details::Archetype *archetype = mgr.archetypeMap.find(mgr.templates[blockTemplate].archetypeId)->second.get();
+  assert(archetype->chunkLayout == ecs::ArchetypeChunkLayout::SingleAllocation);
+  assert(archetype->chunkBlocks.size() == archetype->chunkCount);
+  for (uint32_t i = 0; i < archetype->chunkCount; i++)
+  {
+    const char *block = archetype->chunkBlocks[i];
+    for (const ecs_details::Collumn &collumn : archetype->collumns)
+    {
+      assert(collumn.chunks[i] == block + collumn.chunkOffset);
+      assert(uintptr_t(collumn.chunks[i]) % collumn.containerAlignment == 0);
+      ECS_UNUSED(collumn);
+    }
+    for (const ecs_details::TrackedCollumn &collumn : archetype->trackedCollumns)
+    {
+      assert(collumn.chunks[i] == block + collumn.chunkOffset);
+      ECS_UNUSED(collumn);
+    }
+    ECS_UNUSED(block);
+  }
+
+  for (int i = 0; i < BLOCK_ENTITY_COUNT; i++)
+  {
+    const float3 *position = ecs::get_component<float3>(mgr, eids[i], "block_position");
+    const std::string *name = ecs::get_component<std::string>(mgr, eids[i], "block_name");
+    const int *health = ecs::get_component<int>(mgr, eids[i], "block_health");
+    assert(position && position->x == i);
+    assert(name && *name == std::string("block entity with long name ") + std::to_string(i));
+    assert(health && *health == i);
+    ECS_UNUSED(position);
+    ECS_UNUSED(name);
+    ECS_UNUSED(health);
+  }
+  for (int i = BLOCK_ENTITY_COUNT - 1; i >= 0; i--)
+    ecs::destroy_entity_sync(mgr, eids[i]);
+  assert(archetype->entityCount == 0);
+
+  // empty chunks are returned to the pool and reused by the next entities
+  const ecs::PoolChunkAllocator *pool = static_cast<const ecs::PoolChunkAllocator *>(mgr.chunkAllocator.get());
+  const size_t cachedBytes = pool->cached_bytes();
+  const uint32_t chunkCount = archetype->chunkCount;
+  assert(archetype->release_empty_chunks(1) == 1);
+  assert(archetype->release_empty_chunks() == chunkCount - 1);
+  assert(archetype->chunkCount == 0 && archetype->capacity == 0);
+  assert(pool->cached_bytes() == cachedBytes + chunkCount * archetype->chunkBlockSize);
+  for (int i = 0; i < BLOCK_ENTITY_COUNT; i++)
+    eids[i] = ecs::create_entity_sync(mgr, blockTemplate, {mgr, {{"block_health", i}}});
+  assert(archetype->chunkCount == chunkCount);
+  assert(pool->cached_bytes() == cachedBytes);
+  for (int i = BLOCK_ENTITY_COUNT - 1; i >= 0; i--)
+    ecs::destroy_entity_sync(mgr, eids[i]);
+  ECS_UNUSED(pool);
+  ECS_UNUSED(cachedBytes);
+  ECS_UNUSED(chunkCount);
+  ECS_UNUSED(archetype);
+
+  // freed chunks over the limit go back to the system
+  ecs::PoolChunkAllocator limitedPool;
+  limitedPool.maxCachedBytes = 256;
+  char *first = limitedPool.allocate(256, 64);
+  char *second = limitedPool.allocate(256, 64);
+  limitedPool.deallocate(first, 256, 64);
+  limitedPool.deallocate(second, 256, 64);
+  assert(limitedPool.cached_bytes() == 256);
+  printf("single_allocation_test done\n");
+}
+
+void shrink_test(ecs::EcsManager &mgr)
+{
+  ecs::TemplateInit templateInit;
+  templateInit.name = "shrink_point";
+  templateInit.chunkSizePower = ecs::ArchetypeChunkSize::Dozens;
+  templateInit.args = {mgr, {
+    {ecs::get_or_add_component<int>(mgr, "shrink_health"), 0}
+  }};
+  templateInit.trackedComponents = {"shrink_health"};
+  ecs::TemplateId shrinkTemplate = template_registration(mgr, std::move(templateInit));
+
+  const int SHRINK_ENTITY_COUNT = 200;
+  const int ALIVE_ENTITY_COUNT = 20;
+  std::vector<ecs::EntityId> eids;
+  for (int i = 0; i < SHRINK_ENTITY_COUNT; i++)
+    eids.push_back(ecs::create_entity_sync(mgr, shrinkTemplate, {mgr, {{"shrink_health", i}}}));
+  for (int i = SHRINK_ENTITY_COUNT - 1; i >= ALIVE_ENTITY_COUNT; i--)
+    ecs::destroy_entity_sync(mgr, eids[i]);
+
+  ecs_details::Archetype *archetype = mgr.archetypeMap.find(mgr.templates[shrinkTemplate].archetypeId)->second.get();
+  assert(archetype->chunkCount == SHRINK_ENTITY_COUNT / archetype->chunkSize + 1);
+  assert(archetype->getUsedChunkCount() == 2);
+
+  // stale chunks are not iterated
+  int healthSum = 0;
+  ECS_QUERY() shrink_query(mgr, [&](int shrink_health)
+  {
+    healthSum += shrink_health;
+  });
+  assert(healthSum == ALIVE_ENTITY_COUNT * (ALIVE_ENTITY_COUNT - 1) / 2);
+
+  // zero budget releases at least one chunk
+  assert(ecs::shrink_archetypes(mgr, 0) > 0);
+  while (ecs::shrink_archetypes(mgr, 1000) > 0) {}
+  assert(archetype->chunkCount == 2 && archetype->capacity == 2 * archetype->chunkSize);
+  assert(archetype->trackedCollumns[0].dirtyState.size() == archetype->capacity);
+
+  for (int i = 0; i < ALIVE_ENTITY_COUNT; i++)
+  {
+    const int *health = ecs::get_component<int>(mgr, eids[i], "shrink_health");
+    assert(health && *health == i);
+    ECS_UNUSED(health);
+  }
+  for (int i = ALIVE_ENTITY_COUNT - 1; i >= 0; i--)
+    ecs::destroy_entity_sync(mgr, eids[i]);
+  ECS_UNUSED(archetype);
+  ECS_UNUSED(healthSum);
+  printf("shrink_test done\n");
+}
+
+void relocation_test(ecs::EcsManager &mgr)
+{
+  static_assert(!ecs::is_trivially_relocatable<MovableHandle>::value && ecs::is_trivially_relocatable<float3>::value);
+  assert(mgr.typeMap[ecs::TypeInfo<RelocatableHandle>::typeId]->isTriviallyRelocatable);
+  assert(!mgr.typeMap[ecs::TypeInfo<MovableHandle>::typeId]->isTriviallyRelocatable);
+
+  ecs::TemplateId relocationTemplate = template_registration(mgr, "relocation_point",
+    {mgr, {
+      {ecs::get_or_add_component<RelocatableHandle>(mgr, "relocation_memcpy"), RelocatableHandle{}},
+      {ecs::get_or_add_component<MovableHandle>(mgr, "relocation_move"), MovableHandle{}}
+    }}, ecs::ArchetypeChunkSize::Dozens);
+  const int RELOCATION_ENTITY_COUNT = 4;
+  std::vector<ecs::EntityId> eids;
+  for (int i = 0; i < RELOCATION_ENTITY_COUNT; i++)
+    eids.push_back(ecs::create_entity_sync(mgr, relocationTemplate, {mgr, {{"relocation_memcpy", RelocatableHandle{i}}, {"relocation_move", MovableHandle{i}}}}));
+
+  // the last entity fills the hole
+  RelocatableHandle::moveCount = 0;
+  MovableHandle::moveCount = 0;
+  ecs::destroy_entity_sync(mgr, eids[0]);
+  assert(RelocatableHandle::moveCount == 0 && MovableHandle::moveCount == 1);
+  for (int i = 1; i < RELOCATION_ENTITY_COUNT; i++)
+  {
+    assert(ecs::get_component<RelocatableHandle>(mgr, eids[i], "relocation_memcpy")->value == i);
+    assert(ecs::get_component<MovableHandle>(mgr, eids[i], "relocation_move")->value == i);
+  }
+  eids.erase(eids.begin());
+  ecs::destroy_entities_sync(mgr, eids);
+  printf("relocation_test done\n");
+}
+
+void batch_destroy_test(ecs::EcsManager &mgr)
+{
+  // int collumn is relocated by memcpy, std::string by move constructor
+  assert(mgr.typeMap[ecs::TypeInfo<int>::typeId]->isTriviallyRelocatable && mgr.typeMap[ecs::TypeInfo<int>::typeId]->isTriviallyDestructible);
+  assert(!mgr.typeMap[ecs::TypeInfo<std::string>::typeId]->isTriviallyRelocatable && !mgr.typeMap[ecs::TypeInfo<std::string>::typeId]->isTriviallyDestructible);
+
+  ecs::TemplateId batchTemplate = template_registration(mgr, "batch_point",
+    {mgr, {
+      {ecs::get_or_add_component<int>(mgr, "batch_health"), 0},
+      {ecs::get_or_add_component<std::string>(mgr, "batch_name"), std::string{}}
+    }}, ecs::ArchetypeChunkSize::Dozens);
+
+  const int BATCH_ENTITY_COUNT = 100;
+  // two batches, OnAppear range of the second one starts in the middle of the chunk
+  const int FIRST_BATCH_COUNT = 7;
+  std::vector<ecs::EntityId> eids;
+  for (int batchBegin : {0, FIRST_BATCH_COUNT})
+  {
+    const int batchEnd = batchBegin == 0 ? FIRST_BATCH_COUNT : BATCH_ENTITY_COUNT;
+    std::vector<int> healths;
+    std::vector<std::string> names;
+    for (int i = batchBegin; i < batchEnd; i++)
+    {
+      healths.push_back(i);
+      names.push_back("batch entity with long name " + std::to_string(i));
+    }
+    std::vector<ecs::EntityId> batchEids = ecs::create_entities_sync(mgr, batchTemplate,
+    {{
+      {"batch_health", std::move(healths)},
+      {"batch_name", std::move(names)}
+    }});
+    eids.insert(eids.end(), batchEids.begin(), batchEids.end());
+    assert(batchAppearCount == batchEnd);
+  }
+  assert(batchAppearHealthSum == BATCH_ENTITY_COUNT * (BATCH_ENTITY_COUNT - 1) / 2);
+
+  int destroyedCount = 0;
+  int destroyedHealthSum = 0;
+  for (int i = 0; i < BATCH_ENTITY_COUNT; i += 3)
+  {
+    ecs::destroy_entity(mgr, eids[i]);
+    destroyedCount++;
+    destroyedHealthSum += i;
+  }
+  // the last entities are removed without moving
+  ecs::destroy_entity(mgr, eids[BATCH_ENTITY_COUNT - 2]);
+  destroyedCount++;
+  destroyedHealthSum += BATCH_ENTITY_COUNT - 2;
+  ecs::perform_delayed_entities_creation(mgr);
+  assert(batchDisappearCount == destroyedCount);
+  assert(batchDisappearHealthSum == destroyedHealthSum);
+
+  std::vector<ecs::EntityId> aliveEids;
+  for (int i = 0; i < BATCH_ENTITY_COUNT; i++)
+  {
+    const bool destroyed = i % 3 == 0 || i == BATCH_ENTITY_COUNT - 2;
+    const int *health = ecs::get_component<int>(mgr, eids[i], "batch_health");
+    const std::string *name = ecs::get_component<std::string>(mgr, eids[i], "batch_name");
+    const ecs::EntityId *eid = ecs::get_component<ecs::EntityId>(mgr, eids[i], "eid");
+    assert(destroyed ? health == nullptr : health && *health == i);
+    assert(destroyed ? name == nullptr : name && *name == "batch entity with long name " + std::to_string(i));
+    assert(destroyed ? eid == nullptr : eid && *eid == eids[i]);
+    if (!destroyed)
+      aliveEids.push_back(eids[i]);
+    ECS_UNUSED(health);
+    ECS_UNUSED(name);
+    ECS_UNUSED(eid);
+  }
+
+  ecs::destroy_entities_sync(mgr, aliveEids);
+  assert(batchDisappearCount == BATCH_ENTITY_COUNT);
+  assert(batchDisappearHealthSum == BATCH_ENTITY_COUNT * (BATCH_ENTITY_COUNT - 1) / 2);
+  assert(mgr.archetypeMap.find(mgr.templates[batchTemplate].archetypeId)->second->entityCount == 0);
+  ECS_UNUSED(destroyedCount);
+  ECS_UNUSED(destroyedHealthSum);
+  printf("batch_destroy_test done\n");
+}
+
+void job_test(ecs::EcsManager &mgr, ecs::ComponentId positionId, ecs::ComponentId velocityId)
+{
+  ecs::init_job_scheduler(mgr, 3);
+  ecs::TemplateId jobTemplate = template_registration(mgr, "job_point",
+    {mgr, {
+      {positionId, float3{}},
+      {velocityId, float3{}}
+    }}, ecs::ArchetypeChunkSize::Dozens);
+
+  const int JOB_ENTITY_COUNT = 1000;
+  std::vector<float3> positions(JOB_ENTITY_COUNT);
+  std::vector<float3> velocities(JOB_ENTITY_COUNT);
+  for (int i = 0; i < JOB_ENTITY_COUNT; i++)
+    velocities[i] = float3{1, (float)i, 0};
+
+  ecs::create_entities_sync(mgr, jobTemplate,
+  {{
+    {"job_position", std::move(positions)},
+    {"job_velocity", std::move(velocities)}
+  }});
+
+  const ecs::StageExecutionPlan &plan = mgr.stagePlans[ecs::hash("job_act")];
+  const std::vector<ecs::System> &jobSystems = mgr.systems[ecs::hash("job_act")];
+  assert(plan.waves.size() == 2);
+  assert(plan.waves[0].size() == 2);
+  assert(plan.waves[1].size() == 1);
+  assert(jobSystems[plan.waves[1][0]].name == ecs_details::tiny_string("job_read_position"));
+  ECS_UNUSED(plan);
+  ECS_UNUSED(jobSystems);
+
+  ecs::perform_stage(mgr, "job_act");
+  ecs::perform_stage(mgr, "job_act");
+  assert(jobReadVelocityCount == 2 * JOB_ENTITY_COUNT);
+  assert(jobReadPositionCount == 2 * JOB_ENTITY_COUNT);
+
+  // waves of the plan would reorder serial_read_position, it has no conflicts
+  const std::vector<ecs::System> &serialSystems = mgr.systems[ecs::hash("serial_act")];
+  assert(mgr.stagePlans[ecs::hash("serial_act")].waves.size() == 2);
+  ecs::perform_stage(mgr, "serial_act");
+  assert(serialSystemThreads.size() == 3 * JOB_ENTITY_COUNT);
+  assert(std::all_of(serialSystemThreads.begin(), serialSystemThreads.end(), [](std::thread::id id) { return id == std::this_thread::get_id(); }));
+  assert(serialSystemOrder.size() == serialSystems.size());
+  for (uint32_t i = 0; i < serialSystems.size(); i++)
+    assert(serialSystemOrder[i] == serialSystems[i].name);
+  ECS_UNUSED(serialSystems);
+
+  std::atomic<uint32_t> jobQueryCount = 0;
+  ECS_QUERY(job = true) job_parallel_query(mgr, [&](const float3 &job_position, const float3 &job_velocity)
+  {
+    assert(job_position.x == 2 * job_velocity.x && job_position.y == 2 * job_velocity.y);
+    ECS_UNUSED(job_position);
+    ECS_UNUSED(job_velocity);
+    jobQueryCount++;
+  });
+  assert(jobQueryCount == JOB_ENTITY_COUNT);
+
+  // commands of the chunk job are keyed by the query hash and the job index, like job systems
+  std::mutex jobSourcesMutex;
+  std::set<uint64_t> jobSources;
+  ECS_QUERY(job = true) job_source_query(mgr, [&](const float3 &job_position)
+  {
+    ECS_UNUSED(job_position);
+    std::lock_guard<std::mutex> lock(jobSourcesMutex);
+    jobSources.insert(ecs::CommandScope::current_source());
+  });
+  uint32_t sourceQueryCount = 0;
+  for (const auto &[queryHash, query] : mgr.queries)
+  {
+    if (query.name == ecs_details::tiny_string("job_source_query"))
+    {
+      sourceQueryCount++;
+      std::set<uint64_t> expectedSources;
+      for (uint32_t jobIdx = 0; jobIdx < jobSources.size(); jobIdx++)
+        expectedSources.insert(ecs::CommandScope::job_source(queryHash, jobIdx));
+      assert(jobSources.size() > 1 && jobSources == expectedSources);
+    }
+  }
+  assert(sourceQueryCount == 1);
+  ECS_UNUSED(sourceQueryCount);
+
+  const ecs_details::Archetype *archetype = mgr.archetypeMap.find(mgr.templates[jobTemplate].archetypeId)->second.get();
+  assert(archetype->entityCount == JOB_ENTITY_COUNT);
+  const ecs_details::Collumn &positionCollumn = archetype->collumns[archetype->getComponentCollumnIndex(positionId)];
+  const ecs_details::Collumn &velocityCollumn = archetype->collumns[archetype->getComponentCollumnIndex(velocityId)];
+  for (int i = 0; i < JOB_ENTITY_COUNT; i++)
+  {
+    const float3 &position = *(const float3 *)archetype->getData(positionCollumn, i);
+    const float3 &velocity = *(const float3 *)archetype->getData(velocityCollumn, i);
+    assert(position.x == 2 * velocity.x && position.y == 2 * velocity.y);
+    ECS_UNUSED(position);
+    ECS_UNUSED(velocity);
+  }
+
+  ecs::perform_stage(mgr, "chunk_act");
+  uint32_t chunkQueryCount = 0;
+  ECS_QUERY(chunk = true) chunk_query(mgr, [&](std::span<const float3> job_position, std::span<const float3> job_velocity)
+  {
+    for (size_t i = 0; i < job_position.size(); i++)
+      assert(job_position[i].x == 3 * job_velocity[i].x && job_position[i].y == 3 * job_velocity[i].y);
+    chunkQueryCount += job_position.size();
+  });
+  assert(chunkQueryCount == JOB_ENTITY_COUNT);
+
+  mgr.jobScheduler.reset();
+  printf("job_test done\n");
+}
+
+void command_buffer_test(ecs::EcsManager &mgr)
+{
+  ecs::TemplateId commandTemplate = template_registration(mgr, "command_point",
+    {mgr, {
+      {ecs::get_or_add_component<int>(mgr, "command_health"), 0}
+    }}, ecs::ArchetypeChunkSize::Dozens);
+
+  ecs::init_job_scheduler(mgr, 3);
+  const int COMMAND_ENTITY_COUNT = 64;
+  std::vector<ecs::EntityId> eids(COMMAND_ENTITY_COUNT);
+  std::vector<ecs::EntityId> droppedEids(COMMAND_ENTITY_COUNT);
+  mgr.jobScheduler->parallel_for(COMMAND_ENTITY_COUNT, [&](uint32_t i)
+  {
+    ecs::FlatInitializerList initList;
+    initList.push_back("command_health", int(i));
+    eids[i] = ecs::create_entity_mt(mgr, commandTemplate, std::move(initList));
+    // destruction is applied after creation
+    droppedEids[i] = ecs::create_entity_mt(mgr, commandTemplate);
+    ecs::destroy_entity_mt(mgr, droppedEids[i]);
+  });
+  for (int i = 0; i < COMMAND_ENTITY_COUNT; i++)
+    assert(!mgr.entityContainer.is_alive(eids[i]));
+  ecs::perform_delayed_entities_creation(mgr);
+
+  for (int i = 0; i < COMMAND_ENTITY_COUNT; i++)
+  {
+    const int *health = ecs::get_component<int>(mgr, eids[i], "command_health");
+    assert(health && *health == i);
+    assert(!mgr.entityContainer.is_alive(droppedEids[i]));
+    ECS_UNUSED(health);
+  }
+
+  int expectedEventSum = 0;
+  for (int i = 1; i < COMMAND_ENTITY_COUNT; i += 2)
+    expectedEventSum += i;
+  mgr.jobScheduler->parallel_for(COMMAND_ENTITY_COUNT, [&](uint32_t i)
+  {
+    if (i % 2 == 0)
+      ecs::destroy_entity_mt(mgr, eids[i]);
+    else
+      ecs::send_event_mt(mgr, eids[i], CommandEvent{int(i)});
+  });
+  ecs::perform_delayed_events(mgr);
+  ecs::perform_delayed_entities_creation(mgr);
+  assert(commandEventCount == COMMAND_ENTITY_COUNT / 2);
+  assert(commandEventSum == expectedEventSum);
+
+  std::vector<ecs::EntityId> aliveEids;
+  for (int i = 0; i < COMMAND_ENTITY_COUNT; i++)
+  {
+    assert(mgr.entityContainer.is_alive(eids[i]) == (i % 2 == 1));
+    if (i % 2 == 1)
+      aliveEids.push_back(eids[i]);
+  }
+  ecs::destroy_entities_sync(mgr, aliveEids);
+  mgr.jobScheduler.reset();
+  ECS_UNUSED(expectedEventSum);
+  printf("command_buffer_test done\n");
+}
+
+void deterministic_commands_test(ecs::EcsManager &mgr)
+{
+  ecs::init_job_scheduler(mgr, 3);
+  mgr.deterministicCommands = true;
+  ecs::TemplateId commandTemplate = template_registration(mgr, "deterministic_point",
+    {mgr, {
+      {ecs::get_or_add_component<int>(mgr, "deterministic_value"), 0}
+    }}, ecs::ArchetypeChunkSize::Dozens);
+
+  const int JOB_COUNT = 32;
+  const int ENTITIES_PER_JOB = 3;
+  const uint64_t SOURCE = 42;
+  // expected slot order: jobs sorted by source, entities of one job in recording order
+  std::vector<uint32_t> jobOrder(JOB_COUNT);
+  for (int i = 0; i < JOB_COUNT; i++)
+    jobOrder[i] = i;
+  std::sort(jobOrder.begin(), jobOrder.end(), [&](uint32_t a, uint32_t b)
+  {
+    return ecs::CommandScope::job_source(SOURCE, a) < ecs::CommandScope::job_source(SOURCE, b);
+  });
+  std::vector<int> expectedValues;
+  for (uint32_t job : jobOrder)
+    for (int j = 0; j < ENTITIES_PER_JOB; j++)
+      expectedValues.push_back(job * ENTITIES_PER_JOB + j);
+  const int eidCollumn = mgr.archetypeMap.find(mgr.templates[commandTemplate].archetypeId)->second->getComponentCollumnIndex(mgr.eidComponentId);
+
+  ecs_details::Archetype &archetype = *mgr.archetypeMap.find(mgr.templates[commandTemplate].archetypeId)->second;
+  const int valueCollumn = archetype.getComponentCollumnIndex(ecs::get_component_id(ecs::TypeInfo<int>::typeId, "deterministic_value"));
+  // the third round repeats the history of the first one
+  const uint32_t firstMergeCount = mgr.commandMergeCount;
+  std::vector<std::vector<ecs::EntityId>> provisionalEids;
+  for (int round = 0; round < 3; round++)
+  {
+    if (round == 2)
+      mgr.commandMergeCount = firstMergeCount;
+    std::vector<ecs::EntityId> &eids = provisionalEids.emplace_back(JOB_COUNT * ENTITIES_PER_JOB);
+    mgr.jobScheduler->parallel_for(JOB_COUNT, [&](uint32_t job_idx)
+    {
+      ecs::CommandScope commandScope(ecs::CommandScope::job_source(SOURCE, job_idx));
+      for (int j = 0; j < ENTITIES_PER_JOB; j++)
+      {
+        ecs::FlatInitializerList initList;
+        initList.push_back("deterministic_value", int(job_idx * ENTITIES_PER_JOB + j));
+        eids[job_idx * ENTITIES_PER_JOB + j] = ecs::create_entity_mt(mgr, commandTemplate, std::move(initList));
+      }
+      // provisional id is accepted by *_mt commands
+      ecs::destroy_entity_mt(mgr, ecs::create_entity_mt(mgr, commandTemplate));
+    });
+    assert(!mgr.entityContainer.is_alive(eids[0]));
+    ecs::perform_delayed_entities_creation(mgr);
+
+    // real indices are allocated in slot order, so eid collumn is the same for the same history
+    std::vector<ecs::EntityId> realEids;
+    for (ecs::EntityId eid : eids)
+      realEids.push_back(ecs::resolve_entity(mgr, eid));
+    assert(archetype.entityCount == expectedValues.size());
+    for (uint32_t i = 0; i < archetype.entityCount; i++)
+    {
+      const int value = *(const int *)archetype.getData(archetype.collumns[valueCollumn], i);
+      assert(value == expectedValues[i]);
+      assert(*(const ecs::EntityId *)archetype.getData(archetype.collumns[eidCollumn], i) == realEids[value]);
+      ECS_UNUSED(value);
+    }
+    // provisional ids of the previous merge don't resolve to the new entities
+    if (round == 1)
+    {
+      for (ecs::EntityId eid : provisionalEids[0])
+        assert(ecs::resolve_entity(mgr, eid) == ecs::EntityId());
+    }
+    ecs::destroy_entities_sync(mgr, realEids);
+  }
+  // provisional ids don't depend on the order in which jobs were performed
+  assert(provisionalEids[2] == provisionalEids[0]);
+  assert(provisionalEids[1] != provisionalEids[0]);
+  mgr.deterministicCommands = false;
+  mgr.jobScheduler.reset();
+  ECS_UNUSED(valueCollumn);
+  ECS_UNUSED(eidCollumn);
+  printf("deterministic_commands_test done\n");
+}
+
+void component_transition_test(ecs::EcsManager &mgr)
+{
+  ecs::TemplateId transitionTemplate = template_registration(mgr, "transition_point",
+    {mgr, {
+      {ecs::get_or_add_component<int>(mgr, "transition_health"), 10},
+      {ecs::get_or_add_component<std::string>(mgr, "transition_name"), std::string("transition unit with long name")}
+    }}, ecs::ArchetypeChunkSize::Dozens);
+  const ecs::ArchetypeId sourceArchetypeId = mgr.templates[transitionTemplate].archetypeId;
+  ecs_details::Archetype &sourceArchetype = *mgr.archetypeMap.find(sourceArchetypeId)->second;
+
+  const int TRANSITION_ENTITY_COUNT = 5;
+  std::vector<ecs::EntityId> eids;
+  for (int i = 0; i < TRANSITION_ENTITY_COUNT; i++)
+    eids.push_back(ecs::create_entity_sync(mgr, transitionTemplate, {mgr, {{"transition_health", i}}}));
+
+  const auto count_stunned = [&]()
+  {
+    int stunnedCount = 0;
+    ECS_QUERY() transition_stunned_query(mgr, [&](int transition_stunned, int transition_health)
+    {
+      assert(transition_stunned == transition_health * 100);
+      stunnedCount++;
+    });
+    return stunnedCount;
+  };
+
+  assert(ecs::add_component_sync(mgr, eids[1], "transition_stunned", 100));
+  assert(ecs::add_component_sync(mgr, eids[2], "transition_stunned", 200));
+  // the last entity was moved to the hole of eids[1]
+  assert(sourceArchetype.entityCount == TRANSITION_ENTITY_COUNT - 2);
+  assert(sourceArchetype.addTransitions.size() == 1);
+  ecs_details::Archetype &stunnedArchetype = *sourceArchetype.addTransitions.begin()->second.target;
+  assert(stunnedArchetype.entityCount == 2);
+  assert(count_stunned() == 2);
+  for (int i = 0; i < TRANSITION_ENTITY_COUNT; i++)
+  {
+    const int *health = ecs::get_component<int>(mgr, eids[i], "transition_health");
+    const std::string *name = ecs::get_component<std::string>(mgr, eids[i], "transition_name");
+    const int *stunned = ecs::get_component<int>(mgr, eids[i], "transition_stunned");
+    assert(health && *health == i);
+    assert(name && *name == "transition unit with long name");
+    assert((i == 1 || i == 2) ? stunned && *stunned == i * 100 : stunned == nullptr);
+    ECS_UNUSED(health);
+    ECS_UNUSED(name);
+    ECS_UNUSED(stunned);
+  }
+
+  // existing component is replaced
+  assert(ecs::add_component_sync(mgr, eids[2], "transition_stunned", 200));
+  assert(stunnedArchetype.entityCount == 2);
+
+  // back to the template archetype by the cached edge
+  assert(ecs::remove_component_sync<int>(mgr, eids[1], "transition_stunned"));
+  assert(!ecs::remove_component_sync<int>(mgr, eids[1], "transition_stunned"));
+  assert(stunnedArchetype.removeTransitions.begin()->second.target == &sourceArchetype);
+  assert(ecs::get_component<int>(mgr, eids[1], "transition_stunned") == nullptr);
+  assert(*ecs::get_component<std::string>(mgr, eids[1], "transition_name") == "transition unit with long name");
+
+  // non trivial component is removed
+  assert(ecs::remove_component_sync<std::string>(mgr, eids[0], "transition_name"));
+  assert(ecs::get_component<std::string>(mgr, eids[0], "transition_name") == nullptr);
+  assert(*ecs::get_component<int>(mgr, eids[0], "transition_health") == 0);
+
+  // deferred changes are applied after creation
+  ecs::EntityId asyncEid = ecs::create_entity(mgr, transitionTemplate, {mgr, {{"transition_health", 7}}});
+  ecs::add_component(mgr, asyncEid, "transition_stunned", 700);
+  ecs::add_component(mgr, eids[3], "transition_stunned", 300);
+  ecs::remove_component<int>(mgr, eids[2], "transition_stunned");
+  assert(ecs::get_component<int>(mgr, eids[3], "transition_stunned") == nullptr);
+  ecs::perform_delayed_entities_creation(mgr);
+  assert(*ecs::get_component<int>(mgr, eids[3], "transition_stunned") == 300);
+  assert(*ecs::get_component<int>(mgr, asyncEid, "transition_stunned") == 700);
+  assert(ecs::get_component<int>(mgr, eids[2], "transition_stunned") == nullptr);
+  assert(count_stunned() == 2);
+
+  eids.push_back(asyncEid);
+  for (ecs::EntityId eid : eids)
+  {
+    const ecs::EntityId *storedEid = ecs::get_component<ecs::EntityId>(mgr, eid, "eid");
+    assert(storedEid && *storedEid == eid);
+    ECS_UNUSED(storedEid);
+  }
+  ecs::destroy_entities_sync(mgr, eids);
+  assert(sourceArchetype.entityCount == 0 && stunnedArchetype.entityCount == 0);
+  ECS_UNUSED(stunnedArchetype);
+  printf("component_transition_test done\n");
+}
+
+void changed_filter_test(ecs::EcsManager &mgr)
+{
+  ecs::TemplateId changedTemplate = template_registration(mgr, "changed_point",
+    {mgr, {
+      {ecs::get_or_add_component<int>(mgr, "changed_value"), 0}
+    }}, ecs::ArchetypeChunkSize::Dozens);
+  const int CHUNK_SIZE = 1 << ecs::ArchetypeChunkSize::Dozens;
+  const int CHANGED_ENTITY_COUNT = CHUNK_SIZE * 4;
+  std::vector<ecs::EntityId> eids;
+  for (int i = 0; i < CHANGED_ENTITY_COUNT; i++)
+    eids.push_back(ecs::create_entity_sync(mgr, changedTemplate));
+
+  const auto read_changed = [&]()
+  {
+    changedReadCount = 0;
+    ecs::perform_stage(mgr, "changed_act");
+    return changedReadCount;
+  };
+  // new chunks are changed
+  assert(read_changed() == CHANGED_ENTITY_COUNT);
+  assert(read_changed() == 0);
+
+  // only the chunk of the entity
+  ecs::set_component<int>(mgr, eids[CHUNK_SIZE * 2 + 1], "changed_value", 5);
+  assert(read_changed() == CHUNK_SIZE);
+  assert(read_changed() == 0);
+
+  // query writes every chunk
+  ECS_QUERY() changed_write_query(mgr, [](int &changed_value) { changed_value += 1; });
+  assert(read_changed() == CHANGED_ENTITY_COUNT);
+
+  // new entity starts the fifth chunk, destroyed one is replaced by the last entity of the first chunk
+  eids.push_back(ecs::create_entity_sync(mgr, changedTemplate));
+  assert(read_changed() == 1);
+  ecs::destroy_entity_sync(mgr, eids[0]);
+  eids.erase(eids.begin());
+  assert(read_changed() == CHUNK_SIZE);
+
+  changedSelfCount = 0;
+  ecs::perform_stage(mgr, "changed_self_act");
+  assert(changedSelfCount == CHANGED_ENTITY_COUNT);
+  ecs::perform_stage(mgr, "changed_self_act");
+  assert(changedSelfCount == CHANGED_ENTITY_COUNT);
+  // but they trigger other systems
+  assert(read_changed() == CHANGED_ENTITY_COUNT);
+
+  // versions don't wrap after 32 bits
+  mgr.changeVersion = (uint64_t(1) << 32) - 1;
+  ecs::set_component<int>(mgr, eids[1], "changed_value", 7);
+  assert(read_changed() == CHUNK_SIZE);
+  assert(read_changed() == 0);
+  ecs::set_component<int>(mgr, eids[1], "changed_value", 8);
+  assert(read_changed() == CHUNK_SIZE);
+
+  assert(mgr.stagePlans[ecs::hash("changed_plan_act")].waves.size() == 2);
+
+  ecs::destroy_entities_sync(mgr, eids);
+  ECS_UNUSED(read_changed);
+  ECS_UNUSED(CHANGED_ENTITY_COUNT);
+  printf("changed_filter_test done\n");
+}
+
+void dirty_bitset_test()
+{
+  // chunks of 16 entities, 4 chunks per word
+  ecs_details::DirtyBitset bitset(4);
+  bitset.resize(200);
+  bitset.set(3);
+  bitset.set(64);
+  bitset.set(130);
+  bitset.set(199);
+  assert(bitset.test_chunk(0) && !bitset.test_chunk(1) && bitset.test_chunk(4) && bitset.test_chunk(12));
+  std::vector<uint32_t> setBits;
+  bitset.for_each_set(3, 131, [&](uint32_t index) { setBits.push_back(index); });
+  assert((setBits == std::vector<uint32_t>{3, 64, 130}));
+  bitset.assign(64, false);
+  assert(!bitset.test(64) && bitset.test(3));
+
+  // bits after the shrink are clean after grow
+  bitset.resize(150);
+  bitset.resize(200);
+  assert(!bitset.test(199) && bitset.test(130));
+
+  bitset.clear();
+  setBits.clear();
+  bitset.for_each_set(0, bitset.size(), [&](uint32_t index) { setBits.push_back(index); });
+  assert(setBits.empty() && !bitset.test_chunk(0));
+  printf("dirty_bitset_test done\n");
+}
+
+void track_test(ecs::EcsManager &mgr)
+{
+  ecs::TemplateInit templateInit;
+  templateInit.name = "track_point";
+  templateInit.chunkSizePower = ecs::ArchetypeChunkSize::Dozens;
+  templateInit.args = {mgr, {
+    {ecs::get_or_add_component<int>(mgr, "track_value"), 0},
+    {ecs::get_or_add_component<std::string>(mgr, "track_label"), std::string("label")}
+  }};
+  templateInit.trackedComponents = {"track_value", "track_label"};
+  ecs::TemplateId trackTemplate = template_registration(mgr, std::move(templateInit));
+  // chunk memcmp path is taken by unique scalars and opted in types only
+  assert(mgr.typeMap[ecs::TypeInfo<int>::typeId]->isBitwiseComparable);
+  assert(mgr.typeMap[ecs::TypeInfo<float3>::typeId]->isBitwiseComparable);
+  assert(!mgr.typeMap[ecs::TypeInfo<std::string>::typeId]->isBitwiseComparable);
+
+  // several chunks are compared in parallel
+  ecs::init_job_scheduler(mgr, 3);
+  const int TRACK_ENTITY_COUNT = 100;
+  std::vector<ecs::EntityId> eids;
+  for (int i = 0; i < TRACK_ENTITY_COUNT; i++)
+    eids.push_back(ecs::create_entity_sync(mgr, trackTemplate));
+
+  ecs::track_changes(mgr);
+  assert(trackValueCount == 0 && trackLabelCount == 0);
+
+  int expectedValueCount = 0, expectedValueSum = 0, expectedLabelCount = 0;
+  for (int i = 0; i < TRACK_ENTITY_COUNT; i++)
+  {
+    if (i % 3 == 0)
+    {
+      ecs::set_component<int>(mgr, eids[i], "track_value", i + 1);
+      expectedValueCount++;
+      expectedValueSum += i + 1;
+    }
+    else if (i % 3 == 1)
+    {
+      // dirty, but not changed
+      ecs::set_component<int>(mgr, eids[i], "track_value", 0);
+    }
+    if (i % 10 == 0)
+    {
+      ecs::set_component<std::string>(mgr, eids[i], "track_label", std::string("changed label"));
+      expectedLabelCount++;
+    }
+  }
+  ecs::track_changes(mgr);
+  assert(trackValueCount == expectedValueCount && trackValueSum == expectedValueSum);
+  assert(trackLabelCount == expectedLabelCount);
+
+  // old values are updated, so the next frame has no changes
+  ecs::set_component<int>(mgr, eids[0], "track_value", 1);
+  ecs::track_changes(mgr);
+  assert(trackValueCount == expectedValueCount && trackLabelCount == expectedLabelCount);
+
+  // query marks the whole collumn dirty
+  ECS_QUERY() track_write_query(mgr, [&](int &track_value)
+  {
+    if (track_value == 0)
+      track_value = -1;
+  });
+  ecs::track_changes(mgr);
+  const int zeroValueCount = TRACK_ENTITY_COUNT - expectedValueCount;
+  assert(trackValueCount == expectedValueCount + zeroValueCount);
+  assert(trackValueSum == expectedValueSum - zeroValueCount);
+  ECS_UNUSED(zeroValueCount);
+
+  ecs::destroy_entities_sync(mgr, eids);
+  mgr.jobScheduler.reset();
+  ECS_UNUSED(expectedValueCount);
+  ECS_UNUSED(expectedValueSum);
+  ECS_UNUSED(expectedLabelCount);
+  printf("track_test done\n");
+}
+
+static int trackBlockCount = 0;
+static int trackInventoryCount = 0;
+
+ECS_EVENT(track=BigBlock track_block)
+track_block_changed(const ecs::OnTrack &, const BigBlock &track_block)
+{
+  assert(track_block.values[15] != 0);
+  trackBlockCount++;
+}
+
+ECS_EVENT(track=Inventory track_inventory)
+track_inventory_changed(const ecs::OnTrack &, const Inventory &track_inventory)
+{
+  assert(!track_inventory.empty());
+  trackInventoryCount++;
+}
+
+void digest_track_test(ecs::EcsManager &mgr)
+{
+  ecs::TemplateInit templateInit;
+  templateInit.name = "track_block";
+  templateInit.args = {mgr, {
+    {ecs::get_or_add_component<BigBlock>(mgr, "track_block"), BigBlock{}},
+    {ecs::get_or_add_component<Inventory>(mgr, "track_inventory"), Inventory{}}
+  }};
+  templateInit.trackedComponents = {"track_block", "track_inventory"};
+  ecs::TemplateId blockTemplate = template_registration(mgr, std::move(templateInit));
+
+  std::vector<ecs::EntityId> eids;
+  for (int i = 0; i < 10; i++)
+    eids.push_back(ecs::create_entity_sync(mgr, blockTemplate));
+
+  const ecs_details::Archetype *archetype = mgr.archetypeMap.find(mgr.templates[blockTemplate].archetypeId)->second.get();
+  assert(archetype->trackedCollumns.size() == 2u);
+  for (const ecs_details::TrackedCollumn &trackedCollumn : archetype->trackedCollumns)
+  {
+    assert(trackedCollumn.isDigest);
+    assert(trackedCollumn.typeDeclaration->sizeOfElement == sizeof(uint64_t));
+    ECS_UNUSED(trackedCollumn);
+  }
+  ECS_UNUSED(archetype);
+  // other types are tracked by copy
+  static_assert(!ecs::track_by_digest<float3>::value);
+
+  ecs::track_changes(mgr);
+  assert(trackBlockCount == 0);
+
+  BigBlock block{};
+  block.values[15] = 1;
+  ecs::set_component<BigBlock>(mgr, eids[2], "track_block", block);
+  ecs::set_component<BigBlock>(mgr, eids[5], "track_block", block);
+  // dirty, but not changed
+  ecs::set_component<BigBlock>(mgr, eids[7], "track_block", BigBlock{});
+  ecs::track_changes(mgr);
+  assert(trackBlockCount == 2);
+
+  ecs::set_component<BigBlock>(mgr, eids[2], "track_block", block);
+  ecs::track_changes(mgr);
+  assert(trackBlockCount == 2);
+
+  ecs::set_component<Inventory>(mgr, eids[3], "track_inventory", Inventory{1, 2, 3});
+  ecs::set_component<Inventory>(mgr, eids[4], "track_inventory", Inventory{});
+  ecs::track_changes(mgr);
+  assert(trackInventoryCount == 1);
+  // the same items in the other order
+  ecs::set_component<Inventory>(mgr, eids[3], "track_inventory", Inventory{3, 2, 1});
+  ecs::track_changes(mgr);
+  assert(trackInventoryCount == 2);
+  ecs::set_component<Inventory>(mgr, eids[3], "track_inventory", Inventory{3, 2, 1});
+  ecs::track_changes(mgr);
+  assert(trackInventoryCount == 2);
+
+  ecs::destroy_entities_sync(mgr, eids);
+  printf("digest_track_test done\n");
+}
+
+void component_mask_test(ecs::EcsManager &mgr)
+{
+  ecs_details::ComponentMask wide, narrow, far;
+  wide.set(3);
+  wide.set(70);
+  narrow.set(3);
+  far.set(130);
+  assert(wide.contains(narrow) && !narrow.contains(wide));
+  assert(wide.contains(ecs_details::ComponentMask()));
+  assert(wide.intersects(narrow) && narrow.intersects(wide));
+  assert(!wide.intersects(far) && !wide.contains(far));
+  assert(wide.test(70) && !wide.test(71) && !narrow.test(70));
+
+  ecs::ComponentId first = ecs::get_or_add_component(mgr, ecs::TypeInfo<int>::typeId, "mask_first");
+  ecs::ComponentId second = ecs::get_or_add_component(mgr, ecs::TypeInfo<int>::typeId, "mask_second");
+  assert(mgr.componentMap[second]->denseIndex == mgr.componentMap[first]->denseIndex + 1);
+  assert(mgr.componentMap[mgr.eidComponentId]->denseIndex == 0);
+
+  ecs::TemplateId maskTemplate = template_registration(mgr, "mask_unit", {mgr, {{first, 1}, {second, 2}}}, ecs::ArchetypeChunkSize::Dozens);
+  const ecs_details::Archetype &maskArchetype = *mgr.archetypeMap.find(mgr.templates[maskTemplate].archetypeId)->second;
+  assert(maskArchetype.componentMask.test(mgr.componentMap[first]->denseIndex));
+  assert(maskArchetype.componentMask.test(mgr.componentMap[second]->denseIndex));
+  assert(maskArchetype.componentMask.test(0));
+  ECS_UNUSED(maskArchetype);
+  ECS_UNUSED(far);
+  printf("component_mask_test done\n");
+}
+
+void tag_test(ecs::EcsManager &mgr)
+{
+  ecs::TemplateId enemyTemplate = template_registration(mgr, "tag_enemy_unit",
+    {mgr, {
+      {ecs::get_or_add_component<EnemyTag>(mgr, "tag_enemy"), EnemyTag{}},
+      {ecs::get_or_add_component<int>(mgr, "tag_health"), 10}
+    }}, ecs::ArchetypeChunkSize::Dozens);
+  ecs::TemplateId plainTemplate = template_registration(mgr, "tag_plain_unit",
+    {mgr, {
+      {ecs::get_or_add_component<int>(mgr, "tag_health"), 20}
+    }}, ecs::ArchetypeChunkSize::Dozens);
+  ecs_details::Archetype &enemyArchetype = *mgr.archetypeMap.find(mgr.templates[enemyTemplate].archetypeId)->second;
+  // eid, tag_enemy and tag_health, but only eid and tag_health are stored
+  assert(enemyArchetype.type.size() == 3);
+  assert(enemyArchetype.collumns.size() == 2);
+  assert(enemyArchetype.hasComponent(ecs::get_component_id(ecs::TypeInfo<EnemyTag>::typeId, "tag_enemy")));
+  assert(enemyArchetype.getComponentCollumnIndex(ecs::get_component_id(ecs::TypeInfo<EnemyTag>::typeId, "tag_enemy")) == -1);
+  ECS_UNUSED(enemyArchetype);
+
+  std::vector<ecs::EntityId> eids;
+  for (int i = 0; i < 3; i++)
+    eids.push_back(ecs::create_entity_sync(mgr, enemyTemplate, {mgr, {{"tag_health", i}}}));
+  ecs::EntityId plainEid = ecs::create_entity_sync(mgr, plainTemplate);
+  eids.push_back(plainEid);
+
+  const auto count_enemies = [&]()
+  {
+    int enemyCount = 0, plainCount = 0, taggedArgCount = 0;
+    ECS_QUERY(require=EnemyTag tag_enemy) tag_enemy_query(mgr, [&](int tag_health)
+    {
+      ECS_UNUSED(tag_health);
+      enemyCount++;
+    });
+    ECS_QUERY(require_not=EnemyTag tag_enemy) tag_plain_query(mgr, [&](int tag_health)
+    {
+      ECS_UNUSED(tag_health);
+      plainCount++;
+    });
+    ECS_QUERY() tag_optional_query(mgr, [&](int tag_health, const EnemyTag *tag_enemy)
+    {
+      ECS_UNUSED(tag_health);
+      if (tag_enemy)
+        taggedArgCount++;
+    });
+    assert(enemyCount == taggedArgCount);
+    ECS_UNUSED(plainCount);
+    return std::make_pair(enemyCount, plainCount);
+  };
+  assert(count_enemies() == std::make_pair(3, 1));
+  assert(!ecs::has_component<EnemyTag>(mgr, plainEid, "tag_enemy"));
+
+  // tag moves entity to the archetype without new collumn
+  assert(ecs::add_component_sync(mgr, plainEid, "tag_enemy", EnemyTag{}));
+  assert(ecs::has_component<EnemyTag>(mgr, plainEid, "tag_enemy"));
+  assert(ecs::add_component_sync(mgr, plainEid, "tag_enemy", EnemyTag{}));
+  assert(*ecs::get_component<int>(mgr, plainEid, "tag_health") == 20);
+  assert(count_enemies() == std::make_pair(4, 0));
+
+  assert(ecs::remove_component_sync<EnemyTag>(mgr, eids[0], "tag_enemy"));
+  assert(!ecs::has_component<EnemyTag>(mgr, eids[0], "tag_enemy"));
+  assert(*ecs::get_component<int>(mgr, eids[0], "tag_health") == 0);
+  assert(count_enemies() == std::make_pair(3, 1));
+
+  ecs::destroy_entities_sync(mgr, eids);
+  assert(count_enemies() == std::make_pair(0, 0));
+  printf("tag_test done\n");
+}
+
+void entity_lookup_test(ecs::EcsManager &mgr)
+{
+  ecs::TemplateId lookupTemplate = template_registration(mgr, "lookup_unit",
+    {mgr, {
+      {ecs::get_or_add_component<int>(mgr, "lookup_health"), 5}
+    }}, ecs::ArchetypeChunkSize::Dozens);
+  const ecs_details::Archetype *lookupArchetype = mgr.archetypeMap.find(mgr.templates[lookupTemplate].archetypeId)->second.get();
+  ecs::EntityId eid = ecs::create_entity_sync(mgr, lookupTemplate);
+  assert(mgr.entityContainer.entityRecords[eid.entityIndex].archetype == lookupArchetype);
+
+  // component registered after the archetype is out of its dense collumn array
+  const ecs::ComponentId lateId = ecs::get_or_add_component<float3>(mgr, "lookup_late_position");
+  assert(lookupArchetype->getDenseCollumnIndex(mgr.componentMap.find(lateId)->second->denseIndex) == -1);
+  assert(ecs::get_component<float3>(mgr, eid, "lookup_late_position") == nullptr);
+  assert(!ecs::has_component<float3>(mgr, eid, "lookup_late_position"));
+  assert(!ecs::has_component<float3>(mgr, eid, "lookup_unknown"));
+  ECS_UNUSED(lookupArchetype);
+  ECS_UNUSED(lateId);
+
+  assert(ecs::add_component_sync(mgr, eid, "lookup_late_position", float3{1, 2, 3}));
+  const ecs_details::Archetype *movedArchetype = mgr.entityContainer.entityRecords[eid.entityIndex].archetype;
+  assert(movedArchetype != lookupArchetype && movedArchetype->hasComponent(lateId));
+  assert(ecs::get_component<float3>(mgr, eid, "lookup_late_position")->y == 2);
+  assert(*ecs::get_component<int>(mgr, eid, "lookup_health") == 5);
+  assert(ecs::has_component<float3>(mgr, eid, "lookup_late_position"));
+  ECS_UNUSED(movedArchetype);
+
+  // handles skip the component map, unregistered ones are resolved on access
+  const ecs::ComponentHandle healthHandle = ecs::get_component_handle<int>(mgr, "lookup_health");
+  const ecs::ComponentHandle positionHandle = ecs::get_component_handle<float3>(mgr, "lookup_late_position");
+  const ecs::ComponentHandle armorHandle = ecs::get_component_handle<int>(mgr, "lookup_armor");
+  assert(healthHandle.denseIndex != UINT32_MAX && armorHandle.denseIndex == UINT32_MAX);
+  assert(*ecs::get_component<int>(mgr, eid, healthHandle) == 5);
+  assert(ecs::set_component(mgr, eid, positionHandle, float3{4, 5, 6}));
+  assert(ecs::get_component<float3>(mgr, eid, positionHandle)->z == 6);
+  assert(ecs::get_component<int>(mgr, eid, armorHandle) == nullptr && !ecs::has_component(mgr, eid, armorHandle));
+  assert(ecs::add_component_sync(mgr, eid, "lookup_armor", 7));
+  assert(*ecs::get_component<int>(mgr, eid, armorHandle) == 7 && ecs::has_component(mgr, eid, armorHandle));
+
+  // archetype dispatch table keeps the handlers matching the archetype in mgr.eventIdToHandlers order
+  const ecs_details::Archetype *armorArchetype = mgr.entityContainer.entityRecords[eid.entityIndex].archetype;
+  const ecs::EventId updateEventId = ecs::EventInfo<UpdateEvent>::eventId;
+  std::vector<const ecs::EventHandler *> matchedHandlers;
+  for (ecs::NameHash handlerId : mgr.eventIdToHandlers[updateEventId])
+  {
+    const ecs::EventHandler &handler = mgr.events.find(handlerId)->second;
+    if (handler.find_archetype(armorArchetype->archetypeId) != -1)
+      matchedHandlers.push_back(&handler);
+  }
+  std::span<const ecs_details::ArchetypeEventHandler> tableHandlers = armorArchetype->getEventHandlers(updateEventId);
+  assert(!matchedHandlers.empty() && tableHandlers.size() == matchedHandlers.size());
+  for (uint32_t i = 0; i < tableHandlers.size(); i++)
+  {
+    assert(tableHandlers[i].handler == matchedHandlers[i]);
+    assert(tableHandlers[i].handler->archetypes[tableHandlers[i].archetypeIdx].archetype == armorArchetype);
+  }
+  ECS_UNUSED(healthHandle);
+  ECS_UNUSED(positionHandle);
+  ECS_UNUSED(armorHandle);
+  ECS_UNUSED(tableHandlers);
+
+  ecs::destroy_entity_sync(mgr, eid);
+  assert(ecs::get_component<int>(mgr, eid, "lookup_health") == nullptr);
+  assert(ecs::get_component<int>(mgr, eid, healthHandle) == nullptr);
+  printf("entity_lookup_test done\n");
+}
+
+void recipe_test(ecs::EcsManager &mgr)
+{
+  ecs::TemplateInit templateInit;
+  templateInit.name = "recipe_point";
+  templateInit.chunkSizePower = ecs::ArchetypeChunkSize::Dozens;
+  templateInit.args = {mgr, {
+    {ecs::get_or_add_component<int>(mgr, "recipe_health"), 100},
+    {ecs::get_or_add_component<std::string>(mgr, "recipe_name"), std::string("default recipe name")},
+    {ecs::get_or_add_component<float3>(mgr, "recipe_position"), float3{1, 2, 3}}
+  }};
+  templateInit.trackedComponents = {"recipe_health"};
+  templateInit.overrideSlots = {"recipe_name", "recipe_health"};
+  ecs::TemplateId recipeTemplate = template_registration(mgr, std::move(templateInit));
+
+  const ecs::Template &templateRecord = mgr.templates[recipeTemplate];
+  const ecs_details::Archetype *archetype = mgr.archetypeMap.find(templateRecord.archetypeId)->second.get();
+  assert(templateRecord.recipe.size() == archetype->collumns.size());
+  assert(templateRecord.overrideSlotCount == 2);
+  assert(templateRecord.recipe[archetype->getComponentCollumnIndex(mgr.eidComponentId)].source == ecs_details::ComponentRecipe::Source::EntityId);
+  ECS_UNUSED(archetype);
+
+  const int RECIPE_ENTITY_COUNT = 50;
+  std::vector<ecs::EntityId> eids;
+  for (int i = 0; i < RECIPE_ENTITY_COUNT; i++)
+  {
+    if (i % 2 == 0)
+    {
+      ecs::Any overrides[] = {ecs::make_override(std::string("recipe entity with long name ") + std::to_string(i)), ecs::make_override(i)};
+      eids.push_back(ecs::create_entity_sync(mgr, recipeTemplate, overrides));
+    }
+    else
+    {
+      // hash map overrides use the same recipe
+      eids.push_back(ecs::create_entity_sync(mgr, recipeTemplate, {mgr, {{"recipe_health", i}}}));
+    }
+  }
+  for (int i = 0; i < RECIPE_ENTITY_COUNT; i++)
+  {
+    const int *health = ecs::get_component<int>(mgr, eids[i], "recipe_health");
+    const std::string *name = ecs::get_component<std::string>(mgr, eids[i], "recipe_name");
+    const float3 *position = ecs::get_component<float3>(mgr, eids[i], "recipe_position");
+    const ecs::EntityId *eid = ecs::get_component<ecs::EntityId>(mgr, eids[i], "eid");
+    assert(health && *health == i);
+    assert(name && *name == (i % 2 == 0 ? "recipe entity with long name " + std::to_string(i) : std::string("default recipe name")));
+    assert(position && *position == (float3{1, 2, 3}));
+    assert(eid && *eid == eids[i]);
+    ECS_UNUSED(health);
+    ECS_UNUSED(name);
+    ECS_UNUSED(position);
+    ECS_UNUSED(eid);
+  }
+  ecs::destroy_entities_sync(mgr, eids);
+  printf("recipe_test done\n");
+}
+
+void flat_initializer_test(ecs::EcsManager &mgr)
+{
+  ecs::TemplateId flatTemplate = template_registration(mgr, "flat_point",
+    {mgr, {
+      {ecs::get_or_add_component<int>(mgr, "flat_health"), 100},
+      {ecs::get_or_add_component<std::string>(mgr, "flat_name"), std::string("default flat name")},
+      {ecs::get_or_add_component<float3>(mgr, "flat_position"), float3{}}
+    }}, ecs::ArchetypeChunkSize::Dozens);
+
+  const int FLAT_ENTITY_COUNT = 40;
+  std::vector<ecs::EntityId> eids;
+  for (int i = 0; i < FLAT_ENTITY_COUNT; i++)
+  {
+    ecs::FlatInitializerList initList;
+    initList.push_back("flat_name", "flat entity with long name " + std::to_string(i));
+    initList.push_back("flat_health", i);
+    if (i % 4 == 0)
+    {
+      // components out of template are ignored, they make list to grow out of inline storage
+      for (int j = 0; j < 16; j++)
+        initList.push_back(("flat_unused_" + std::to_string(j)).c_str(), std::string(64, 'x'));
+      // second value for the same component replaces the first one
+      initList.push_back("flat_health", i * 10);
+    }
+    assert(initList.size() == (i % 4 == 0 ? 18u : 2u));
+    eids.push_back(i % 2 == 0 ? ecs::create_entity_sync(mgr, flatTemplate, std::move(initList)) : ecs::create_entity(mgr, flatTemplate, std::move(initList)));
+    assert(initList.empty());
+  }
+  ecs::perform_delayed_entities_creation(mgr);
+
+  for (int i = 0; i < FLAT_ENTITY_COUNT; i++)
+  {
+    const int *health = ecs::get_component<int>(mgr, eids[i], "flat_health");
+    const std::string *name = ecs::get_component<std::string>(mgr, eids[i], "flat_name");
+    const ecs::EntityId *eid = ecs::get_component<ecs::EntityId>(mgr, eids[i], "eid");
+    assert(health && *health == (i % 4 == 0 ? i * 10 : i));
+    assert(name && *name == "flat entity with long name " + std::to_string(i));
+    assert(eid && *eid == eids[i]);
+    ECS_UNUSED(health);
+    ECS_UNUSED(name);
+    ECS_UNUSED(eid);
+  }
+  ecs::destroy_entities_sync(mgr, eids);
+
+  // async creations with both initializer lists keep the order of calls
+  eids.clear();
+  for (int i = 0; i < 6; i++)
+  {
+    if (i % 3 == 0)
+    {
+      eids.push_back(ecs::create_entity(mgr, flatTemplate, {mgr, {{"flat_health", i}}}));
+    }
+    else
+    {
+      ecs::FlatInitializerList initList;
+      initList.push_back("flat_health", i);
+      eids.push_back(ecs::create_entity(mgr, flatTemplate, std::move(initList)));
+    }
+  }
+  ecs::perform_delayed_entities_creation(mgr);
+  for (int i = 1; i < 6; i++)
+  {
+    assert(mgr.entityContainer.entityRecords[eids[i].entityIndex].componentIndex ==
+      mgr.entityContainer.entityRecords[eids[i - 1].entityIndex].componentIndex + 1);
+    assert(*ecs::get_component<int>(mgr, eids[i], "flat_health") == i);
+  }
+  ecs::destroy_entities_sync(mgr, eids);
+  printf("flat_initializer_test done\n");
+}
+
 int main()
 {
   const bool EntityContainerTest = true;
@@ -158,7 +1565,7 @@ int main()
 
   for (const auto &[id, type] : mgr.typeMap)
   {
-    printf("[ECS] type: %s, typeId: %x\n", type.typeName.c_str(), type.typeId);
+    printf("[ECS] type: %s, typeId: %x\n", type->typeName.c_str(), type->typeId);
   }
 
   ecs::ComponentId positionId = ecs::get_or_add_component<float3>(mgr, "position");
@@ -423,6 +1830,26 @@ int main()
 
   ecs::track_changes(mgr);
 
+  soa_test(mgr);
+  single_allocation_test(mgr);
+  shrink_test(mgr);
+  relocation_test(mgr);
+  batch_destroy_test(mgr);
+  recipe_test(mgr);
+  flat_initializer_test(mgr);
+  component_transition_test(mgr);
+  tag_test(mgr);
+  entity_lookup_test(mgr);
+  component_mask_test(mgr);
+  dirty_bitset_test();
+  changed_filter_test(mgr);
+  track_test(mgr);
+  digest_track_test(mgr);
+
+  job_test(mgr, ecs::get_or_add_component<float3>(mgr, "job_position"), ecs::get_or_add_component<float3>(mgr, "job_velocity"));
+  command_buffer_test(mgr);
+  deterministic_commands_test(mgr);
+
   ecs::destroy_entities(mgr);
 
   return 0;
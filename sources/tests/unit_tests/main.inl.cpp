@@ -2,6 +2,36 @@
 template<typename Callable>
 static void print_name_query(ecs::EcsManager &mgr, Callable &&query_function);
 
+template<typename Callable>
+static void shrink_query(ecs::EcsManager &mgr, Callable &&query_function);
+
+template<typename Callable>
+static void job_parallel_query(ecs::EcsManager &mgr, Callable &&query_function);
+
+template<typename Callable>
+static void job_source_query(ecs::EcsManager &mgr, Callable &&query_function);
+
+template<typename Callable>
+static void chunk_query(ecs::EcsManager &mgr, Callable &&query_function);
+
+template<typename Callable>
+static void transition_stunned_query(ecs::EcsManager &mgr, Callable &&query_function);
+
+template<typename Callable>
+static void changed_write_query(ecs::EcsManager &mgr, Callable &&query_function);
+
+template<typename Callable>
+static void track_write_query(ecs::EcsManager &mgr, Callable &&query_function);
+
+template<typename Callable>
+static void tag_enemy_query(ecs::EcsManager &mgr, Callable &&query_function);
+
+template<typename Callable>
+static void tag_plain_query(ecs::EcsManager &mgr, Callable &&query_function);
+
+template<typename Callable>
+static void tag_optional_query(ecs::EcsManager &mgr, Callable &&query_function);
+
 template<typename Callable>
 static void print_name_by_eid_query(ecs::EcsManager &mgr, ecs::EntityId eid, Callable &&query_function);
 
@@ -11,160 +41,630 @@ static void print_name_by_eid_query(ecs::EcsManager &mgr, ecs::EntityId eid, Cal
 template<typename Callable>
 static void print_name_query(ecs::EcsManager &mgr, Callable &&query_function)
 {
-  constexpr ecs::NameHash queryHash = ecs::hash("sources/tests/unit_tests/main.inl:39[print_name_query]");
+  constexpr ecs::NameHash queryHash = ecs::hash("sources/tests/unit_tests/main.inl:46[print_name_query]");
   const int N = 2;
   ecs_details::query_iteration<N, ecs_details::Ptr<const std::string>, ecs_details::PrtWrapper<int>>(mgr, queryHash, std::move(query_function));
 }
 
+template<typename Callable>
+static void shrink_query(ecs::EcsManager &mgr, Callable &&query_function)
+{
+  constexpr ecs::NameHash queryHash = ecs::hash("sources/tests/unit_tests/main.inl:537[shrink_query]");
+  const int N = 1;
+  ecs_details::query_iteration<N, ecs_details::Ptr<int>>(mgr, queryHash, std::move(query_function));
+}
+
+template<typename Callable>
+static void job_parallel_query(ecs::EcsManager &mgr, Callable &&query_function)
+{
+  constexpr ecs::NameHash queryHash = ecs::hash("sources/tests/unit_tests/main.inl:718[job_parallel_query]");
+  const int N = 2;
+  ecs_details::query_parallel_iteration<N, ecs_details::Ptr<const float3>, ecs_details::Ptr<const float3>>(mgr, queryHash, std::move(query_function));
+}
+
+template<typename Callable>
+static void job_source_query(ecs::EcsManager &mgr, Callable &&query_function)
+{
+  constexpr ecs::NameHash queryHash = ecs::hash("sources/tests/unit_tests/main.inl:730[job_source_query]");
+  const int N = 1;
+  ecs_details::query_parallel_iteration<N, ecs_details::Ptr<const float3>>(mgr, queryHash, std::move(query_function));
+}
+
+template<typename Callable>
+static void chunk_query(ecs::EcsManager &mgr, Callable &&query_function)
+{
+  constexpr ecs::NameHash queryHash = ecs::hash("sources/tests/unit_tests/main.inl:766[chunk_query]");
+  const int N = 2;
+  ecs_details::query_chunks_iteration<N, const float3, const float3>(mgr, queryHash, std::move(query_function));
+}
+
+template<typename Callable>
+static void transition_stunned_query(ecs::EcsManager &mgr, Callable &&query_function)
+{
+  constexpr ecs::NameHash queryHash = ecs::hash("sources/tests/unit_tests/main.inl:937[transition_stunned_query]");
+  const int N = 2;
+  ecs_details::query_iteration<N, ecs_details::Ptr<int>, ecs_details::Ptr<int>>(mgr, queryHash, std::move(query_function));
+}
+
+template<typename Callable>
+static void changed_write_query(ecs::EcsManager &mgr, Callable &&query_function)
+{
+  constexpr ecs::NameHash queryHash = ecs::hash("sources/tests/unit_tests/main.inl:1035[changed_write_query]");
+  const int N = 1;
+  ecs_details::query_iteration<N, ecs_details::Ptr<int>>(mgr, queryHash, std::move(query_function));
+}
+
+template<typename Callable>
+static void track_write_query(ecs::EcsManager &mgr, Callable &&query_function)
+{
+  constexpr ecs::NameHash queryHash = ecs::hash("sources/tests/unit_tests/main.inl:1153[track_write_query]");
+  const int N = 1;
+  ecs_details::query_iteration<N, ecs_details::Ptr<int>>(mgr, queryHash, std::move(query_function));
+}
+
+template<typename Callable>
+static void tag_enemy_query(ecs::EcsManager &mgr, Callable &&query_function)
+{
+  constexpr ecs::NameHash queryHash = ecs::hash("sources/tests/unit_tests/main.inl:1304[tag_enemy_query]");
+  const int N = 1;
+  ecs_details::query_iteration<N, ecs_details::Ptr<int>>(mgr, queryHash, std::move(query_function));
+}
+
+template<typename Callable>
+static void tag_plain_query(ecs::EcsManager &mgr, Callable &&query_function)
+{
+  constexpr ecs::NameHash queryHash = ecs::hash("sources/tests/unit_tests/main.inl:1309[tag_plain_query]");
+  const int N = 1;
+  ecs_details::query_iteration<N, ecs_details::Ptr<int>>(mgr, queryHash, std::move(query_function));
+}
+
+template<typename Callable>
+static void tag_optional_query(ecs::EcsManager &mgr, Callable &&query_function)
+{
+  constexpr ecs::NameHash queryHash = ecs::hash("sources/tests/unit_tests/main.inl:1314[tag_optional_query]");
+  const int N = 2;
+  ecs_details::query_iteration<N, ecs_details::Ptr<int>, ecs_details::PrtWrapper<const EnemyTag>>(mgr, queryHash, std::move(query_function));
+}
+
 template<typename Callable>
 static void print_name_by_eid_query(ecs::EcsManager &mgr, ecs::EntityId eid, Callable &&query_function)
 {
-  constexpr ecs::NameHash queryHash = ecs::hash("sources/tests/unit_tests/main.inl:49[print_name_by_eid_query]");
+  constexpr ecs::NameHash queryHash = ecs::hash("sources/tests/unit_tests/main.inl:56[print_name_by_eid_query]");
   const int N = 2;
   ecs_details::query_invoke_for_entity<N, ecs_details::Ptr<const std::string>, ecs_details::PrtWrapper<int>>(mgr, eid, queryHash, std::move(query_function));
 }
 
-static void editor_update_implementation(ecs_details::Archetype &archetype, const ecs::ToComponentMap &to_archetype_component)
+static void editor_update_implementation(ecs_details::Archetype &archetype, ecs::ToComponentMap to_archetype_component, uint32_t chunk_begin, uint32_t chunk_end)
 {
   const int N = 3;
-  ecs_details::query_archetype_iteration<N, ecs_details::Ptr<ecs::EntityId>, ecs_details::Ptr<float3>, ecs_details::Ptr<const float3>>(archetype, to_archetype_component, editor_update, std::make_index_sequence<N>());
+  ecs_details::query_archetype_iteration<N, ecs_details::Ptr<ecs::EntityId>, ecs_details::Ptr<float3>, ecs_details::Ptr<const float3>>(archetype, to_archetype_component, chunk_begin, chunk_end, editor_update, std::make_index_sequence<N>());
 }
 
-static void update_implementation(ecs_details::Archetype &archetype, const ecs::ToComponentMap &to_archetype_component)
+static void update_implementation(ecs_details::Archetype &archetype, ecs::ToComponentMap to_archetype_component, uint32_t chunk_begin, uint32_t chunk_end)
 {
   const int N = 3;
-  ecs_details::query_archetype_iteration<N, ecs_details::Ptr<ecs::EntityId>, ecs_details::Ptr<float3>, ecs_details::Ptr<const float3>>(archetype, to_archetype_component, update, std::make_index_sequence<N>());
+  ecs_details::query_archetype_iteration<N, ecs_details::Ptr<ecs::EntityId>, ecs_details::Ptr<float3>, ecs_details::Ptr<const float3>>(archetype, to_archetype_component, chunk_begin, chunk_end, update, std::make_index_sequence<N>());
 }
 
-static void print_name_implementation(ecs_details::Archetype &archetype, const ecs::ToComponentMap &to_archetype_component)
+static void print_name_implementation(ecs_details::Archetype &archetype, ecs::ToComponentMap to_archetype_component, uint32_t chunk_begin, uint32_t chunk_end)
 {
   const int N = 3;
-  ecs_details::query_archetype_iteration<N, ecs_details::Ptr<const std::string>, ecs_details::Ptr<float3>, ecs_details::PrtWrapper<int>>(archetype, to_archetype_component, print_name, std::make_index_sequence<N>());
+  ecs_details::query_archetype_iteration<N, ecs_details::Ptr<const std::string>, ecs_details::Ptr<float3>, ecs_details::PrtWrapper<int>>(archetype, to_archetype_component, chunk_begin, chunk_end, print_name, std::make_index_sequence<N>());
 }
 
-static void update_with_singleton_implementation(ecs_details::Archetype &archetype, const ecs::ToComponentMap &to_archetype_component)
+static void update_with_singleton_implementation(ecs_details::Archetype &archetype, ecs::ToComponentMap to_archetype_component, uint32_t chunk_begin, uint32_t chunk_end)
 {
   const int N = 2;
-  ecs_details::query_archetype_iteration<N, ecs_details::Ptr<ecs::EntityId>, ecs_details::Ptr<SingletonComponent>>(archetype, to_archetype_component, update_with_singleton, std::make_index_sequence<N>());
+  ecs_details::query_archetype_iteration<N, ecs_details::Ptr<ecs::EntityId>, ecs_details::Ptr<SingletonComponent>>(archetype, to_archetype_component, chunk_begin, chunk_end, update_with_singleton, std::make_index_sequence<N>());
+}
+
+static void job_move_implementation(ecs_details::Archetype &archetype, ecs::ToComponentMap to_archetype_component, uint32_t chunk_begin, uint32_t chunk_end)
+{
+  const int N = 2;
+  ecs_details::query_archetype_iteration<N, ecs_details::Ptr<float3>, ecs_details::Ptr<const float3>>(archetype, to_archetype_component, chunk_begin, chunk_end, job_move, std::make_index_sequence<N>());
+}
+
+static void job_read_velocity_implementation(ecs_details::Archetype &archetype, ecs::ToComponentMap to_archetype_component, uint32_t chunk_begin, uint32_t chunk_end)
+{
+  const int N = 1;
+  ecs_details::query_archetype_iteration<N, ecs_details::Ptr<const float3>>(archetype, to_archetype_component, chunk_begin, chunk_end, job_read_velocity, std::make_index_sequence<N>());
+}
+
+static void job_read_position_implementation(ecs_details::Archetype &archetype, ecs::ToComponentMap to_archetype_component, uint32_t chunk_begin, uint32_t chunk_end)
+{
+  const int N = 1;
+  ecs_details::query_archetype_iteration<N, ecs_details::Ptr<const float3>>(archetype, to_archetype_component, chunk_begin, chunk_end, job_read_position, std::make_index_sequence<N>());
+}
+
+static void serial_touch_velocity_implementation(ecs_details::Archetype &archetype, ecs::ToComponentMap to_archetype_component, uint32_t chunk_begin, uint32_t chunk_end)
+{
+  const int N = 1;
+  ecs_details::query_archetype_iteration<N, ecs_details::Ptr<float3>>(archetype, to_archetype_component, chunk_begin, chunk_end, serial_touch_velocity, std::make_index_sequence<N>());
 }
 
-static void on_appear_event_broadcast_event(ecs_details::Archetype &archetype, const ecs::ToComponentMap &to_archetype_component, ecs::EventId event_id, const void *event_ptr)
+static void serial_read_velocity_implementation(ecs_details::Archetype &archetype, ecs::ToComponentMap to_archetype_component, uint32_t chunk_begin, uint32_t chunk_end)
+{
+  const int N = 1;
+  ecs_details::query_archetype_iteration<N, ecs_details::Ptr<const float3>>(archetype, to_archetype_component, chunk_begin, chunk_end, serial_read_velocity, std::make_index_sequence<N>());
+}
+
+static void serial_read_position_implementation(ecs_details::Archetype &archetype, ecs::ToComponentMap to_archetype_component, uint32_t chunk_begin, uint32_t chunk_end)
+{
+  const int N = 1;
+  ecs_details::query_archetype_iteration<N, ecs_details::Ptr<const float3>>(archetype, to_archetype_component, chunk_begin, chunk_end, serial_read_position, std::make_index_sequence<N>());
+}
+
+static void changed_read_implementation(ecs_details::Archetype &archetype, ecs::ToComponentMap to_archetype_component, uint32_t chunk_begin, uint32_t chunk_end)
+{
+  const int N = 1;
+  ecs_details::query_archetype_iteration<N, ecs_details::Ptr<const int>>(archetype, to_archetype_component, chunk_begin, chunk_end, changed_read, std::make_index_sequence<N>());
+}
+
+static void changed_self_implementation(ecs_details::Archetype &archetype, ecs::ToComponentMap to_archetype_component, uint32_t chunk_begin, uint32_t chunk_end)
+{
+  const int N = 1;
+  ecs_details::query_archetype_iteration<N, ecs_details::Ptr<int>>(archetype, to_archetype_component, chunk_begin, chunk_end, changed_self, std::make_index_sequence<N>());
+}
+
+static void changed_plan_write_implementation(ecs_details::Archetype &archetype, ecs::ToComponentMap to_archetype_component, uint32_t chunk_begin, uint32_t chunk_end)
+{
+  const int N = 1;
+  ecs_details::query_archetype_iteration<N, ecs_details::Ptr<int>>(archetype, to_archetype_component, chunk_begin, chunk_end, changed_plan_write, std::make_index_sequence<N>());
+}
+
+static void changed_plan_read_implementation(ecs_details::Archetype &archetype, ecs::ToComponentMap to_archetype_component, uint32_t chunk_begin, uint32_t chunk_end)
+{
+  const int N = 1;
+  ecs_details::query_archetype_iteration<N, ecs_details::Ptr<ecs::EntityId>>(archetype, to_archetype_component, chunk_begin, chunk_end, changed_plan_read, std::make_index_sequence<N>());
+}
+
+static void chunk_move_implementation(ecs_details::Archetype &archetype, ecs::ToComponentMap to_archetype_component, uint32_t chunk_begin, uint32_t chunk_end)
+{
+  const int N = 2;
+  ecs_details::query_archetype_chunk_iteration<N, float3, const float3>(archetype, to_archetype_component, chunk_begin, chunk_end, chunk_move, std::make_index_sequence<N>());
+}
+
+static void soa_move_implementation(ecs_details::Archetype &archetype, ecs::ToComponentMap to_archetype_component, uint32_t chunk_begin, uint32_t chunk_end)
+{
+  const int N = 2;
+  ecs_details::query_archetype_chunk_iteration<N, SoaFloat3, const SoaFloat3>(archetype, to_archetype_component, chunk_begin, chunk_end, soa_move, std::make_index_sequence<N>());
+}
+
+static void on_appear_event_broadcast_event(ecs_details::Archetype &archetype, ecs::ToComponentMap to_archetype_component, ecs::EventId event_id, const void *event_ptr)
 {
   ECS_UNUSED(event_id);
   const int N = 2;
   ecs_details::event_archetype_iteration<N, ecs_details::Ptr<const std::string>, ecs_details::PrtWrapper<const int>>(archetype, to_archetype_component, *(const ecs::OnAppear *)event_ptr, on_appear_event, std::make_index_sequence<N>());
 }
 
-static void on_appear_event_unicast_event(ecs_details::Archetype &archetype, const ecs::ToComponentMap &to_archetype_component, uint32_t component_idx, ecs::EventId event_id, const void *event_ptr)
+static void on_appear_event_unicast_event(ecs_details::Archetype &archetype, ecs::ToComponentMap to_archetype_component, uint32_t component_idx, ecs::EventId event_id, const void *event_ptr)
 {
   ECS_UNUSED(event_id);
   const int N = 2;
   ecs_details::event_invoke_for_entity<N, ecs_details::Ptr<const std::string>, ecs_details::PrtWrapper<const int>>(archetype, to_archetype_component, component_idx, *(const ecs::OnAppear *)event_ptr, on_appear_event, std::make_index_sequence<N>());
 }
 
-static void on_disappear_event_broadcast_event(ecs_details::Archetype &archetype, const ecs::ToComponentMap &to_archetype_component, ecs::EventId event_id, const void *event_ptr)
+static void on_appear_event_range_event(ecs_details::Archetype &archetype, ecs::ToComponentMap to_archetype_component, uint32_t component_begin, uint32_t component_end, ecs::EventId event_id, const void *event_ptr)
+{
+  ECS_UNUSED(event_id);
+  const int N = 2;
+  ecs_details::event_archetype_range_iteration<N, ecs_details::Ptr<const std::string>, ecs_details::PrtWrapper<const int>>(archetype, to_archetype_component, component_begin, component_end, *(const ecs::OnAppear *)event_ptr, on_appear_event, std::make_index_sequence<N>());
+}
+
+static void on_disappear_event_broadcast_event(ecs_details::Archetype &archetype, ecs::ToComponentMap to_archetype_component, ecs::EventId event_id, const void *event_ptr)
 {
   ECS_UNUSED(event_id);
   const int N = 2;
   ecs_details::event_archetype_iteration<N, ecs_details::Ptr<const std::string>, ecs_details::PrtWrapper<const int>>(archetype, to_archetype_component, *(const ecs::OnDisappear *)event_ptr, on_disappear_event, std::make_index_sequence<N>());
 }
 
-static void on_disappear_event_unicast_event(ecs_details::Archetype &archetype, const ecs::ToComponentMap &to_archetype_component, uint32_t component_idx, ecs::EventId event_id, const void *event_ptr)
+static void on_disappear_event_unicast_event(ecs_details::Archetype &archetype, ecs::ToComponentMap to_archetype_component, uint32_t component_idx, ecs::EventId event_id, const void *event_ptr)
 {
   ECS_UNUSED(event_id);
   const int N = 2;
   ecs_details::event_invoke_for_entity<N, ecs_details::Ptr<const std::string>, ecs_details::PrtWrapper<const int>>(archetype, to_archetype_component, component_idx, *(const ecs::OnDisappear *)event_ptr, on_disappear_event, std::make_index_sequence<N>());
 }
 
-static void appear_disapper_event_broadcast_event(ecs_details::Archetype &archetype, const ecs::ToComponentMap &to_archetype_component, ecs::EventId event_id, const void *event_ptr)
+static void on_disappear_event_range_event(ecs_details::Archetype &archetype, ecs::ToComponentMap to_archetype_component, uint32_t component_begin, uint32_t component_end, ecs::EventId event_id, const void *event_ptr)
+{
+  ECS_UNUSED(event_id);
+  const int N = 2;
+  ecs_details::event_archetype_range_iteration<N, ecs_details::Ptr<const std::string>, ecs_details::PrtWrapper<const int>>(archetype, to_archetype_component, component_begin, component_end, *(const ecs::OnDisappear *)event_ptr, on_disappear_event, std::make_index_sequence<N>());
+}
+
+static void appear_disapper_event_broadcast_event(ecs_details::Archetype &archetype, ecs::ToComponentMap to_archetype_component, ecs::EventId event_id, const void *event_ptr)
 {
   ECS_UNUSED(event_id);
   const int N = 2;
   ecs_details::event_archetype_iteration<N, ecs_details::Ptr<const std::string>, ecs_details::PrtWrapper<const int>>(archetype, to_archetype_component, ecs::Event(event_id, event_ptr), appear_disapper_event, std::make_index_sequence<N>());
 }
 
-static void appear_disapper_event_unicast_event(ecs_details::Archetype &archetype, const ecs::ToComponentMap &to_archetype_component, uint32_t component_idx, ecs::EventId event_id, const void *event_ptr)
+static void appear_disapper_event_unicast_event(ecs_details::Archetype &archetype, ecs::ToComponentMap to_archetype_component, uint32_t component_idx, ecs::EventId event_id, const void *event_ptr)
 {
   ECS_UNUSED(event_id);
   const int N = 2;
   ecs_details::event_invoke_for_entity<N, ecs_details::Ptr<const std::string>, ecs_details::PrtWrapper<const int>>(archetype, to_archetype_component, component_idx, ecs::Event(event_id, event_ptr), appear_disapper_event, std::make_index_sequence<N>());
 }
 
-static void health_changed_broadcast_event(ecs_details::Archetype &archetype, const ecs::ToComponentMap &to_archetype_component, ecs::EventId event_id, const void *event_ptr)
+static void appear_disapper_event_range_event(ecs_details::Archetype &archetype, ecs::ToComponentMap to_archetype_component, uint32_t component_begin, uint32_t component_end, ecs::EventId event_id, const void *event_ptr)
+{
+  ECS_UNUSED(event_id);
+  const int N = 2;
+  ecs_details::event_archetype_range_iteration<N, ecs_details::Ptr<const std::string>, ecs_details::PrtWrapper<const int>>(archetype, to_archetype_component, component_begin, component_end, ecs::Event(event_id, event_ptr), appear_disapper_event, std::make_index_sequence<N>());
+}
+
+static void health_changed_broadcast_event(ecs_details::Archetype &archetype, ecs::ToComponentMap to_archetype_component, ecs::EventId event_id, const void *event_ptr)
 {
   ECS_UNUSED(event_id);
   const int N = 2;
   ecs_details::event_archetype_iteration<N, ecs_details::Ptr<const std::string>, ecs_details::Ptr<int>>(archetype, to_archetype_component, ecs::Event(event_id, event_ptr), health_changed, std::make_index_sequence<N>());
 }
 
-static void health_changed_unicast_event(ecs_details::Archetype &archetype, const ecs::ToComponentMap &to_archetype_component, uint32_t component_idx, ecs::EventId event_id, const void *event_ptr)
+static void health_changed_unicast_event(ecs_details::Archetype &archetype, ecs::ToComponentMap to_archetype_component, uint32_t component_idx, ecs::EventId event_id, const void *event_ptr)
 {
   ECS_UNUSED(event_id);
   const int N = 2;
   ecs_details::event_invoke_for_entity<N, ecs_details::Ptr<const std::string>, ecs_details::Ptr<int>>(archetype, to_archetype_component, component_idx, ecs::Event(event_id, event_ptr), health_changed, std::make_index_sequence<N>());
 }
 
-static void update_event_broadcast_event(ecs_details::Archetype &archetype, const ecs::ToComponentMap &to_archetype_component, ecs::EventId event_id, const void *event_ptr)
+static void health_changed_range_event(ecs_details::Archetype &archetype, ecs::ToComponentMap to_archetype_component, uint32_t component_begin, uint32_t component_end, ecs::EventId event_id, const void *event_ptr)
+{
+  ECS_UNUSED(event_id);
+  const int N = 2;
+  ecs_details::event_archetype_range_iteration<N, ecs_details::Ptr<const std::string>, ecs_details::Ptr<int>>(archetype, to_archetype_component, component_begin, component_end, ecs::Event(event_id, event_ptr), health_changed, std::make_index_sequence<N>());
+}
+
+static void track_value_changed_broadcast_event(ecs_details::Archetype &archetype, ecs::ToComponentMap to_archetype_component, ecs::EventId event_id, const void *event_ptr)
+{
+  ECS_UNUSED(event_id);
+  const int N = 1;
+  ecs_details::event_archetype_iteration<N, ecs_details::Ptr<int>>(archetype, to_archetype_component, *(const ecs::OnTrack *)event_ptr, track_value_changed, std::make_index_sequence<N>());
+}
+
+static void track_value_changed_unicast_event(ecs_details::Archetype &archetype, ecs::ToComponentMap to_archetype_component, uint32_t component_idx, ecs::EventId event_id, const void *event_ptr)
+{
+  ECS_UNUSED(event_id);
+  const int N = 1;
+  ecs_details::event_invoke_for_entity<N, ecs_details::Ptr<int>>(archetype, to_archetype_component, component_idx, *(const ecs::OnTrack *)event_ptr, track_value_changed, std::make_index_sequence<N>());
+}
+
+static void track_value_changed_range_event(ecs_details::Archetype &archetype, ecs::ToComponentMap to_archetype_component, uint32_t component_begin, uint32_t component_end, ecs::EventId event_id, const void *event_ptr)
+{
+  ECS_UNUSED(event_id);
+  const int N = 1;
+  ecs_details::event_archetype_range_iteration<N, ecs_details::Ptr<int>>(archetype, to_archetype_component, component_begin, component_end, *(const ecs::OnTrack *)event_ptr, track_value_changed, std::make_index_sequence<N>());
+}
+
+static void track_label_changed_broadcast_event(ecs_details::Archetype &archetype, ecs::ToComponentMap to_archetype_component, ecs::EventId event_id, const void *event_ptr)
+{
+  ECS_UNUSED(event_id);
+  const int N = 1;
+  ecs_details::event_archetype_iteration<N, ecs_details::Ptr<const std::string>>(archetype, to_archetype_component, *(const ecs::OnTrack *)event_ptr, track_label_changed, std::make_index_sequence<N>());
+}
+
+static void track_label_changed_unicast_event(ecs_details::Archetype &archetype, ecs::ToComponentMap to_archetype_component, uint32_t component_idx, ecs::EventId event_id, const void *event_ptr)
+{
+  ECS_UNUSED(event_id);
+  const int N = 1;
+  ecs_details::event_invoke_for_entity<N, ecs_details::Ptr<const std::string>>(archetype, to_archetype_component, component_idx, *(const ecs::OnTrack *)event_ptr, track_label_changed, std::make_index_sequence<N>());
+}
+
+static void track_label_changed_range_event(ecs_details::Archetype &archetype, ecs::ToComponentMap to_archetype_component, uint32_t component_begin, uint32_t component_end, ecs::EventId event_id, const void *event_ptr)
+{
+  ECS_UNUSED(event_id);
+  const int N = 1;
+  ecs_details::event_archetype_range_iteration<N, ecs_details::Ptr<const std::string>>(archetype, to_archetype_component, component_begin, component_end, *(const ecs::OnTrack *)event_ptr, track_label_changed, std::make_index_sequence<N>());
+}
+
+static void on_batch_appear_broadcast_event(ecs_details::Archetype &archetype, ecs::ToComponentMap to_archetype_component, ecs::EventId event_id, const void *event_ptr)
+{
+  ECS_UNUSED(event_id);
+  const int N = 2;
+  ecs_details::event_archetype_iteration<N, ecs_details::Ptr<int>, ecs_details::Ptr<const std::string>>(archetype, to_archetype_component, *(const ecs::OnAppear *)event_ptr, on_batch_appear, std::make_index_sequence<N>());
+}
+
+static void on_batch_appear_unicast_event(ecs_details::Archetype &archetype, ecs::ToComponentMap to_archetype_component, uint32_t component_idx, ecs::EventId event_id, const void *event_ptr)
+{
+  ECS_UNUSED(event_id);
+  const int N = 2;
+  ecs_details::event_invoke_for_entity<N, ecs_details::Ptr<int>, ecs_details::Ptr<const std::string>>(archetype, to_archetype_component, component_idx, *(const ecs::OnAppear *)event_ptr, on_batch_appear, std::make_index_sequence<N>());
+}
+
+static void on_batch_appear_range_event(ecs_details::Archetype &archetype, ecs::ToComponentMap to_archetype_component, uint32_t component_begin, uint32_t component_end, ecs::EventId event_id, const void *event_ptr)
+{
+  ECS_UNUSED(event_id);
+  const int N = 2;
+  ecs_details::event_archetype_range_iteration<N, ecs_details::Ptr<int>, ecs_details::Ptr<const std::string>>(archetype, to_archetype_component, component_begin, component_end, *(const ecs::OnAppear *)event_ptr, on_batch_appear, std::make_index_sequence<N>());
+}
+
+static void on_batch_disappear_broadcast_event(ecs_details::Archetype &archetype, ecs::ToComponentMap to_archetype_component, ecs::EventId event_id, const void *event_ptr)
+{
+  ECS_UNUSED(event_id);
+  const int N = 1;
+  ecs_details::event_archetype_iteration<N, ecs_details::Ptr<int>>(archetype, to_archetype_component, *(const ecs::OnDisappear *)event_ptr, on_batch_disappear, std::make_index_sequence<N>());
+}
+
+static void on_batch_disappear_unicast_event(ecs_details::Archetype &archetype, ecs::ToComponentMap to_archetype_component, uint32_t component_idx, ecs::EventId event_id, const void *event_ptr)
+{
+  ECS_UNUSED(event_id);
+  const int N = 1;
+  ecs_details::event_invoke_for_entity<N, ecs_details::Ptr<int>>(archetype, to_archetype_component, component_idx, *(const ecs::OnDisappear *)event_ptr, on_batch_disappear, std::make_index_sequence<N>());
+}
+
+static void on_batch_disappear_range_event(ecs_details::Archetype &archetype, ecs::ToComponentMap to_archetype_component, uint32_t component_begin, uint32_t component_end, ecs::EventId event_id, const void *event_ptr)
+{
+  ECS_UNUSED(event_id);
+  const int N = 1;
+  ecs_details::event_archetype_range_iteration<N, ecs_details::Ptr<int>>(archetype, to_archetype_component, component_begin, component_end, *(const ecs::OnDisappear *)event_ptr, on_batch_disappear, std::make_index_sequence<N>());
+}
+
+static void update_event_broadcast_event(ecs_details::Archetype &archetype, ecs::ToComponentMap to_archetype_component, ecs::EventId event_id, const void *event_ptr)
 {
   ECS_UNUSED(event_id);
   const int N = 3;
   ecs_details::event_archetype_iteration<N, ecs_details::Ptr<ecs::EntityId>, ecs_details::Ptr<float3>, ecs_details::Ptr<const float3>>(archetype, to_archetype_component, *(const UpdateEvent *)event_ptr, update_event, std::make_index_sequence<N>());
 }
 
-static void update_event_unicast_event(ecs_details::Archetype &archetype, const ecs::ToComponentMap &to_archetype_component, uint32_t component_idx, ecs::EventId event_id, const void *event_ptr)
+static void update_event_unicast_event(ecs_details::Archetype &archetype, ecs::ToComponentMap to_archetype_component, uint32_t component_idx, ecs::EventId event_id, const void *event_ptr)
 {
   ECS_UNUSED(event_id);
   const int N = 3;
   ecs_details::event_invoke_for_entity<N, ecs_details::Ptr<ecs::EntityId>, ecs_details::Ptr<float3>, ecs_details::Ptr<const float3>>(archetype, to_archetype_component, component_idx, *(const UpdateEvent *)event_ptr, update_event, std::make_index_sequence<N>());
 }
 
-static void heavy_event_broadcast_event(ecs_details::Archetype &archetype, const ecs::ToComponentMap &to_archetype_component, ecs::EventId event_id, const void *event_ptr)
+static void update_event_range_event(ecs_details::Archetype &archetype, ecs::ToComponentMap to_archetype_component, uint32_t component_begin, uint32_t component_end, ecs::EventId event_id, const void *event_ptr)
+{
+  ECS_UNUSED(event_id);
+  const int N = 3;
+  ecs_details::event_archetype_range_iteration<N, ecs_details::Ptr<ecs::EntityId>, ecs_details::Ptr<float3>, ecs_details::Ptr<const float3>>(archetype, to_archetype_component, component_begin, component_end, *(const UpdateEvent *)event_ptr, update_event, std::make_index_sequence<N>());
+}
+
+static void heavy_event_broadcast_event(ecs_details::Archetype &archetype, ecs::ToComponentMap to_archetype_component, ecs::EventId event_id, const void *event_ptr)
 {
   ECS_UNUSED(event_id);
   const int N = 1;
   ecs_details::event_archetype_iteration<N, ecs_details::Ptr<ecs::EntityId>>(archetype, to_archetype_component, *(const HeavyEvent *)event_ptr, heavy_event, std::make_index_sequence<N>());
 }
 
-static void heavy_event_unicast_event(ecs_details::Archetype &archetype, const ecs::ToComponentMap &to_archetype_component, uint32_t component_idx, ecs::EventId event_id, const void *event_ptr)
+static void heavy_event_unicast_event(ecs_details::Archetype &archetype, ecs::ToComponentMap to_archetype_component, uint32_t component_idx, ecs::EventId event_id, const void *event_ptr)
 {
   ECS_UNUSED(event_id);
   const int N = 1;
   ecs_details::event_invoke_for_entity<N, ecs_details::Ptr<ecs::EntityId>>(archetype, to_archetype_component, component_idx, *(const HeavyEvent *)event_ptr, heavy_event, std::make_index_sequence<N>());
 }
 
-static void multi_event_broadcast_event(ecs_details::Archetype &archetype, const ecs::ToComponentMap &to_archetype_component, ecs::EventId event_id, const void *event_ptr)
+static void heavy_event_range_event(ecs_details::Archetype &archetype, ecs::ToComponentMap to_archetype_component, uint32_t component_begin, uint32_t component_end, ecs::EventId event_id, const void *event_ptr)
+{
+  ECS_UNUSED(event_id);
+  const int N = 1;
+  ecs_details::event_archetype_range_iteration<N, ecs_details::Ptr<ecs::EntityId>>(archetype, to_archetype_component, component_begin, component_end, *(const HeavyEvent *)event_ptr, heavy_event, std::make_index_sequence<N>());
+}
+
+static void multi_event_broadcast_event(ecs_details::Archetype &archetype, ecs::ToComponentMap to_archetype_component, ecs::EventId event_id, const void *event_ptr)
 {
   ECS_UNUSED(event_id);
   const int N = 1;
   ecs_details::event_archetype_iteration<N, ecs_details::Ptr<ecs::EntityId>>(archetype, to_archetype_component, ecs::Event(event_id, event_ptr), multi_event, std::make_index_sequence<N>());
 }
 
-static void multi_event_unicast_event(ecs_details::Archetype &archetype, const ecs::ToComponentMap &to_archetype_component, uint32_t component_idx, ecs::EventId event_id, const void *event_ptr)
+static void multi_event_unicast_event(ecs_details::Archetype &archetype, ecs::ToComponentMap to_archetype_component, uint32_t component_idx, ecs::EventId event_id, const void *event_ptr)
 {
   ECS_UNUSED(event_id);
   const int N = 1;
   ecs_details::event_invoke_for_entity<N, ecs_details::Ptr<ecs::EntityId>>(archetype, to_archetype_component, component_idx, ecs::Event(event_id, event_ptr), multi_event, std::make_index_sequence<N>());
 }
 
+static void multi_event_range_event(ecs_details::Archetype &archetype, ecs::ToComponentMap to_archetype_component, uint32_t component_begin, uint32_t component_end, ecs::EventId event_id, const void *event_ptr)
+{
+  ECS_UNUSED(event_id);
+  const int N = 1;
+  ecs_details::event_archetype_range_iteration<N, ecs_details::Ptr<ecs::EntityId>>(archetype, to_archetype_component, component_begin, component_end, ecs::Event(event_id, event_ptr), multi_event, std::make_index_sequence<N>());
+}
+
+static void command_event_broadcast_event(ecs_details::Archetype &archetype, ecs::ToComponentMap to_archetype_component, ecs::EventId event_id, const void *event_ptr)
+{
+  ECS_UNUSED(event_id);
+  const int N = 1;
+  ecs_details::event_archetype_iteration<N, ecs_details::Ptr<int>>(archetype, to_archetype_component, *(const CommandEvent *)event_ptr, command_event, std::make_index_sequence<N>());
+}
+
+static void command_event_unicast_event(ecs_details::Archetype &archetype, ecs::ToComponentMap to_archetype_component, uint32_t component_idx, ecs::EventId event_id, const void *event_ptr)
+{
+  ECS_UNUSED(event_id);
+  const int N = 1;
+  ecs_details::event_invoke_for_entity<N, ecs_details::Ptr<int>>(archetype, to_archetype_component, component_idx, *(const CommandEvent *)event_ptr, command_event, std::make_index_sequence<N>());
+}
+
+static void command_event_range_event(ecs_details::Archetype &archetype, ecs::ToComponentMap to_archetype_component, uint32_t component_begin, uint32_t component_end, ecs::EventId event_id, const void *event_ptr)
+{
+  ECS_UNUSED(event_id);
+  const int N = 1;
+  ecs_details::event_archetype_range_iteration<N, ecs_details::Ptr<int>>(archetype, to_archetype_component, component_begin, component_end, *(const CommandEvent *)event_ptr, command_event, std::make_index_sequence<N>());
+}
+
+static void track_block_changed_broadcast_event(ecs_details::Archetype &archetype, ecs::ToComponentMap to_archetype_component, ecs::EventId event_id, const void *event_ptr)
+{
+  ECS_UNUSED(event_id);
+  const int N = 1;
+  ecs_details::event_archetype_iteration<N, ecs_details::Ptr<const BigBlock>>(archetype, to_archetype_component, *(const ecs::OnTrack *)event_ptr, track_block_changed, std::make_index_sequence<N>());
+}
+
+static void track_block_changed_unicast_event(ecs_details::Archetype &archetype, ecs::ToComponentMap to_archetype_component, uint32_t component_idx, ecs::EventId event_id, const void *event_ptr)
+{
+  ECS_UNUSED(event_id);
+  const int N = 1;
+  ecs_details::event_invoke_for_entity<N, ecs_details::Ptr<const BigBlock>>(archetype, to_archetype_component, component_idx, *(const ecs::OnTrack *)event_ptr, track_block_changed, std::make_index_sequence<N>());
+}
+
+static void track_block_changed_range_event(ecs_details::Archetype &archetype, ecs::ToComponentMap to_archetype_component, uint32_t component_begin, uint32_t component_end, ecs::EventId event_id, const void *event_ptr)
+{
+  ECS_UNUSED(event_id);
+  const int N = 1;
+  ecs_details::event_archetype_range_iteration<N, ecs_details::Ptr<const BigBlock>>(archetype, to_archetype_component, component_begin, component_end, *(const ecs::OnTrack *)event_ptr, track_block_changed, std::make_index_sequence<N>());
+}
+
+static void track_inventory_changed_broadcast_event(ecs_details::Archetype &archetype, ecs::ToComponentMap to_archetype_component, ecs::EventId event_id, const void *event_ptr)
+{
+  ECS_UNUSED(event_id);
+  const int N = 1;
+  ecs_details::event_archetype_iteration<N, ecs_details::Ptr<const Inventory>>(archetype, to_archetype_component, *(const ecs::OnTrack *)event_ptr, track_inventory_changed, std::make_index_sequence<N>());
+}
+
+static void track_inventory_changed_unicast_event(ecs_details::Archetype &archetype, ecs::ToComponentMap to_archetype_component, uint32_t component_idx, ecs::EventId event_id, const void *event_ptr)
+{
+  ECS_UNUSED(event_id);
+  const int N = 1;
+  ecs_details::event_invoke_for_entity<N, ecs_details::Ptr<const Inventory>>(archetype, to_archetype_component, component_idx, *(const ecs::OnTrack *)event_ptr, track_inventory_changed, std::make_index_sequence<N>());
+}
+
+static void track_inventory_changed_range_event(ecs_details::Archetype &archetype, ecs::ToComponentMap to_archetype_component, uint32_t component_begin, uint32_t component_end, ecs::EventId event_id, const void *event_ptr)
+{
+  ECS_UNUSED(event_id);
+  const int N = 1;
+  ecs_details::event_archetype_range_iteration<N, ecs_details::Ptr<const Inventory>>(archetype, to_archetype_component, component_begin, component_end, *(const ecs::OnTrack *)event_ptr, track_inventory_changed, std::make_index_sequence<N>());
+}
+
 static void ecs_registration(ecs::EcsManager &mgr)
 {
   ECS_UNUSED(mgr);
   {
     ecs::Query query;
-    query.name = "print_name_query";
-    query.uniqueName = "sources/tests/unit_tests/main.inl:39[print_name_query]";
+    query.name = "print_name_query";
+    query.uniqueName = "sources/tests/unit_tests/main.inl:46[print_name_query]";
+    query.nameHash = ecs::hash(query.uniqueName.c_str());
+    query.querySignature =
+    {
+      {ecs::get_component_id(ecs::TypeInfo<std::string>::typeId, "name"), ecs::Query::ComponentAccess::READ_ONLY},
+      {ecs::get_component_id(ecs::TypeInfo<int>::typeId, "health"), ecs::Query::ComponentAccess::READ_WRITE_OPTIONAL}
+    };
+    ecs::register_query(mgr, std::move(query));
+  }
+  {
+    ecs::Query query;
+    query.name = "shrink_query";
+    query.uniqueName = "sources/tests/unit_tests/main.inl:537[shrink_query]";
     query.nameHash = ecs::hash(query.uniqueName.c_str());
     query.querySignature =
     {
-      {ecs::get_component_id(ecs::TypeInfo<std::string>::typeId, "name"), ecs::Query::ComponentAccess::READ_ONLY},
-      {ecs::get_component_id(ecs::TypeInfo<int>::typeId, "health"), ecs::Query::ComponentAccess::READ_WRITE_OPTIONAL}
+      {ecs::get_component_id(ecs::TypeInfo<int>::typeId, "shrink_health"), ecs::Query::ComponentAccess::READ_COPY}
+    };
+    ecs::register_query(mgr, std::move(query));
+  }
+  {
+    ecs::Query query;
+    query.name = "job_parallel_query";
+    query.uniqueName = "sources/tests/unit_tests/main.inl:718[job_parallel_query]";
+    query.nameHash = ecs::hash(query.uniqueName.c_str());
+    query.querySignature =
+    {
+      {ecs::get_component_id(ecs::TypeInfo<float3>::typeId, "job_position"), ecs::Query::ComponentAccess::READ_ONLY},
+      {ecs::get_component_id(ecs::TypeInfo<float3>::typeId, "job_velocity"), ecs::Query::ComponentAccess::READ_ONLY}
+    };
+    ecs::register_query(mgr, std::move(query));
+  }
+  {
+    ecs::Query query;
+    query.name = "job_source_query";
+    query.uniqueName = "sources/tests/unit_tests/main.inl:730[job_source_query]";
+    query.nameHash = ecs::hash(query.uniqueName.c_str());
+    query.querySignature =
+    {
+      {ecs::get_component_id(ecs::TypeInfo<float3>::typeId, "job_position"), ecs::Query::ComponentAccess::READ_ONLY}
+    };
+    ecs::register_query(mgr, std::move(query));
+  }
+  {
+    ecs::Query query;
+    query.name = "chunk_query";
+    query.uniqueName = "sources/tests/unit_tests/main.inl:766[chunk_query]";
+    query.nameHash = ecs::hash(query.uniqueName.c_str());
+    query.querySignature =
+    {
+      {ecs::get_component_id(ecs::TypeInfo<float3>::typeId, "job_position"), ecs::Query::ComponentAccess::READ_ONLY},
+      {ecs::get_component_id(ecs::TypeInfo<float3>::typeId, "job_velocity"), ecs::Query::ComponentAccess::READ_ONLY}
+    };
+    ecs::register_query(mgr, std::move(query));
+  }
+  {
+    ecs::Query query;
+    query.name = "transition_stunned_query";
+    query.uniqueName = "sources/tests/unit_tests/main.inl:937[transition_stunned_query]";
+    query.nameHash = ecs::hash(query.uniqueName.c_str());
+    query.querySignature =
+    {
+      {ecs::get_component_id(ecs::TypeInfo<int>::typeId, "transition_stunned"), ecs::Query::ComponentAccess::READ_COPY},
+      {ecs::get_component_id(ecs::TypeInfo<int>::typeId, "transition_health"), ecs::Query::ComponentAccess::READ_COPY}
+    };
+    ecs::register_query(mgr, std::move(query));
+  }
+  {
+    ecs::Query query;
+    query.name = "changed_write_query";
+    query.uniqueName = "sources/tests/unit_tests/main.inl:1035[changed_write_query]";
+    query.nameHash = ecs::hash(query.uniqueName.c_str());
+    query.querySignature =
+    {
+      {ecs::get_component_id(ecs::TypeInfo<int>::typeId, "changed_value"), ecs::Query::ComponentAccess::READ_WRITE}
+    };
+    ecs::register_query(mgr, std::move(query));
+  }
+  {
+    ecs::Query query;
+    query.name = "track_write_query";
+    query.uniqueName = "sources/tests/unit_tests/main.inl:1153[track_write_query]";
+    query.nameHash = ecs::hash(query.uniqueName.c_str());
+    query.querySignature =
+    {
+      {ecs::get_component_id(ecs::TypeInfo<int>::typeId, "track_value"), ecs::Query::ComponentAccess::READ_WRITE}
+    };
+    ecs::register_query(mgr, std::move(query));
+  }
+  {
+    ecs::Query query;
+    query.name = "tag_enemy_query";
+    query.uniqueName = "sources/tests/unit_tests/main.inl:1304[tag_enemy_query]";
+    query.nameHash = ecs::hash(query.uniqueName.c_str());
+    query.querySignature =
+    {
+      {ecs::get_component_id(ecs::TypeInfo<int>::typeId, "tag_health"), ecs::Query::ComponentAccess::READ_COPY}
+    };
+    query.requireComponents =
+    {
+      ecs::get_component_id(ecs::TypeInfo<EnemyTag>::typeId, "tag_enemy")
+    };
+    ecs::register_query(mgr, std::move(query));
+  }
+  {
+    ecs::Query query;
+    query.name = "tag_plain_query";
+    query.uniqueName = "sources/tests/unit_tests/main.inl:1309[tag_plain_query]";
+    query.nameHash = ecs::hash(query.uniqueName.c_str());
+    query.querySignature =
+    {
+      {ecs::get_component_id(ecs::TypeInfo<int>::typeId, "tag_health"), ecs::Query::ComponentAccess::READ_COPY}
+    };
+    query.excludeComponents =
+    {
+      ecs::get_component_id(ecs::TypeInfo<EnemyTag>::typeId, "tag_enemy")
+    };
+    ecs::register_query(mgr, std::move(query));
+  }
+  {
+    ecs::Query query;
+    query.name = "tag_optional_query";
+    query.uniqueName = "sources/tests/unit_tests/main.inl:1314[tag_optional_query]";
+    query.nameHash = ecs::hash(query.uniqueName.c_str());
+    query.querySignature =
+    {
+      {ecs::get_component_id(ecs::TypeInfo<int>::typeId, "tag_health"), ecs::Query::ComponentAccess::READ_COPY},
+      {ecs::get_component_id(ecs::TypeInfo<EnemyTag>::typeId, "tag_enemy"), ecs::Query::ComponentAccess::READ_ONLY_OPTIONAL}
     };
     ecs::register_query(mgr, std::move(query));
   }
   {
     ecs::Query query;
     query.name = "print_name_by_eid_query";
-    query.uniqueName = "sources/tests/unit_tests/main.inl:49[print_name_by_eid_query]";
+    query.uniqueName = "sources/tests/unit_tests/main.inl:56[print_name_by_eid_query]";
     query.nameHash = ecs::hash(query.uniqueName.c_str());
     query.querySignature =
     {
@@ -176,7 +676,7 @@ static void ecs_registration(ecs::EcsManager &mgr)
   {
     ecs::System query;
     query.name = "editor_update";
-    query.uniqueName = "sources/tests/unit_tests/main.inl:19[editor_update]";
+    query.uniqueName = "sources/tests/unit_tests/main.inl:26[editor_update]";
     query.nameHash = ecs::hash(query.uniqueName.c_str());
     query.querySignature =
     {
@@ -199,7 +699,7 @@ static void ecs_registration(ecs::EcsManager &mgr)
   {
     ecs::System query;
     query.name = "update";
-    query.uniqueName = "sources/tests/unit_tests/main.inl:25[update]";
+    query.uniqueName = "sources/tests/unit_tests/main.inl:32[update]";
     query.nameHash = ecs::hash(query.uniqueName.c_str());
     query.querySignature =
     {
@@ -221,7 +721,7 @@ static void ecs_registration(ecs::EcsManager &mgr)
   {
     ecs::System query;
     query.name = "print_name";
-    query.uniqueName = "sources/tests/unit_tests/main.inl:32[print_name]";
+    query.uniqueName = "sources/tests/unit_tests/main.inl:39[print_name]";
     query.nameHash = ecs::hash(query.uniqueName.c_str());
     query.querySignature =
     {
@@ -235,7 +735,7 @@ static void ecs_registration(ecs::EcsManager &mgr)
   {
     ecs::System query;
     query.name = "update_with_singleton";
-    query.uniqueName = "sources/tests/unit_tests/main.inl:123[update_with_singleton]";
+    query.uniqueName = "sources/tests/unit_tests/main.inl:247[update_with_singleton]";
     query.nameHash = ecs::hash(query.uniqueName.c_str());
     query.querySignature =
     {
@@ -253,10 +753,186 @@ static void ecs_registration(ecs::EcsManager &mgr)
     query.update_archetype = update_with_singleton_implementation;
     ecs::register_system(mgr, std::move(query));
   }
+  {
+    ecs::System query;
+    query.name = "job_move";
+    query.uniqueName = "sources/tests/unit_tests/main.inl:253[job_move]";
+    query.nameHash = ecs::hash(query.uniqueName.c_str());
+    query.querySignature =
+    {
+      {ecs::get_component_id(ecs::TypeInfo<float3>::typeId, "job_position"), ecs::Query::ComponentAccess::READ_WRITE},
+      {ecs::get_component_id(ecs::TypeInfo<float3>::typeId, "job_velocity"), ecs::Query::ComponentAccess::READ_ONLY}
+    };
+    query.update_archetype = job_move_implementation;
+    query.stage = "job_act";
+    query.isJob = true;
+    ecs::register_system(mgr, std::move(query));
+  }
+  {
+    ecs::System query;
+    query.name = "job_read_velocity";
+    query.uniqueName = "sources/tests/unit_tests/main.inl:263[job_read_velocity]";
+    query.nameHash = ecs::hash(query.uniqueName.c_str());
+    query.querySignature =
+    {
+      {ecs::get_component_id(ecs::TypeInfo<float3>::typeId, "job_velocity"), ecs::Query::ComponentAccess::READ_ONLY}
+    };
+    query.update_archetype = job_read_velocity_implementation;
+    query.stage = "job_act";
+    query.isJob = true;
+    ecs::register_system(mgr, std::move(query));
+  }
+  {
+    ecs::System query;
+    query.name = "job_read_position";
+    query.uniqueName = "sources/tests/unit_tests/main.inl:271[job_read_position]";
+    query.nameHash = ecs::hash(query.uniqueName.c_str());
+    query.querySignature =
+    {
+      {ecs::get_component_id(ecs::TypeInfo<float3>::typeId, "job_position"), ecs::Query::ComponentAccess::READ_ONLY}
+    };
+    query.update_archetype = job_read_position_implementation;
+    query.stage = "job_act";
+    ecs::register_system(mgr, std::move(query));
+  }
+  {
+    ecs::System query;
+    query.name = "serial_touch_velocity";
+    query.uniqueName = "sources/tests/unit_tests/main.inl:290[serial_touch_velocity]";
+    query.nameHash = ecs::hash(query.uniqueName.c_str());
+    query.querySignature =
+    {
+      {ecs::get_component_id(ecs::TypeInfo<float3>::typeId, "job_velocity"), ecs::Query::ComponentAccess::READ_WRITE}
+    };
+    query.update_archetype = serial_touch_velocity_implementation;
+    query.stage = "serial_act";
+    ecs::register_system(mgr, std::move(query));
+  }
+  {
+    ecs::System query;
+    query.name = "serial_read_velocity";
+    query.uniqueName = "sources/tests/unit_tests/main.inl:297[serial_read_velocity]";
+    query.nameHash = ecs::hash(query.uniqueName.c_str());
+    query.querySignature =
+    {
+      {ecs::get_component_id(ecs::TypeInfo<float3>::typeId, "job_velocity"), ecs::Query::ComponentAccess::READ_ONLY}
+    };
+    query.update_archetype = serial_read_velocity_implementation;
+    query.stage = "serial_act";
+    ecs::register_system(mgr, std::move(query));
+  }
+  {
+    ecs::System query;
+    query.name = "serial_read_position";
+    query.uniqueName = "sources/tests/unit_tests/main.inl:304[serial_read_position]";
+    query.nameHash = ecs::hash(query.uniqueName.c_str());
+    query.querySignature =
+    {
+      {ecs::get_component_id(ecs::TypeInfo<float3>::typeId, "job_position"), ecs::Query::ComponentAccess::READ_ONLY}
+    };
+    query.update_archetype = serial_read_position_implementation;
+    query.stage = "serial_act";
+    ecs::register_system(mgr, std::move(query));
+  }
+  {
+    ecs::System query;
+    query.name = "changed_read";
+    query.uniqueName = "sources/tests/unit_tests/main.inl:314[changed_read]";
+    query.nameHash = ecs::hash(query.uniqueName.c_str());
+    query.querySignature =
+    {
+      {ecs::get_component_id(ecs::TypeInfo<int>::typeId, "changed_value"), ecs::Query::ComponentAccess::READ_ONLY}
+    };
+    query.update_archetype = changed_read_implementation;
+    query.stage = "changed_act";
+    query.changedComponents =
+    {
+      ecs::get_component_id(ecs::TypeInfo<int>::typeId, "changed_value")
+    };
+    ecs::register_system(mgr, std::move(query));
+  }
+  {
+    ecs::System query;
+    query.name = "changed_self";
+    query.uniqueName = "sources/tests/unit_tests/main.inl:322[changed_self]";
+    query.nameHash = ecs::hash(query.uniqueName.c_str());
+    query.querySignature =
+    {
+      {ecs::get_component_id(ecs::TypeInfo<int>::typeId, "changed_value"), ecs::Query::ComponentAccess::READ_WRITE}
+    };
+    query.update_archetype = changed_self_implementation;
+    query.stage = "changed_self_act";
+    query.changedComponents =
+    {
+      ecs::get_component_id(ecs::TypeInfo<int>::typeId, "changed_value")
+    };
+    ecs::register_system(mgr, std::move(query));
+  }
+  {
+    ecs::System query;
+    query.name = "changed_plan_write";
+    query.uniqueName = "sources/tests/unit_tests/main.inl:330[changed_plan_write]";
+    query.nameHash = ecs::hash(query.uniqueName.c_str());
+    query.querySignature =
+    {
+      {ecs::get_component_id(ecs::TypeInfo<int>::typeId, "changed_value"), ecs::Query::ComponentAccess::READ_WRITE}
+    };
+    query.update_archetype = changed_plan_write_implementation;
+    query.stage = "changed_plan_act";
+    query.isJob = true;
+    ecs::register_system(mgr, std::move(query));
+  }
+  {
+    ecs::System query;
+    query.name = "changed_plan_read";
+    query.uniqueName = "sources/tests/unit_tests/main.inl:336[changed_plan_read]";
+    query.nameHash = ecs::hash(query.uniqueName.c_str());
+    query.querySignature =
+    {
+      {ecs::get_component_id(ecs::TypeInfo<ecs::EntityId>::typeId, "eid"), ecs::Query::ComponentAccess::READ_COPY}
+    };
+    query.update_archetype = changed_plan_read_implementation;
+    query.stage = "changed_plan_act";
+    query.isJob = true;
+    query.changedComponents =
+    {
+      ecs::get_component_id(ecs::TypeInfo<int>::typeId, "changed_value")
+    };
+    ecs::register_system(mgr, std::move(query));
+  }
+  {
+    ecs::System query;
+    query.name = "chunk_move";
+    query.uniqueName = "sources/tests/unit_tests/main.inl:342[chunk_move]";
+    query.nameHash = ecs::hash(query.uniqueName.c_str());
+    query.querySignature =
+    {
+      {ecs::get_component_id(ecs::TypeInfo<float3>::typeId, "job_position"), ecs::Query::ComponentAccess::READ_WRITE},
+      {ecs::get_component_id(ecs::TypeInfo<float3>::typeId, "job_velocity"), ecs::Query::ComponentAccess::READ_ONLY}
+    };
+    query.update_archetype = chunk_move_implementation;
+    query.stage = "chunk_act";
+    query.isJob = true;
+    ecs::register_system(mgr, std::move(query));
+  }
+  {
+    ecs::System query;
+    query.name = "soa_move";
+    query.uniqueName = "sources/tests/unit_tests/main.inl:359[soa_move]";
+    query.nameHash = ecs::hash(query.uniqueName.c_str());
+    query.querySignature =
+    {
+      {ecs::get_component_id(ecs::TypeInfo<SoaFloat3>::typeId, "soa_position"), ecs::Query::ComponentAccess::READ_WRITE},
+      {ecs::get_component_id(ecs::TypeInfo<SoaFloat3>::typeId, "soa_velocity"), ecs::Query::ComponentAccess::READ_ONLY}
+    };
+    query.update_archetype = soa_move_implementation;
+    query.stage = "soa_act";
+    ecs::register_system(mgr, std::move(query));
+  }
   {
     ecs::EventHandler query;
     query.name = "on_appear_event";
-    query.uniqueName = "sources/tests/unit_tests/main.inl:56[on_appear_event]";
+    query.uniqueName = "sources/tests/unit_tests/main.inl:63[on_appear_event]";
     query.nameHash = ecs::hash(query.uniqueName.c_str());
     query.querySignature =
     {
@@ -266,13 +942,14 @@ static void ecs_registration(ecs::EcsManager &mgr)
     query.before = {"appear_disapper_event", };
     query.broadcastEvent = on_appear_event_broadcast_event;
     query.unicastEvent = on_appear_event_unicast_event;
+    query.rangeEvent = on_appear_event_range_event;
     query.eventIds = {ecs::EventInfo<ecs::OnAppear>::eventId};
     ecs::register_event(mgr, std::move(query));
   }
   {
     ecs::EventHandler query;
     query.name = "on_disappear_event";
-    query.uniqueName = "sources/tests/unit_tests/main.inl:61[on_disappear_event]";
+    query.uniqueName = "sources/tests/unit_tests/main.inl:68[on_disappear_event]";
     query.nameHash = ecs::hash(query.uniqueName.c_str());
     query.querySignature =
     {
@@ -282,13 +959,14 @@ static void ecs_registration(ecs::EcsManager &mgr)
     query.before = {"appear_disapper_event", };
     query.broadcastEvent = on_disappear_event_broadcast_event;
     query.unicastEvent = on_disappear_event_unicast_event;
+    query.rangeEvent = on_disappear_event_range_event;
     query.eventIds = {ecs::EventInfo<ecs::OnDisappear>::eventId};
     ecs::register_event(mgr, std::move(query));
   }
   {
     ecs::EventHandler query;
     query.name = "appear_disapper_event";
-    query.uniqueName = "sources/tests/unit_tests/main.inl:66[appear_disapper_event]";
+    query.uniqueName = "sources/tests/unit_tests/main.inl:73[appear_disapper_event]";
     query.nameHash = ecs::hash(query.uniqueName.c_str());
     query.querySignature =
     {
@@ -298,13 +976,14 @@ static void ecs_registration(ecs::EcsManager &mgr)
     query.after = {"on_appear_event", "on_disappear_event", };
     query.broadcastEvent = appear_disapper_event_broadcast_event;
     query.unicastEvent = appear_disapper_event_unicast_event;
+    query.rangeEvent = appear_disapper_event_range_event;
     query.eventIds = {ecs::EventInfo<ecs::OnAppear>::eventId, ecs::EventInfo<ecs::OnDisappear>::eventId, };
     ecs::register_event(mgr, std::move(query));
   }
   {
     ecs::EventHandler query;
     query.name = "health_changed";
-    query.uniqueName = "sources/tests/unit_tests/main.inl:75[health_changed]";
+    query.uniqueName = "sources/tests/unit_tests/main.inl:82[health_changed]";
     query.nameHash = ecs::hash(query.uniqueName.c_str());
     query.querySignature =
     {
@@ -313,6 +992,7 @@ static void ecs_registration(ecs::EcsManager &mgr)
     };
     query.broadcastEvent = health_changed_broadcast_event;
     query.unicastEvent = health_changed_unicast_event;
+    query.rangeEvent = health_changed_range_event;
     query.trackedComponents =
     {
       ecs::get_component_id(ecs::TypeInfo<int>::typeId, "health")
@@ -320,10 +1000,79 @@ static void ecs_registration(ecs::EcsManager &mgr)
     query.eventIds = {};
     ecs::register_event(mgr, std::move(query));
   }
+  {
+    ecs::EventHandler query;
+    query.name = "track_value_changed";
+    query.uniqueName = "sources/tests/unit_tests/main.inl:92[track_value_changed]";
+    query.nameHash = ecs::hash(query.uniqueName.c_str());
+    query.querySignature =
+    {
+      {ecs::get_component_id(ecs::TypeInfo<int>::typeId, "track_value"), ecs::Query::ComponentAccess::READ_COPY}
+    };
+    query.broadcastEvent = track_value_changed_broadcast_event;
+    query.unicastEvent = track_value_changed_unicast_event;
+    query.rangeEvent = track_value_changed_range_event;
+    query.trackedComponents =
+    {
+      ecs::get_component_id(ecs::TypeInfo<int>::typeId, "track_value")
+    };
+    query.eventIds = {ecs::EventInfo<ecs::OnTrack>::eventId};
+    ecs::register_event(mgr, std::move(query));
+  }
+  {
+    ecs::EventHandler query;
+    query.name = "track_label_changed";
+    query.uniqueName = "sources/tests/unit_tests/main.inl:99[track_label_changed]";
+    query.nameHash = ecs::hash(query.uniqueName.c_str());
+    query.querySignature =
+    {
+      {ecs::get_component_id(ecs::TypeInfo<std::string>::typeId, "track_label"), ecs::Query::ComponentAccess::READ_ONLY}
+    };
+    query.broadcastEvent = track_label_changed_broadcast_event;
+    query.unicastEvent = track_label_changed_unicast_event;
+    query.rangeEvent = track_label_changed_range_event;
+    query.trackedComponents =
+    {
+      ecs::get_component_id(ecs::TypeInfo<std::string>::typeId, "track_label")
+    };
+    query.eventIds = {ecs::EventInfo<ecs::OnTrack>::eventId};
+    ecs::register_event(mgr, std::move(query));
+  }
+  {
+    ecs::EventHandler query;
+    query.name = "on_batch_appear";
+    query.uniqueName = "sources/tests/unit_tests/main.inl:111[on_batch_appear]";
+    query.nameHash = ecs::hash(query.uniqueName.c_str());
+    query.querySignature =
+    {
+      {ecs::get_component_id(ecs::TypeInfo<int>::typeId, "batch_health"), ecs::Query::ComponentAccess::READ_COPY},
+      {ecs::get_component_id(ecs::TypeInfo<std::string>::typeId, "batch_name"), ecs::Query::ComponentAccess::READ_ONLY}
+    };
+    query.broadcastEvent = on_batch_appear_broadcast_event;
+    query.unicastEvent = on_batch_appear_unicast_event;
+    query.rangeEvent = on_batch_appear_range_event;
+    query.eventIds = {ecs::EventInfo<ecs::OnAppear>::eventId};
+    ecs::register_event(mgr, std::move(query));
+  }
+  {
+    ecs::EventHandler query;
+    query.name = "on_batch_disappear";
+    query.uniqueName = "sources/tests/unit_tests/main.inl:118[on_batch_disappear]";
+    query.nameHash = ecs::hash(query.uniqueName.c_str());
+    query.querySignature =
+    {
+      {ecs::get_component_id(ecs::TypeInfo<int>::typeId, "batch_health"), ecs::Query::ComponentAccess::READ_COPY}
+    };
+    query.broadcastEvent = on_batch_disappear_broadcast_event;
+    query.unicastEvent = on_batch_disappear_unicast_event;
+    query.rangeEvent = on_batch_disappear_range_event;
+    query.eventIds = {ecs::EventInfo<ecs::OnDisappear>::eventId};
+    ecs::register_event(mgr, std::move(query));
+  }
   {
     ecs::EventHandler query;
     query.name = "update_event";
-    query.uniqueName = "sources/tests/unit_tests/main.inl:94[update_event]";
+    query.uniqueName = "sources/tests/unit_tests/main.inl:137[update_event]";
     query.nameHash = ecs::hash(query.uniqueName.c_str());
     query.querySignature =
     {
@@ -333,13 +1082,14 @@ static void ecs_registration(ecs::EcsManager &mgr)
     };
     query.broadcastEvent = update_event_broadcast_event;
     query.unicastEvent = update_event_unicast_event;
+    query.rangeEvent = update_event_range_event;
     query.eventIds = {ecs::EventInfo<UpdateEvent>::eventId};
     ecs::register_event(mgr, std::move(query));
   }
   {
     ecs::EventHandler query;
     query.name = "heavy_event";
-    query.uniqueName = "sources/tests/unit_tests/main.inl:99[heavy_event]";
+    query.uniqueName = "sources/tests/unit_tests/main.inl:142[heavy_event]";
     query.nameHash = ecs::hash(query.uniqueName.c_str());
     query.querySignature =
     {
@@ -347,13 +1097,14 @@ static void ecs_registration(ecs::EcsManager &mgr)
     };
     query.broadcastEvent = heavy_event_broadcast_event;
     query.unicastEvent = heavy_event_unicast_event;
+    query.rangeEvent = heavy_event_range_event;
     query.eventIds = {ecs::EventInfo<HeavyEvent>::eventId};
     ecs::register_event(mgr, std::move(query));
   }
   {
     ecs::EventHandler query;
     query.name = "multi_event";
-    query.uniqueName = "sources/tests/unit_tests/main.inl:106[multi_event]";
+    query.uniqueName = "sources/tests/unit_tests/main.inl:149[multi_event]";
     query.nameHash = ecs::hash(query.uniqueName.c_str());
     query.querySignature =
     {
@@ -361,9 +1112,63 @@ static void ecs_registration(ecs::EcsManager &mgr)
     };
     query.broadcastEvent = multi_event_broadcast_event;
     query.unicastEvent = multi_event_unicast_event;
+    query.rangeEvent = multi_event_range_event;
     query.eventIds = {ecs::EventInfo<UpdateEvent>::eventId, ecs::EventInfo<HeavyEvent>::eventId, };
     ecs::register_event(mgr, std::move(query));
   }
+  {
+    ecs::EventHandler query;
+    query.name = "command_event";
+    query.uniqueName = "sources/tests/unit_tests/main.inl:168[command_event]";
+    query.nameHash = ecs::hash(query.uniqueName.c_str());
+    query.querySignature =
+    {
+      {ecs::get_component_id(ecs::TypeInfo<int>::typeId, "command_health"), ecs::Query::ComponentAccess::READ_COPY}
+    };
+    query.broadcastEvent = command_event_broadcast_event;
+    query.unicastEvent = command_event_unicast_event;
+    query.rangeEvent = command_event_range_event;
+    query.eventIds = {ecs::EventInfo<CommandEvent>::eventId};
+    ecs::register_event(mgr, std::move(query));
+  }
+  {
+    ecs::EventHandler query;
+    query.name = "track_block_changed";
+    query.uniqueName = "sources/tests/unit_tests/main.inl:1175[track_block_changed]";
+    query.nameHash = ecs::hash(query.uniqueName.c_str());
+    query.querySignature =
+    {
+      {ecs::get_component_id(ecs::TypeInfo<BigBlock>::typeId, "track_block"), ecs::Query::ComponentAccess::READ_ONLY}
+    };
+    query.broadcastEvent = track_block_changed_broadcast_event;
+    query.unicastEvent = track_block_changed_unicast_event;
+    query.rangeEvent = track_block_changed_range_event;
+    query.trackedComponents =
+    {
+      ecs::get_component_id(ecs::TypeInfo<BigBlock>::typeId, "track_block")
+    };
+    query.eventIds = {ecs::EventInfo<ecs::OnTrack>::eventId};
+    ecs::register_event(mgr, std::move(query));
+  }
+  {
+    ecs::EventHandler query;
+    query.name = "track_inventory_changed";
+    query.uniqueName = "sources/tests/unit_tests/main.inl:1182[track_inventory_changed]";
+    query.nameHash = ecs::hash(query.uniqueName.c_str());
+    query.querySignature =
+    {
+      {ecs::get_component_id(ecs::TypeInfo<Inventory>::typeId, "track_inventory"), ecs::Query::ComponentAccess::READ_ONLY}
+    };
+    query.broadcastEvent = track_inventory_changed_broadcast_event;
+    query.unicastEvent = track_inventory_changed_unicast_event;
+    query.rangeEvent = track_inventory_changed_range_event;
+    query.trackedComponents =
+    {
+      ecs::get_component_id(ecs::TypeInfo<Inventory>::typeId, "track_inventory")
+    };
+    query.eventIds = {ecs::EventInfo<ecs::OnTrack>::eventId};
+    ecs::register_event(mgr, std::move(query));
+  }
 }
 static ecs_details::CodegenFileRegistration fileRegistration(&ecs_registration);
 ECS_PULL_DEFINITION(variable_pull_main)